@@ -0,0 +1,586 @@
+/*harness.c
+ *Runs the kernel's filesystem, terminal text and keyboard code as an
+ *ordinary Linux program, against the stand-ins in shim.c. The filesystem
+ *is a real image (student-distrib/filesys_img, built from fsdir by
+ *createfs), checked file by file against fsdir itself. The benchmarks are
+ *the hardware-free ones, built from the kernel's bench_common.c, with the
+ *same names and report as bench.c's, timed with the host's clock instead
+ *of the TSC.
+ *
+ *      harness test  [filesys_img [fsdir]]
+ *      harness bench [filesys_img [fsdir]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <glob.h>
+#include <sys/stat.h>
+
+/*The kernel's int8_t is plain char, where <stdint.h>'s is signed char.
+ *Everything else in types.h matches the host's definitions. lib.h's
+ *prototypes clash with the C library's, so it is kept out; the string
+ *functions it declares link to lib.c's all the same.*/
+#define int8_t kernel_int8_t
+#define _LIB_H
+#undef NULL
+#include "types.h"
+#include "filesys.h"
+#include "keyboard.h"
+#include "vc.h"
+#include "bh.h"
+#include "term_sched.h"
+#include "bench.h"
+#include "shim.h"
+
+#define PASS 1
+#define FAIL 0
+
+#define DEFAULT_IMAGE     "../student-distrib/filesys_img"
+#define DEFAULT_FSDIR     "../fsdir"
+
+/*What test_read_data reads at a time: across block boundaries*/
+#define ODD_CHUNK         1000
+
+/*Scancodes the keyboard tests type*/
+#define SC_1              0x02
+#define SC_E              0x12
+#define SC_O              0x18
+#define SC_A              0x1E
+#define SC_H              0x23
+#define SC_L              0x26
+#define SC_C              0x2E
+#define SC_F2             0x3C
+#define SC_ENTER          0x1C
+#define SC_BACKSPACE      0x0E
+#define SC_TAB            0x0F
+#define SC_CTRL           0x1D
+#define SC_SHIFT          0x2A
+#define SC_ALT            0x38
+#define SC_CAPS           0x3A
+#define SC_RELEASE        0x80
+
+#define TEST_HEADER       \
+      printf("[TEST %s] Running %s\n", __FUNCTION__, __FUNCTION__)
+#define TEST_OUTPUT(name, result)   \
+      printf("[TEST %s] Result = %s\n", name, (result) ? "PASS" : "FAIL");
+#define CHECK(cond)                                                     \
+do {                                                                    \
+      if(!(cond)){                                                      \
+            printf("  %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+            result = FAIL;                                              \
+      }                                                                 \
+} while (0)
+
+static const char * fsdir = DEFAULT_FSDIR;
+
+/*What the terminal tests and benchmarks write to instead of 0xB8000*/
+static vid_data_t vga[MAXCHAR];
+
+/* load_image
+ * DESCRIPTION:   Reads a filesystem image into memory, block aligned as
+ *                the boot module is, and hands it to init_filesys.
+ * INPUTS:        path - the image file
+ * OUTPUTS:       0 on success, -1 if it can't be read
+ */
+static int load_image(const char * path){
+      struct stat st;
+      void * image;
+      int fd;
+
+      fd = open(path, O_RDONLY);
+      if(fd < 0 || fstat(fd, &st) < 0 || st.st_size < FOURKB){
+            perror(path);
+            return -1;
+      }
+      if(posix_memalign(&image, FOURKB, st.st_size) != 0 ||
+         read(fd, image, st.st_size) != st.st_size){
+            perror(path);
+            close(fd);
+            return -1;
+      }
+      close(fd);
+
+      init_filesys((boot_block_t *)image);
+
+      bench_init();
+      return 0;
+}
+
+/* host_path
+ * DESCRIPTION:   Finds the fsdir file a dentry was made from. createfs
+ *                cuts names down to FNAME_MAX_LEN, so a full-length one
+ *                matches the file it is the start of.
+ * INPUTS:        name - the dentry's name
+ *                path - where the path goes, FILENAME_MAX bytes
+ * OUTPUTS:       0, or -1 if fsdir has no such file
+ */
+static int host_path(const uint8_t * name, char * path){
+      glob_t found;
+      int ret = -1;
+
+      snprintf(path, FILENAME_MAX, "%s/%s", fsdir, (const char *)name);
+      if(access(path, R_OK) == 0){
+            return 0;
+      }
+      if(strlen((const char *)name) < FNAME_MAX_LEN){
+            return -1;
+      }
+      snprintf(path, FILENAME_MAX, "%s/%s*", fsdir, (const char *)name);
+      if(glob(path, 0, NULL, &found) == 0){
+            snprintf(path, FILENAME_MAX, "%s", found.gl_pathv[0]);
+            ret = 0;
+      }
+      globfree(&found);
+      return ret;
+}
+
+/* load_host_file
+ * DESCRIPTION:   Reads the fsdir copy of a file in the image.
+ * INPUTS:        name - its name
+ *                length - set to its size
+ * OUTPUTS:       a malloc'd copy of the file, or NULL if fsdir has none
+ */
+static uint8_t * load_host_file(const uint8_t * name, uint32_t * length){
+      char path[FILENAME_MAX];
+      struct stat st;
+      uint8_t * data;
+      int fd;
+
+      if(host_path(name, path) != 0){
+            return NULL;
+      }
+      fd = open(path, O_RDONLY);
+      if(fd < 0){
+            return NULL;
+      }
+      if(fstat(fd, &st) < 0 || (data = malloc(st.st_size + 1)) == NULL ||
+         read(fd, data, st.st_size) != st.st_size){
+            close(fd);
+            return NULL;
+      }
+      close(fd);
+      *length = st.st_size;
+      return data;
+}
+
+/* vga_reset
+ * Empties the screen and puts every cursor back at the top.
+ */
+static void vga_reset(void){
+      memset(vga, 0, sizeof(vga));
+      display = vga;
+      for(int i = 0; i < 3; i++){
+            tinfo[i].offset = 0;
+      }
+}
+
+/* vga_row
+ * The text on one row of the screen, up to the first empty cell.
+ */
+static const char * vga_row(int row){
+      static char text[TERMWIDTH + 1];
+      int i;
+
+      for(i = 0; i < TERMWIDTH && vga[row * TERMWIDTH + i].character != 0; i++){
+            text[i] = vga[row * TERMWIDTH + i].character;
+      }
+      text[i] = '\0';
+      return text;
+}
+
+/* type_keys
+ * Queues scancodes as the keyboard interrupt would and runs the bottom
+ * half that handles them.
+ */
+static void type_keys(const uint8_t * scancodes, uint32_t n){
+      for(uint32_t i = 0; i < n; i++){
+            keyboard_inject(scancodes[i]);
+      }
+      run_bottom_halves();
+}
+
+/* test_dentry_index
+ * Every entry found by index is found by its name too, with the same
+ * inode and type, and the index past the last entry isn't found.
+ */
+static int test_dentry_index(void){
+      TEST_HEADER;
+
+      int result = PASS;
+      dentry_t by_index;
+      dentry_t by_name;
+
+      CHECK(bench_num_names > 0);
+      for(uint32_t i = 0; i < bench_num_names; i++){
+            CHECK(read_dentry_by_index(i, &by_index) == 0);
+            CHECK(read_dentry_by_name(bench_names[i], &by_name) == 0);
+            CHECK(memcmp(by_index.file_name, bench_names[i], FNAME_MAX_LEN) == 0);
+            CHECK(memcmp(by_name.file_name, bench_names[i], FNAME_MAX_LEN) == 0);
+            CHECK(by_index.inode_num == by_name.inode_num);
+            CHECK(by_index.file_type == by_name.file_type);
+      }
+      CHECK(read_dentry_by_index(filesys_begin->num_dir_entries, &by_index) == -1);
+      return result;
+}
+
+/* test_dentry_names
+ * The edges of the name compare: empty and missing names, prefixes of
+ * names that are there, and names of exactly FNAME_MAX_LEN characters,
+ * which have no terminator in the dentry.
+ */
+static int test_dentry_names(void){
+      TEST_HEADER;
+
+      int result = PASS;
+      uint8_t name[FNAME_MAX_LEN + 2];
+      dentry_t dentry;
+      uint32_t len;
+
+      CHECK(read_dentry_by_name((uint8_t *)"", &dentry) == -1);
+      CHECK(read_dentry_by_name((uint8_t *)"no_such_file", &dentry) == -1);
+      CHECK(read_dentry_by_name((uint8_t *)".", &dentry) == 0);
+      CHECK(dentry.file_type == FILE_TYPE_DIR);
+
+      for(uint32_t i = 0; i < bench_num_names; i++){
+            len = strlen((char *)bench_names[i]);
+            memcpy(name, bench_names[i], len + 1);
+
+            //one character short
+            if(len > 1){
+                  name[len - 1] = '\0';
+                  if(read_dentry_by_name(name, &dentry) == 0){
+                        CHECK(strncmp((char *)dentry.file_name, (char *)name, FNAME_MAX_LEN) == 0);
+                  }
+                  name[len - 1] = bench_names[i][len - 1];
+            }
+
+            //one character too many
+            if(len < FNAME_MAX_LEN + 1){
+                  name[len] = 'x';
+                  name[len + 1] = '\0';
+                  if(read_dentry_by_name(name, &dentry) == 0){
+                        CHECK(len + 1 <= FNAME_MAX_LEN);
+                        CHECK(strncmp((char *)dentry.file_name, (char *)name, FNAME_MAX_LEN) == 0);
+                  }
+            }
+
+            //a full-length name only matches itself, and one longer never
+            if(len == FNAME_MAX_LEN){
+                  CHECK(read_dentry_by_name(bench_names[i], &dentry) == 0);
+                  CHECK(read_dentry_by_name(name, &dentry) == -1);
+            }
+      }
+      return result;
+}
+
+/* test_read_data
+ * Every regular file reads back the same as its fsdir copy, whole and in
+ * pieces that straddle blocks. Reads at or past the end return 0, and of
+ * an inode that doesn't exist, -1.
+ */
+static int test_read_data(void){
+      TEST_HEADER;
+
+      int result = PASS;
+      uint32_t checked = 0;
+      dentry_t dentry;
+      uint32_t length;
+      uint32_t offset;
+      uint8_t * host;
+      uint8_t * data;
+      uint8_t byte;
+      int32_t got;
+
+      for(uint32_t i = 0; i < bench_num_names; i++){
+            if(read_dentry_by_index(i, &dentry) != 0 || dentry.file_type != FILE_TYPE_REGULAR){
+                  continue;
+            }
+            host = load_host_file(bench_names[i], &length);
+            if(host == NULL){
+                  printf("  %s: not in %s, skipped\n", bench_names[i], fsdir);
+                  continue;
+            }
+            CHECK(inodes_begin[dentry.inode_num].length == length);
+            data = calloc(1, length + ODD_CHUNK);
+
+            got = read_data(dentry.inode_num, 0, data, length + ODD_CHUNK);
+            CHECK(got == (int32_t)length);
+            CHECK(memcmp(data, host, length) == 0);
+
+            memset(data, 0, length);
+            for(offset = 0; offset < length; offset += got){
+                  got = read_data(dentry.inode_num, offset, data + offset, ODD_CHUNK);
+                  if(got <= 0){
+                        break;
+                  }
+            }
+            CHECK(offset == length);
+            CHECK(memcmp(data, host, length) == 0);
+
+            CHECK(read_data(dentry.inode_num, length, data, ODD_CHUNK) == 0);
+            CHECK(read_data(dentry.inode_num, length + ODD_CHUNK, data, ODD_CHUNK) == 0);
+
+            free(data);
+            free(host);
+            checked++;
+      }
+      CHECK(checked > 0);
+      CHECK(read_data(num_inodes, 0, &byte, 1) == -1);
+      return result;
+}
+
+/* test_keyboard_echo
+ * Typed keys are echoed, shift and caps lock pick the right table,
+ * backspace takes back both the screen and the line, and enter hands the
+ * line to the terminal and wakes its reader.
+ */
+static int test_keyboard_echo(void){
+      TEST_HEADER;
+
+      static const uint8_t hello[] = {
+            SC_H, SC_H | SC_RELEASE, SC_E, SC_E | SC_RELEASE,
+            SC_L, SC_L | SC_RELEASE, SC_L, SC_L | SC_RELEASE,
+            SC_O, SC_O | SC_RELEASE
+      };
+      static const uint8_t shifted[] = {
+            SC_SHIFT, SC_A, SC_A | SC_RELEASE, SC_1, SC_1 | SC_RELEASE, SC_SHIFT | SC_RELEASE,
+            SC_CAPS, SC_CAPS | SC_RELEASE, SC_A, SC_A | SC_RELEASE,
+            SC_CAPS, SC_CAPS | SC_RELEASE, SC_A, SC_A | SC_RELEASE
+      };
+      static const uint8_t erase[] = {
+            SC_BACKSPACE, SC_BACKSPACE | SC_RELEASE, SC_BACKSPACE, SC_BACKSPACE | SC_RELEASE
+      };
+      static const uint8_t enter[] = { SC_ENTER, SC_ENTER | SC_RELEASE };
+      int result = PASS;
+
+      vga_reset();
+      memset(vc_buffer, 0, sizeof(vc_buffer));
+      shim.wakeups = 0;
+
+      type_keys(hello, sizeof(hello));
+      CHECK(strcmp(vga_row(0), "hello") == 0);
+      CHECK(tinfo[current_display].offset == 5);
+
+      type_keys(shifted, sizeof(shifted));
+      CHECK(strcmp(vga_row(0), "helloA!Aa") == 0);
+
+      type_keys(erase, sizeof(erase));
+      CHECK(strcmp(vga_row(0), "helloA!") == 0);
+      CHECK(tinfo[current_display].offset == 7);
+
+      type_keys(enter, sizeof(enter));
+      CHECK(tinfo[current_display].offset == TERMWIDTH);
+      CHECK(strcmp(vc_buffer[current_display], "helloA!\n") == 0);
+      CHECK(shim.wakeups == 1);
+      CHECK(shim.last_wakeup == vc_buffer[current_display]);
+
+      //an empty line can't be backspaced into the previous one
+      type_keys(erase, sizeof(erase));
+      CHECK(tinfo[current_display].offset == TERMWIDTH);
+      return result;
+}
+
+/* test_keyboard_control
+ * Ctrl+C interrupts the terminal's program, Ctrl+L clears the screen and
+ * the line, and Alt+F2 switches to the second terminal.
+ */
+static int test_keyboard_control(void){
+      TEST_HEADER;
+
+      static const uint8_t ctrl_c[] = {
+            SC_CTRL, SC_C, SC_C | SC_RELEASE, SC_CTRL | SC_RELEASE
+      };
+      static const uint8_t ctrl_l[] = {
+            SC_A, SC_A | SC_RELEASE,
+            SC_CTRL, SC_L, SC_L | SC_RELEASE, SC_CTRL | SC_RELEASE
+      };
+      static const uint8_t alt_f2[] = {
+            SC_ALT, SC_F2, SC_F2 | SC_RELEASE, SC_ALT | SC_RELEASE
+      };
+      static const uint8_t enter[] = { SC_ENTER, SC_ENTER | SC_RELEASE };
+      int result = PASS;
+
+      vga_reset();
+      memset(vc_buffer, 0, sizeof(vc_buffer));
+      shim.interrupts = 0;
+      shim.switches = 0;
+
+      type_keys(ctrl_c, sizeof(ctrl_c));
+      CHECK(shim.interrupts == 1);
+      CHECK(strcmp(vga_row(0), "") == 0);
+
+      type_keys(ctrl_l, sizeof(ctrl_l));
+      CHECK(strcmp(vga_row(0), "") == 0);
+      CHECK(tinfo[current_display].offset == 0);
+      type_keys(enter, sizeof(enter));
+      CHECK(strcmp(vc_buffer[current_display], "\n") == 0);
+
+      type_keys(alt_f2, sizeof(alt_f2));
+      CHECK(shim.switches == 1);
+      CHECK(shim.last_switch == 1);
+      return result;
+}
+
+/* test_print_scroll
+ * Printing a line more than the screen holds scrolls it up by one.
+ */
+static int test_print_scroll(void){
+      TEST_HEADER;
+
+      char line[TERMWIDTH];
+      int result = PASS;
+      int n;
+
+      vga_reset();
+      for(int i = 0; i <= TERMHEIGHT; i++){
+            n = snprintf(line, sizeof(line), "line %d\n", i);
+            print_term((uint8_t *)line, n);
+      }
+      CHECK(strcmp(vga_row(0), "line 1") == 0);
+      CHECK(strcmp(vga_row(TERMHEIGHT - 1), "line 25") == 0);
+      CHECK(tinfo[running_display].offset == MAXCHAR);
+
+      //a line that fills the row wraps onto the next
+      vga_reset();
+      memset(line, '#', TERMWIDTH);
+      print_term((uint8_t *)line, TERMWIDTH);
+      printchar_term('x');
+      CHECK(strlen(vga_row(0)) == TERMWIDTH);
+      CHECK(strcmp(vga_row(1), "x") == 0);
+      return result;
+}
+
+/* test_tab
+ * Tab moves ten columns, or to the start of the next row if that would
+ * run off the end of this one.
+ */
+static int test_tab(void){
+      TEST_HEADER;
+
+      int result = PASS;
+
+      vga_reset();
+      tab();
+      CHECK(tinfo[running_display].offset == 10);
+      set_term_x(TERMWIDTH - 5);
+      tab();
+      CHECK(tinfo[running_display].offset == TERMWIDTH);
+      return result;
+}
+
+/* The benchmarks from bench_common.c, with more operations per run than
+ * the kernel's since the host's clock is coarser */
+static bench_t bench_table[] = {
+      BENCH(lookup, 100000),
+      BENCH(lookup_bytewise, 100000),
+      BENCH(read_data, 1000),
+      BENCH(keyboard_echo, 100000),
+      BENCH(console_scroll, 100000)
+};
+
+#define NUM_BENCHES (sizeof(bench_table) / sizeof(bench_table[0]))
+
+static unsigned long long now_ns(void){
+      struct timespec ts;
+
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* bench_run
+ * DESCRIPTION:   Runs everything in bench_table: BENCH_WARMUP untimed
+ *                runs, then BENCH_RUNS timed ones, and reports the fastest
+ *                and the average per operation, like bench_main.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ */
+static void bench_run(void){
+      unsigned long long start;
+      unsigned long long ns;
+      unsigned long long min;
+      unsigned long long avg;
+      uint32_t bytes = 0;
+      bench_t * b;
+
+      vga_reset();
+      for(uint32_t i = 0; i < NUM_BENCHES; i++){
+            b = &bench_table[i];
+            for(int r = 0; r < BENCH_WARMUP; r++){
+                  (void)b->run(b->ops, b->size);
+            }
+
+            min = ~0ULL;
+            avg = 0;
+            for(int r = 0; r < BENCH_RUNS; r++){
+                  start = now_ns();
+                  bytes = b->run(b->ops, b->size);
+                  ns = now_ns() - start;
+                  if(ns < min){
+                        min = ns;
+                  }
+                  avg += ns / BENCH_RUNS;
+            }
+
+            printf("bench %s: %.1f ns/op min, %.1f avg", b->name,
+                   (double)min / b->ops, (double)avg / b->ops);
+            if(bytes != 0 && min != 0){
+                  //bytes per microsecond is MB/s
+                  printf(", %llu MB/s", bytes * 1000ULL / min);
+            }
+            printf("\n");
+      }
+}
+
+int main(int argc, char ** argv){
+      static int (* const tests[])(void) = {
+            test_dentry_index,
+            test_dentry_names,
+            test_read_data,
+            test_keyboard_echo,
+            test_keyboard_control,
+            test_print_scroll,
+            test_tab
+      };
+      static const char * const test_names[] = {
+            "dentry_index", "dentry_names", "read_data",
+            "keyboard_echo", "keyboard_control", "print_scroll", "tab"
+      };
+      const char * image = DEFAULT_IMAGE;
+      int failed = 0;
+
+      if(argc < 2 || (strcmp(argv[1], "test") != 0 && strcmp(argv[1], "bench") != 0)){
+            fprintf(stderr, "usage: %s test|bench [filesys_img [fsdir]]\n", argv[0]);
+            return 2;
+      }
+      if(argc > 2){
+            image = argv[2];
+      }
+      if(argc > 3){
+            fsdir = argv[3];
+      }
+
+      if(load_image(image) != 0){
+            return 2;
+      }
+      vga_reset();
+      keyboard_init();
+
+      if(strcmp(argv[1], "bench") == 0){
+            bench_run();
+            return 0;
+      }
+
+      for(uint32_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++){
+            int result = tests[i]();
+            TEST_OUTPUT(test_names[i], result);
+            if(result != PASS){
+                  failed++;
+            }
+      }
+      printf("%d of %d tests failed\n", failed, (int)(sizeof(tests) / sizeof(tests[0])));
+      return failed != 0;
+}
@@ -0,0 +1,127 @@
+/*shim.c
+ *Stand-ins for the parts of the kernel that filesys.c, video.c, keyboard.c
+ *and lib.c reach into but the harness doesn't build: the interrupt
+ *controller, bottom halves, locks, the CPUs, the scheduler and the kernel
+ *log. It is compiled like those files, against the kernel's own headers,
+ *so every prototype is checked. Hardware access is gone already (see the
+ *Makefile: the inline assembly is compiled out), so these only keep
+ *enough state for harness.c to see what the kernel code asked for.
+ */
+
+#include "lib.h"
+#include "fpu.h"
+#include "vc.h"
+#include "bh.h"
+#include "irq.h"
+#include "spinlock.h"
+#include "smp.h"
+#include "term_sched.h"
+#include "signal.h"
+#include "klog.h"
+#include "shim.h"
+
+/*Every test runs on the first terminal, on the only CPU*/
+volatile int current_display = 0;
+cpu_t cpus[MAX_CPUS];
+
+/*lib.c's memcpy and memset only take the SSE path when this is set*/
+uint32_t sse2_enabled = 0;
+
+spinlock_t vc_buffer_lock = SPINLOCK_INIT;
+
+/*What the stubs below were asked to do, for harness.c to check*/
+shim_state_t shim;
+
+static void (*bh_handler[NUM_BH])(void);
+static uint32_t bh_pending;
+
+/* bh_install / bh_raise / run_bottom_halves
+ * Same contract as bh.c, without the interrupt flag juggling: a raised
+ * bottom half runs on the next run_bottom_halves call.
+ */
+void bh_install(uint32_t nr, void (*handler)(void)){
+      bh_handler[nr] = handler;
+}
+
+void bh_raise(uint32_t nr){
+      bh_pending |= 1 << nr;
+}
+
+void run_bottom_halves(void){
+      uint32_t nr;
+      uint32_t pending;
+
+      while(bh_pending){
+            pending = bh_pending;
+            bh_pending = 0;
+            for(nr = 0; nr < NUM_BH; nr++){
+                  if((pending & (1 << nr)) && bh_handler[nr] != NULL){
+                        bh_handler[nr]();
+                  }
+            }
+      }
+}
+
+void irq_enable(uint32_t irq_num){
+      shim.irq_enabled |= 1 << irq_num;
+}
+
+void irq_disable(uint32_t irq_num){
+      shim.irq_enabled &= ~(1 << irq_num);
+}
+
+void irq_eoi(uint32_t irq_num){
+      shim.eois++;
+}
+
+/*cli() and sti() call these; there is nothing to time on the host*/
+void irqoff_begin(void){
+}
+
+void irqoff_end(void){
+}
+
+/*running_display is this CPU's terminal: the first*/
+cpu_t * this_cpu(void){
+      return &cpus[0];
+}
+
+/*One thread, so a lock is never contended; it only has to be balanced*/
+void spin_lock(spinlock_t * lock){
+      lock->locked = 1;
+}
+
+void spin_unlock(spinlock_t * lock){
+      lock->locked = 0;
+}
+
+/*The kernel log goes out the serial port; the harness has none*/
+void klog_console_write(const int8_t * buf, uint32_t n){
+}
+
+void kernel_fpu_begin(kernel_fpu_t * state){
+}
+
+void kernel_fpu_end(kernel_fpu_t * state){
+}
+
+/* get_buffer
+ * vc.c hands the keyboard the line buffer of the terminal on screen
+ */
+char * get_buffer(){
+      return vc_buffer[current_display];
+}
+
+void wake_up_interactive(void * chan){
+      shim.wakeups++;
+      shim.last_wakeup = chan;
+}
+
+void signal_interrupt_current_term(void){
+      shim.interrupts++;
+}
+
+void asynchronous_task_switch(int new_display){
+      shim.switches++;
+      shim.last_switch = new_display;
+}
@@ -0,0 +1,29 @@
+/* shim.h: What the hardware stand-ins in shim.c record, and the kernel
+ * symbols harness.c uses that no kernel header declares */
+#ifndef _SHIM_H
+#define _SHIM_H
+
+#include "types.h"
+#include "video.h"
+
+/* Counts of what the kernel code asked the stubs for */
+typedef struct shim_state {
+      uint32_t irq_enabled;       //bit n set by irq_enable(n)
+      uint32_t eois;
+      uint32_t wakeups;           //wake_up_interactive calls
+      void * last_wakeup;
+      uint32_t interrupts;        //signal_interrupt_current_term calls
+      uint32_t switches;          //asynchronous_task_switch calls
+      int last_switch;
+} shim_state_t;
+
+extern shim_state_t shim;
+
+/* video.c: where the text goes and each terminal's cursor offset */
+extern vid_data_t * display;
+extern terminal_info_t tinfo[3];
+
+/* keyboard.c: handles the scancodes keyboard_inject queued */
+void keyboard_bh(void);
+
+#endif  /* _SHIM_H */
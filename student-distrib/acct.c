@@ -0,0 +1,104 @@
+/*acct.c
+ *Per-process resource accounting. Each PCB carries an acct_t that the
+ *timer interrupt, the syscall dispatcher, the read and write syscalls and
+ *the page fault path add to, so it can be told which program is using the
+ *CPU or the disk. procstat copies them out for programs like top.
+ */
+
+#include "acct.h"
+#include "lib.h"
+#include "syscall.h"
+#include "smp.h"
+
+/* acct_init
+ * DESCRIPTION:   Gives a new process a name and zeroed counters.
+ * INPUTS:        pcb - the process being created
+ *                name - the program it runs, cut to PROC_NAME_LEN - 1
+ * OUTPUTS:       none
+ * SIDE EFFECTS:  resets pcb's name and acct
+ */
+void acct_init(PCB_t * pcb, const uint8_t * name){
+      (void)strncpy((int8_t *)pcb->name, (const int8_t *)name, PROC_NAME_LEN - 1);
+      pcb->name[PROC_NAME_LEN - 1] = '\0';
+      (void)memset(&(pcb->acct), 0, sizeof(acct_t));
+      return;
+}
+
+/* acct_tick
+ * DESCRIPTION:   Charges the ticks a timer interrupt stands for to the
+ *                process running on this CPU: as user time if the
+ *                interrupt came from user mode, kernel time otherwise.
+ *                Ticks spent halted with nothing to run aren't anybody's.
+ * INPUTS:        ticks - from tick_interrupt
+ * OUTPUTS:       none
+ */
+void acct_tick(uint32_t ticks){
+      cpu_t * cpu = this_cpu();
+      PCB_t * pcb;
+
+      if(cpu->current == -1 || cpu->idle){
+            return;
+      }
+      pcb = task_pcb[cpu->current];
+      if(cpu->irq_from_user){
+            pcb->acct.utime += ticks;
+      }
+      else{
+            pcb->acct.stime += ticks;
+      }
+      return;
+}
+
+/* acct_bytes
+ * DESCRIPTION:   Counts the bytes a read or write returned.
+ * INPUTS:        counter - bytes_read or bytes_written of the caller
+ *                retval - the driver's return value
+ * OUTPUTS:       retval
+ */
+int32_t acct_bytes(uint32_t * counter, int32_t retval){
+      if(retval > 0){
+            *counter += retval;
+      }
+      return retval;
+}
+
+/* procstat_handler
+ * DESCRIPTION:   Copies the name, scheduling state and counters of every
+ *                live process, in PID order.
+ * INPUTS:        buf - array to fill
+ *                count - number of entries in buf
+ * OUTPUTS:       the number of entries filled, -1 if buf isn't in the
+ *                program's memory
+ */
+int32_t procstat_handler(procstat_t * buf, int32_t count){
+      PCB_t * pcb;
+      int32_t filled = 0;
+      int PID;
+
+      if(count <= 0){
+            return -1;
+      }
+      if(count > MAX_CONCURRENT_TASKS){
+            count = MAX_CONCURRENT_TASKS;
+      }
+      if((uint32_t)buf < _128MB || (uint32_t)buf > _132MB - count * sizeof(procstat_t)){
+            return -1;
+      }
+
+      for(PID = 0; PID < MAX_CONCURRENT_TASKS && filled < count; PID++){
+            pcb = task_pcb[PID];
+            if(!pcb->is_active){
+                  continue;
+            }
+            buf[filled].pid = PID;
+            buf[filled].parent = (PID < 3) ? -1 : pcb->parent_pcb->PID;
+            buf[filled].state = pcb->state;
+            buf[filled].terminal = pcb->terminal;
+            buf[filled].prio = pcb->prio;
+            buf[filled].nice = pcb->nice;
+            (void)memcpy(buf[filled].name, pcb->name, PROC_NAME_LEN);
+            buf[filled].acct = pcb->acct;
+            filled++;
+      }
+      return filled;
+}
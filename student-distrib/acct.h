@@ -0,0 +1,20 @@
+/* acct.h: Header file for per-process resource accounting */
+#ifndef _ACCT_H
+#define _ACCT_H
+
+#include "types.h"
+#include "structures.h"
+
+/* Names a new process and clears its counters */
+void acct_init(PCB_t * pcb, const uint8_t * name);
+
+/* Charges timer ticks to the process running on this CPU */
+void acct_tick(uint32_t ticks);
+
+/* Adds what a read or write moved to counter, passing retval through */
+int32_t acct_bytes(uint32_t * counter, int32_t retval);
+
+/* syscall */
+int32_t procstat_handler(procstat_t * buf, int32_t count);
+
+#endif  /* _ACCT_H */
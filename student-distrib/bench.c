@@ -0,0 +1,434 @@
+/*bench.c
+ *Timed kernel benchmarks, built with RUN_BENCH in kernel.c. Each one is
+ *run once to warm the caches and TLB, then BENCH_RUNS times, timed with
+ *the TSC. The fastest run is the one reported, since an interrupt or
+ *another shell starting can only make a run slower, along with the
+ *average. They run in the first shell's process before it enters user
+ *mode, so the ones that need a process (execute, task_switch) have one.
+ *memcpy and memset are timed at sizes from 16B to 4MB against their rep
+ *movsl and rep stosl fallbacks, and name lookups against the byte loops
+ *read_dentry_by_name had before the word-at-a-time helpers. The device
+ *interrupt entry is timed both ways irq_entry can go: an INT from the
+ *kernel takes the lean path, one from user mode the full one. The ones
+ *that need no hardware are in bench_common.c, shared with the host harness.
+ */
+
+#include "bench.h"
+#include "lib.h"
+#include "syscall.h"
+#include "term_sched.h"
+#include "video.h"
+#include "vc.h"
+#include "irqstat.h"
+#include "klog.h"
+#include "paging.h"
+#include "fpu.h"
+#include "smp.h"
+#include "x86_desc.h"
+#include "int_setup.h"
+
+/*What bench_execute runs: prints a line and halts*/
+#define EXEC_PROGRAM      "testprint"
+
+#define LINE_LEN          128
+
+/*Device vectors no interrupt controller delivers on, raised with INT by
+ *the interrupt entry benchmarks: one that does nothing, and one that
+ *brings bench_irq_user back from user mode*/
+#define BENCH_VECTOR          0xF0
+#define BENCH_RETURN_VECTOR   0xF1
+
+/*Where bench_irq_user's user code goes: the top page of the first
+ *shell's program, whose stack isn't in use before it starts*/
+#define IRQ_STUB_ADDR     (_128MB + _4MB - _4KB)
+#define IRQ_STUB_SP       (_128MB + _4MB - 4)
+#define IRQ_STUB_LEN      9
+/*Room left on the kernel stack below bench_irq_user's frame, for its
+ *pushes, before the interrupts from user mode start*/
+#define IRQ_STACK_GAP     256
+
+/*Where the memcpy and memset benchmarks' buffers are mapped, 4MB each,
+ *from the region paging.h keeps for benchmarks*/
+#define COPY_SRC_VIRT     0x4000000
+#define COPY_DST_VIRT     0x4400000
+#define COPY_SRC_PHYS     BENCH_FRAMES_BEGIN
+#define COPY_DST_PHYS     (BENCH_FRAMES_BEGIN + 0x400000)
+#define COPY_MAX_SIZE     0x400000
+
+/*Bytes each run of a memcpy or memset benchmark moves, whatever the size*/
+#define COPY_RUN_BYTES    0x400000
+
+/*memcpy and memset and their fallbacks on size-byte buffers*/
+#define COPY_BENCHES(size) \
+      BENCH_SIZED(memcpy, COPY_RUN_BYTES / (size), size), \
+      BENCH_SIZED(memcpy_rep, COPY_RUN_BYTES / (size), size), \
+      BENCH_SIZED(memset, COPY_RUN_BYTES / (size), size), \
+      BENCH_SIZED(memset_rep, COPY_RUN_BYTES / (size), size)
+
+static uint32_t bench_execute(uint32_t ops, uint32_t size);
+static uint32_t bench_task_switch(uint32_t ops, uint32_t size);
+static uint32_t bench_irq_kernel(uint32_t ops, uint32_t size);
+static uint32_t bench_irq_user(uint32_t ops, uint32_t size);
+static uint32_t bench_memcpy(uint32_t ops, uint32_t size);
+static uint32_t bench_memcpy_rep(uint32_t ops, uint32_t size);
+static uint32_t bench_memset(uint32_t ops, uint32_t size);
+static uint32_t bench_memset_rep(uint32_t ops, uint32_t size);
+
+static bench_t bench_table[] = {
+      BENCH(lookup, 1000),
+      BENCH(lookup_bytewise, 1000),
+      BENCH(read_data, 4),
+      BENCH(execute, 10),
+      BENCH(task_switch, 1000),
+      BENCH(irq_kernel, 1000),
+      BENCH(irq_user, 1000),
+      BENCH(keyboard_echo, 100),
+      BENCH(console_scroll, 100),
+      COPY_BENCHES(16),
+      COPY_BENCHES(256),
+      COPY_BENCHES(4096),
+      COPY_BENCHES(65536),
+      COPY_BENCHES(1048576),
+      COPY_BENCHES(COPY_MAX_SIZE)
+};
+
+#define NUM_BENCHES (sizeof(bench_table) / sizeof(bench_table[0]))
+
+/* bench_execute
+ * DESCRIPTION:   execute and halt of a small program, round trip through
+ *                the system call: parse, load, paging, user mode and back.
+ * INPUTS:        ops - programs run
+ * OUTPUTS:       0
+ */
+static uint32_t bench_execute(uint32_t ops, uint32_t size){
+      uint32_t i;
+
+      for(i = 0; i < ops; i++){
+            (void)execute((uint8_t *)EXEC_PROGRAM);
+      }
+      return 0;
+}
+
+/* bench_task_switch
+ * DESCRIPTION:   task_switch to the running process: the TSS, video and
+ *                paging updates and the stack swap, without the CR3
+ *                reload a switch between programs adds.
+ * INPUTS:        ops - switches
+ * OUTPUTS:       0
+ */
+static uint32_t bench_task_switch(uint32_t ops, uint32_t size){
+      int PID = get_pcb_ptr()->PID;
+      uint32_t i;
+
+      for(i = 0; i < ops; i++){
+            task_switch(PID);
+      }
+      return 0;
+}
+
+/* bench_irq_kernel
+ * DESCRIPTION:   A device interrupt taken in the kernel: INT to a vector
+ *                with nothing installed, through irq_entry's lean path
+ *                (no segment registers, no signals) and the dispatcher.
+ * INPUTS:        ops - interrupts
+ * OUTPUTS:       0
+ */
+static uint32_t bench_irq_kernel(uint32_t ops, uint32_t size){
+      uint32_t i;
+
+      for(i = 0; i < ops; i++){
+            asm volatile("INT %0" : : "i"(BENCH_VECTOR) : "memory");
+      }
+      return 0;
+}
+
+/*What bench_irq_user runs in user mode, ECX holding the count:
+ *    1: INT $BENCH_VECTOR
+ *       DECL %ECX
+ *       JNZ 1b
+ *       INT $BENCH_RETURN_VECTOR
+ *       JMP .
+ */
+static const uint8_t irq_stub[IRQ_STUB_LEN] = {
+      0xCD, BENCH_VECTOR,
+      0x49,
+      0x75, 0xFB,
+      0xCD, BENCH_RETURN_VECTOR,
+      0xEB, 0xFE
+};
+
+/*The kernel stack pointer bench_irq_user left from*/
+static uint32_t irq_user_esp;
+
+/* irq_user_return
+ * DESCRIPTION:   BENCH_RETURN_VECTOR's handler: drops the interrupt frame
+ *                and the dispatcher's, and goes back to bench_irq_user as
+ *                if its IRET had returned.
+ * INPUTS:        none
+ * OUTPUTS:       doesn't return
+ */
+static void irq_user_return(void){
+      asm volatile("                      \n\
+            MOVL %0, %%ESP                \n\
+            JMP irq_user_back             \n\
+            "
+            :
+            : "r"(irq_user_esp)
+            : "memory"
+      );
+}
+
+/* bench_irq_user
+ * DESCRIPTION:   A device interrupt taken in user mode: ops INTs from a
+ *                loop in ring 3, through irq_entry's full path, segment
+ *                registers and do_signal included. Gets to user mode like
+ *                execute, with an IRET, on the kernel stack below its own
+ *                frame; irq_user_return brings it back.
+ * INPUTS:        ops - interrupts
+ * OUTPUTS:       0
+ * SIDE EFFECTS:  writes the top page of the first shell's program
+ */
+static uint32_t bench_irq_user(uint32_t ops, uint32_t size){
+      PCB_t * pcb = get_pcb_ptr();
+      uint32_t esp0 = pcb->esp0;
+      uint32_t esp;
+
+      (void)memcpy((void *)IRQ_STUB_ADDR, irq_stub, IRQ_STUB_LEN);
+      install_handler(BENCH_RETURN_VECTOR, irq_user_return);
+      idt[BENCH_VECTOR].dpl = 3;
+      idt[BENCH_RETURN_VECTOR].dpl = 3;
+
+      //interrupts from user mode start below this frame, here and after
+      //any switch away and back
+      asm volatile("MOVL %%ESP, %0" : "=r"(esp));
+      pcb->esp0 = esp - IRQ_STACK_GAP;
+      this_cpu()->tss->esp0 = pcb->esp0;
+
+      //the IRET to user mode clears ES, FS and GS, and only DS comes back
+      asm volatile("                      \n\
+            PUSHFL                        \n\
+            PUSHL %%EBP                   \n\
+            PUSHL %%EBX                   \n\
+            PUSHL %%ESI                   \n\
+            PUSHL %%EDI                   \n\
+            PUSHL %%ES                    \n\
+            PUSHL %%FS                    \n\
+            PUSHL %%GS                    \n\
+            MOVL %%ESP, (%%EDX)           \n\
+            MOVW %2, %%AX                 \n\
+            MOVW %%AX, %%DS               \n\
+            PUSHL %2                      \n\
+            PUSHL %3                      \n\
+            PUSHFL                        \n\
+            ORL $0x200, (%%ESP)           \n\
+            PUSHL %4                      \n\
+            PUSHL %5                      \n\
+            IRET                          \n\
+            irq_user_back:                \n\
+            POPL %%GS                     \n\
+            POPL %%FS                     \n\
+            POPL %%ES                     \n\
+            POPL %%EDI                    \n\
+            POPL %%ESI                    \n\
+            POPL %%EBX                    \n\
+            POPL %%EBP                    \n\
+            POPFL                         \n\
+            "
+            : "=c"(ops), "=d"(esp)
+            : "i"(USER_DS), "i"(IRQ_STUB_SP), "i"(USER_CS), "i"(IRQ_STUB_ADDR),
+              "0"(ops), "1"(&irq_user_esp)
+            : "eax", "memory", "cc"
+      );
+      //the return vector's dispatcher turned interrupts off and never
+      //got to count them back on
+      irqoff_end();
+
+      pcb->esp0 = esp0;
+      this_cpu()->tss->esp0 = esp0;
+      //a user program raising these would now fault
+      idt[BENCH_VECTOR].dpl = 0;
+      idt[BENCH_RETURN_VECTOR].dpl = 0;
+      return 0;
+}
+
+/* bench_memcpy, bench_memcpy_rep, bench_memset, bench_memset_rep
+ * DESCRIPTION:   One of the copy or fill functions on size bytes of the
+ *                buffers bench_main maps. The fallbacks are what memcpy
+ *                and memset do without SSE2 or below MEM_SSE_MIN bytes.
+ * INPUTS:        ops - calls
+ *                size - bytes per call
+ * OUTPUTS:       bytes copied or set
+ */
+static uint32_t bench_memcpy(uint32_t ops, uint32_t size){
+      uint32_t i;
+
+      for(i = 0; i < ops; i++){
+            (void)memcpy((void *)COPY_DST_VIRT, (const void *)COPY_SRC_VIRT, size);
+      }
+      return ops * size;
+}
+
+static uint32_t bench_memcpy_rep(uint32_t ops, uint32_t size){
+      uint32_t i;
+
+      for(i = 0; i < ops; i++){
+            (void)memcpy_rep((void *)COPY_DST_VIRT, (const void *)COPY_SRC_VIRT, size);
+      }
+      return ops * size;
+}
+
+static uint32_t bench_memset(uint32_t ops, uint32_t size){
+      uint32_t i;
+
+      for(i = 0; i < ops; i++){
+            (void)memset((void *)COPY_DST_VIRT, i, size);
+      }
+      return ops * size;
+}
+
+static uint32_t bench_memset_rep(uint32_t ops, uint32_t size){
+      uint32_t i;
+
+      for(i = 0; i < ops; i++){
+            (void)memset_rep((void *)COPY_DST_VIRT, i, size);
+      }
+      return ops * size;
+}
+
+/* append, append_u
+ * Add a string or a number to a result line; return its new end.
+ */
+static int8_t * append(int8_t * p, const int8_t * s){
+      while(*s != '\0'){
+            *p++ = *s++;
+      }
+      *p = '\0';
+      return p;
+}
+
+static int8_t * append_u(int8_t * p, uint32_t value){
+      int8_t num[12];
+      (void)itoa(value, num, 10);
+      return append(p, num);
+}
+
+/* cycles_to_ns
+ * Time per operation in nanoseconds, without overflowing for runs up to
+ * a few seconds.
+ */
+static uint32_t cycles_to_ns(uint32_t cycles, uint32_t ops){
+      if(tsc_per_us == 0){
+            return 0;
+      }
+      if(cycles < 0xFFFFFFFF / 1000){
+            return cycles * 1000 / tsc_per_us / ops;
+      }
+      return cycles / tsc_per_us * 1000 / ops;
+}
+
+/* bench_print
+ * Prints a line to the console and the kernel log.
+ */
+static void bench_print(const int8_t * line){
+      unsigned long flags;
+
+      //through the terminal, which the benchmarks themselves write to
+      cli_and_save(flags);
+      print_term((uint8_t *)line, strlen(line));
+      restore_flags(flags);
+      //unless the console is already being copied there
+      if(!klog_console){
+            klog_puts(line);
+      }
+      return;
+}
+
+/* bench_report
+ * Prints one result to the console and the kernel log:
+ *   name[ size]: min cycles/op, avg cycles/op, ns/op[, MB/s]
+ */
+static void bench_report(bench_t * b, uint32_t min, uint32_t avg, uint32_t bytes){
+      int8_t line[LINE_LEN];
+      int8_t * p = line;
+
+      p = append(p, "bench ");
+      p = append(p, b->name);
+      if(b->size != 0){
+            p = append(p, " ");
+            p = append_u(p, b->size);
+            p = append(p, "B");
+      }
+      p = append(p, ": ");
+      p = append_u(p, min / b->ops);
+      p = append(p, " cycles/op min, ");
+      p = append_u(p, avg / b->ops);
+      p = append(p, " avg, ");
+      p = append_u(p, cycles_to_ns(min, b->ops));
+      p = append(p, " ns/op");
+      if(bytes != 0 && tsc_per_us != 0 && min / tsc_per_us != 0){
+            //bytes per microsecond is MB/s
+            p = append(p, ", ");
+            p = append_u(p, bytes / (min / tsc_per_us));
+            p = append(p, " MB/s");
+      }
+      p = append(p, "\n");
+
+      bench_print(line);
+      return;
+}
+
+/* bench_main
+ * DESCRIPTION:   Runs everything in bench_table: BENCH_WARMUP untimed
+ *                runs, then BENCH_RUNS timed ones, and reports the fastest
+ *                and the average. Called with interrupts on, as the first
+ *                thing the first shell does (see task_run_first). The copy
+ *                buffers are mapped in that shell's page directory for the
+ *                while.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ */
+void bench_main(void){
+      uint32_t start;
+      uint32_t cycles;
+      uint32_t min;
+      uint32_t avg;
+      uint32_t bytes = 0;
+      uint32_t src_pde;
+      uint32_t dst_pde;
+      uint32_t i;
+      uint32_t r;
+
+      bench_init();
+
+      src_pde = big_page_map(COPY_SRC_VIRT, COPY_SRC_PHYS);
+      dst_pde = big_page_map(COPY_DST_VIRT, COPY_DST_PHYS);
+      (void)memset_rep((void *)COPY_SRC_VIRT, 0x5A, COPY_MAX_SIZE);
+
+      klog_puts("bench: start\n");
+      bench_print(sse2_enabled ? "bench: memcpy and memset with SSE2\n" :
+                                 "bench: memcpy and memset without SSE2\n");
+      for(i = 0; i < NUM_BENCHES; i++){
+            for(r = 0; r < BENCH_WARMUP; r++){
+                  (void)bench_table[i].run(bench_table[i].ops, bench_table[i].size);
+            }
+
+            min = 0xFFFFFFFF;
+            avg = 0;
+            for(r = 0; r < BENCH_RUNS; r++){
+                  start = rdtsc_lo();
+                  bytes = bench_table[i].run(bench_table[i].ops, bench_table[i].size);
+                  cycles = rdtsc_lo() - start;
+                  if(cycles < min){
+                        min = cycles;
+                  }
+                  avg += cycles / BENCH_RUNS;
+            }
+            bench_report(&bench_table[i], min, avg, bytes);
+      }
+      big_page_unmap(COPY_DST_VIRT, dst_pde);
+      big_page_unmap(COPY_SRC_VIRT, src_pde);
+      //where the interrupt time went meanwhile
+      (void)klog_dump("proc/irqstat");
+      klog_puts("bench: done\n");
+      return;
+}
@@ -0,0 +1,47 @@
+/* bench.h: Header file for the kernel benchmarks */
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include "types.h"
+#include "filesys.h"
+
+/* Untimed runs of each benchmark, then timed ones */
+#define BENCH_WARMUP      1
+#define BENCH_RUNS        5
+
+/* One benchmark: run does ops operations, each on size bytes if it takes
+ * a size, and returns the bytes they moved, or 0 if it isn't a
+ * throughput test */
+typedef struct bench {
+      const int8_t * name;
+      uint32_t (*run)(uint32_t ops, uint32_t size);
+      uint32_t ops;
+      uint32_t size;
+} bench_t;
+
+/* Registers bench_<fn> in bench_table, doing ops operations per run */
+#define BENCH(fn, ops)  { #fn, bench_##fn, ops, 0 }
+
+/* The same for one size of a benchmark run at several */
+#define BENCH_SIZED(fn, ops, size)  { #fn, bench_##fn, ops, size }
+
+/* Every file name, for the lookups to go round; filled by bench_init */
+extern uint8_t bench_names[MAX_DENTRY][FNAME_MAX_LEN + 1];
+extern uint32_t bench_num_names;
+
+/* Reads the file names out of the mounted filesystem */
+void bench_init(void);
+
+/* The benchmarks that need no hardware (bench_common.c), which the host
+ * harness runs too */
+uint32_t bench_lookup(uint32_t ops, uint32_t size);
+uint32_t bench_lookup_bytewise(uint32_t ops, uint32_t size);
+uint32_t bench_read_data(uint32_t ops, uint32_t size);
+uint32_t bench_keyboard_echo(uint32_t ops, uint32_t size);
+uint32_t bench_console_scroll(uint32_t ops, uint32_t size);
+
+/* Runs every benchmark and prints the results to the console and serial.
+ * Runs in the first shell before it starts (see RUN_BENCH in kernel.c) */
+void bench_main(void);
+
+#endif  /* _BENCH_H */
@@ -0,0 +1,199 @@
+/*bench_common.c
+ *The benchmarks that need no hardware: name lookups, file reads, keyboard
+ *echo and console scrolling. The kernel runs them from bench_main, timed
+ *with the TSC, and the host harness (harness/harness.c) builds this same
+ *file and times them with the host's clock. Only the timing and the report
+ *differ between the two.
+ */
+
+#include "bench.h"
+#include "lib.h"
+#include "filesys.h"
+#include "keyboard.h"
+#include "video.h"
+#include "vc.h"
+#include "bh.h"
+
+/*What bench_read_data reads at a time, as a program's read would*/
+#define READ_CHUNK        4096
+
+/*Scancodes bench_keyboard_echo types: a, then backspace to erase it*/
+#define SC_A              0x1E
+#define SC_BACKSPACE      0x0E
+#define SC_RELEASE        0x80
+
+uint8_t bench_names[MAX_DENTRY][FNAME_MAX_LEN + 1];
+uint32_t bench_num_names;
+static uint8_t read_buf[READ_CHUNK];
+
+/*Lookups lookup_bytewise found. Nothing reads it, but as somewhere its
+ *answers go, an optimizing compiler (the harness's) can't drop the calls*/
+static volatile uint32_t bytewise_found;
+
+/* bench_init
+ * DESCRIPTION:   Copies every file name out of the mounted filesystem,
+ *                NUL terminated, for the lookups to go round.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ */
+void bench_init(void){
+      uint32_t i;
+
+      bench_num_names = filesys_begin->num_dir_entries;
+      if(bench_num_names > MAX_DENTRY){
+            bench_num_names = MAX_DENTRY;
+      }
+      for(i = 0; i < bench_num_names; i++){
+            (void)memcpy(bench_names[i], filesys_begin->directory_entries[i].file_name, FNAME_MAX_LEN);
+            bench_names[i][FNAME_MAX_LEN] = '\0';
+      }
+      return;
+}
+
+/* bench_lookup
+ * DESCRIPTION:   read_dentry_by_name, going round every file name.
+ * INPUTS:        ops - lookups
+ * OUTPUTS:       0
+ */
+uint32_t bench_lookup(uint32_t ops, uint32_t size){
+      dentry_t dentry;
+      uint32_t i;
+
+      for(i = 0; i < ops; i++){
+            (void)read_dentry_by_name(bench_names[i % bench_num_names], &dentry);
+      }
+      return 0;
+}
+
+/* lookup_bytewise
+ * DESCRIPTION:   read_dentry_by_name as it was before the word-at-a-time
+ *                helpers: byte loops for the length check, the compare
+ *                and the copy. Kept only as bench_lookup's baseline.
+ * INPUTS:        fname - the name
+ *                dentry - filled in if it is found
+ * OUTPUTS:       0 if found, -1 if not
+ */
+static int32_t lookup_bytewise(const uint8_t * fname, dentry_t * dentry){
+      int32_t len;
+      int i;
+      int j;
+
+      for(len = 0; fname[len] != '\0'; len++);
+      if(len > FNAME_MAX_LEN){
+            return -1;
+      }
+
+      for(i = 0; i < MAX_DENTRY; i++){
+            const uint8_t * a = filesys_begin->directory_entries[i].file_name;
+            for(j = 0; j < FNAME_MAX_LEN; j++){
+                  if(a[j] != fname[j] || a[j] == 0){
+                        break;
+                  }
+            }
+            if(j == FNAME_MAX_LEN || a[j] == fname[j]){
+                  for(j = 0; j < FNAME_MAX_LEN; j++){
+                        dentry->file_name[j] = a[j];
+                  }
+                  dentry->file_type = filesys_begin->directory_entries[i].file_type;
+                  dentry->inode_num = filesys_begin->directory_entries[i].inode_num;
+                  return 0;
+            }
+      }
+      return -1;
+}
+
+/* bench_lookup_bytewise
+ * DESCRIPTION:   bench_lookup with lookup_bytewise instead.
+ * INPUTS:        ops - lookups
+ * OUTPUTS:       0
+ */
+uint32_t bench_lookup_bytewise(uint32_t ops, uint32_t size){
+      dentry_t dentry;
+      uint32_t i;
+
+      for(i = 0; i < ops; i++){
+            if(lookup_bytewise(bench_names[i % bench_num_names], &dentry) == 0){
+                  bytewise_found++;
+            }
+      }
+      return 0;
+}
+
+/* bench_read_data
+ * DESCRIPTION:   Reads the largest file through read_data, READ_CHUNK
+ *                bytes at a time.
+ * INPUTS:        ops - times to read all of it
+ * OUTPUTS:       bytes read
+ */
+uint32_t bench_read_data(uint32_t ops, uint32_t size){
+      uint32_t inode = 0;
+      uint32_t length = 0;
+      uint32_t bytes = 0;
+      uint32_t offset;
+      uint32_t i;
+      int32_t got;
+
+      for(i = 0; i < bench_num_names; i++){
+            uint32_t n = filesys_begin->directory_entries[i].inode_num;
+            if(filesys_begin->directory_entries[i].file_type == FILE_TYPE_REGULAR &&
+               inodes_begin[n].length > length){
+                  inode = n;
+                  length = inodes_begin[n].length;
+            }
+      }
+
+      for(i = 0; i < ops; i++){
+            for(offset = 0; offset < length; offset += got){
+                  got = read_data(inode, offset, read_buf, READ_CHUNK);
+                  if(got <= 0){
+                        break;
+                  }
+                  bytes += got;
+            }
+      }
+      return bytes;
+}
+
+/* bench_keyboard_echo
+ * DESCRIPTION:   A key typed and erased: four scancodes through the
+ *                keyboard bottom half, echoing a character and then
+ *                backspacing over it, so the line never fills up.
+ * INPUTS:        ops - keys
+ * OUTPUTS:       0
+ */
+uint32_t bench_keyboard_echo(uint32_t ops, uint32_t size){
+      uint32_t i;
+
+      for(i = 0; i < ops; i++){
+            keyboard_inject(SC_A);
+            keyboard_inject(SC_A | SC_RELEASE);
+            keyboard_inject(SC_BACKSPACE);
+            keyboard_inject(SC_BACKSPACE | SC_RELEASE);
+            cli();
+            run_bottom_halves();
+            sti();
+      }
+      return 0;
+}
+
+/* bench_console_scroll
+ * DESCRIPTION:   Full lines written to the terminal. Once the screen is
+ *                full, which the warmup run sees to, every one scrolls it.
+ * INPUTS:        ops - lines
+ * OUTPUTS:       0
+ */
+uint32_t bench_console_scroll(uint32_t ops, uint32_t size){
+      uint8_t line[VGA_WIDTH + 1];
+      unsigned long flags;
+      uint32_t i;
+
+      (void)memset(line, '#', VGA_WIDTH);
+      line[VGA_WIDTH] = '\n';
+
+      for(i = 0; i < ops; i++){
+            cli_and_save(flags);
+            print_term(line, VGA_WIDTH + 1);
+            restore_flags(flags);
+      }
+      return 0;
+}
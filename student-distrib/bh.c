@@ -0,0 +1,86 @@
+/*bh.c
+ *Deferred interrupt work. A device interrupt handler (the top half) only
+ *does what has to happen with interrupts off - talking to the device and
+ *queueing what it got - and raises its bottom half. The dispatcher runs
+ *pending bottom halves on the way out of the interrupt with interrupts
+ *back on, so a burst of keystrokes being echoed doesn't hold off the
+ *timer. Bottom halves run one at a time, on the stack of whatever was
+ *interrupted; an interrupt taken while they run only raises more work
+ *for the loop below, and preemption is off until they are done, so they
+ *must not sleep.
+ */
+
+#include "bh.h"
+#include "lib.h"
+#include "spinlock.h"
+#include "smp.h"
+
+/*1 while run_bottom_halves is running them*/
+static volatile uint32_t bh_active = 0;
+
+/*bottom halves raised and not run yet, one bit per BH_ number*/
+static volatile uint32_t bh_pending = 0;
+
+static void (*bh_table[NUM_BH])(void);
+
+/* bh_install
+ * DESCRIPTION:   Sets the function run for a bottom half.
+ * INPUTS:        nr - the BH_ number
+ *                handler - run with interrupts on after bh_raise(nr)
+ * OUTPUTS:       none
+ */
+void bh_install(uint32_t nr, void (*handler)(void)){
+      if(nr < NUM_BH){
+            bh_table[nr] = handler;
+      }
+      return;
+}
+
+/* bh_raise
+ * DESCRIPTION:   Marks a bottom half to run before the interrupt returns.
+ *                Called by top halves, with interrupts off.
+ * INPUTS:        nr - the BH_ number
+ * OUTPUTS:       none
+ */
+void bh_raise(uint32_t nr){
+      if(nr < NUM_BH){
+            bh_pending |= (1 << nr);
+      }
+      return;
+}
+
+/* run_bottom_halves
+ * DESCRIPTION:   Runs every pending bottom half, including ones raised
+ *                while doing so. Does nothing if it is already running
+ *                further down the stack: that call picks the new work up.
+ *                Called with interrupts off, returns with them off.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ */
+void run_bottom_halves(void){
+      uint32_t pending;
+      uint32_t nr;
+
+      //device interrupts all go to CPU 0, and so does their work
+      if(bh_active || this_cpu()->id != 0){
+            return;
+      }
+      bh_active = 1;
+      preempt_disable();
+
+      while((pending = bh_pending) != 0){
+            bh_pending = 0;
+            sti();
+            for(nr = 0; nr < NUM_BH; nr++){
+                  if((pending & (1 << nr)) && bh_table[nr] != NULL){
+                        bh_table[nr]();
+                  }
+            }
+            cli();
+      }
+
+      //interrupts are off: the dispatcher does any switch this put off
+      preempt_enable();
+      bh_active = 0;
+      return;
+}
@@ -0,0 +1,21 @@
+/* bh.h: Header file for deferred interrupt work (bottom halves) */
+#ifndef _BH_H
+#define _BH_H
+
+#include "types.h"
+
+/* Bottom halves, one bit each in the pending mask */
+#define BH_KEYBOARD       0
+#define BH_RTC            1
+#define NUM_BH            2
+
+/* Sets the function run for a bottom half */
+void bh_install(uint32_t nr, void (*handler)(void));
+
+/* Marks a bottom half to run when the interrupt returns */
+void bh_raise(uint32_t nr);
+
+/* Runs the pending bottom halves with interrupts on; called with them off */
+void run_bottom_halves(void);
+
+#endif  /* _BH_H */
@@ -2,9 +2,16 @@
 #include "filesys.h"
 #include "multiboot.h"
 
+/*bytes of a dentry that match the start of a dirent_t: name, type, inode*/
+#define DIRENT_COPY_LEN (FNAME_MAX_LEN + 2 * sizeof(uint32_t))
+/*a file name as 32-bit words*/
+#define FNAME_WORDS (FNAME_MAX_LEN / sizeof(uint32_t))
+
 int32_t stringcompare(const uint8_t * a, const uint8_t * b, int cmplen);
 int32_t stringlength(const uint8_t * string);
 void fnamecopy(const uint8_t * source, uint8_t * dest);
+static int32_t fname_key(const uint8_t * fname, uint32_t * key);
+static int32_t fname_match(const uint8_t * name, const uint32_t * key);
 
 
 
@@ -36,22 +43,25 @@ void init_filesys(boot_block_t * bb){
  *                the file.
  */
 int32_t read_dentry_by_name(const uint8_t * fname, dentry_t * dentry){
+      uint32_t key[FNAME_WORDS];
       int i = 0;
 
-      /*Check to ensure the name argument isn't too long*/
-      if(stringlength(fname) > FNAME_MAX_LEN){
+      /*Check for NULL pointers*/
+      if(fname == NULL || dentry == NULL){
             return -1;
       }
 
-      /*Check for NULL pointers*/
-      if(fname == NULL || dentry == NULL){
+      /*Check to ensure the name argument isn't too long, and pad it out
+       *to a whole name once so every entry is compared a word at a time*/
+      if(fname_key(fname, key)){
             return -1;
       }
 
-      /*Iterate through the boot block and search for the dentry with the same name*/
-      while(i < MAX_DENTRY){
+      /*Iterate through the boot block and search for the dentry with the same
+       *name. The unused entries past the last one have empty names.*/
+      while(i < filesys_begin->num_dir_entries && i < MAX_DENTRY){
             /*If we have a match, copy it into dentry and leave*/
-            if(!stringcompare((uint8_t *)&(filesys_begin->directory_entries[i]), fname, FNAME_MAX_LEN)){
+            if(!fname_match(filesys_begin->directory_entries[i].file_name, key)){
                   fnamecopy(filesys_begin->directory_entries[i].file_name, dentry->file_name);
                   dentry->file_type = filesys_begin->directory_entries[i].file_type;
                   dentry->inode_num = filesys_begin->directory_entries[i].inode_num;
@@ -82,7 +92,7 @@ int32_t read_dentry_by_index(uint32_t index, dentry_t * dentry){
       }
 
       /*Check to ensure the index is in the bounds*/
-      if(index > filesys_begin->num_dir_entries){
+      if(index >= filesys_begin->num_dir_entries){
             return -1;
       }
 
@@ -116,7 +126,7 @@ int32_t read_data(uint32_t inode, uint32_t offset, uint8_t * buf, uint32_t lengt
       int bytes_read = 0;
 
       //ensure we're not out of bounds
-      if(inode > filesys_begin->num_inodes){
+      if(inode >= filesys_begin->num_inodes){
             return -1;
       }
 
@@ -129,7 +139,7 @@ int32_t read_data(uint32_t inode, uint32_t offset, uint8_t * buf, uint32_t lengt
       for(i = 0; i < length; i++){
 
             //check to ensure we're not reading data that doesn't exist
-            if(offset + bytes_read > inode_ptr->length){
+            if(offset + bytes_read >= inode_ptr->length){
                   break;
             }
 
@@ -146,6 +156,108 @@ int32_t read_data(uint32_t inode, uint32_t offset, uint8_t * buf, uint32_t lengt
       return bytes_read;
 }
 
+/* stat_dentry
+ * Fills in the metadata of the file described by a dentry: type, inode,
+ * length, and the number of data blocks the file occupies. Directories
+ * report the length of the name stream that dir_read produces.
+ * INPUTS         dentry - the dentry of the file
+ *                st - where the metadata is to be written
+ * OUTPUTS        returns 0 on success and -1 on failure
+ * SIDE EFFECTS   fills st
+ */
+int32_t stat_dentry(const dentry_t * dentry, file_stat_t * st){
+      /*Check for NULL pointers*/
+      if(dentry == NULL || st == NULL){
+            return -1;
+      }
+
+      st->file_type = dentry->file_type;
+      st->inode_num = dentry->inode_num;
+      st->length = 0;
+      st->num_blocks = 0;
+
+      switch(dentry->file_type){
+            case FILE_TYPE_REGULAR:
+                  //ensure we're not out of bounds
+                  if(dentry->inode_num >= num_inodes){
+                        return -1;
+                  }
+                  st->length = inodes_begin[dentry->inode_num].length;
+                  st->num_blocks = (st->length + FOURKB - 1) / FOURKB;
+                  break;
+            case FILE_TYPE_DIR:
+                  st->length = filesys_begin->num_dir_entries * FNAME_MAX_LEN;
+                  break;
+            default:
+                  break;
+      }
+      return 0;
+}
+
+/* dir_read_stat
+ * Copies as many directory entries as fit into records, each with its name
+ * and its metadata, so a listing doesn't need an open/read/close per file.
+ * INPUTS         index - the first dentry index to copy
+ *                records - the array to fill
+ *                count - the number of records that fit in the array
+ * OUTPUTS        returns the number of records filled, 0 at the end of the
+ *                directory, and -1 on failure
+ * SIDE EFFECTS   fills records
+ */
+int32_t dir_read_stat(uint32_t index, dirent_stat_t * records, uint32_t count){
+      uint32_t filled = 0;
+      dentry_t * entry;
+
+      /*Check for NULL pointer*/
+      if(records == NULL){
+            return -1;
+      }
+
+      while(filled < count && index < filesys_begin->num_dir_entries){
+            entry = &(filesys_begin->directory_entries[index]);
+            fnamecopy(entry->file_name, records[filled].file_name);
+            if(stat_dentry(entry, &(records[filled].stat))){
+                  return -1;
+            }
+            filled++;
+            index++;
+      }
+
+      return filled;
+}
+
+/* dir_read_entries
+ * Fills records with as many directory entries as fit. The name, type and
+ * inode of each entry are moved with one block copy straight out of the
+ * boot block, and only the name length is computed.
+ * INPUTS         index - the first dentry index to copy
+ *                records - the array to fill
+ *                count - the number of records that fit in the array
+ * OUTPUTS        returns the number of records filled, 0 at the end of the
+ *                directory, and -1 on failure
+ * SIDE EFFECTS   fills records
+ */
+int32_t dir_read_entries(uint32_t index, dirent_t * records, uint32_t count){
+      uint32_t filled = 0;
+      uint32_t len;
+
+      /*Check for NULL pointer*/
+      if(records == NULL){
+            return -1;
+      }
+
+      while(filled < count && index < filesys_begin->num_dir_entries){
+            memcpy(&(records[filled]), &(filesys_begin->directory_entries[index]), DIRENT_COPY_LEN);
+            /*names that fill all 32 bytes have no null-termination*/
+            for(len = 0; len < FNAME_MAX_LEN && records[filled].file_name[len] != '\0'; len++);
+            records[filled].name_len = len;
+            filled++;
+            index++;
+      }
+
+      return filled;
+}
+
 int32_t file_open(const uint8_t * fname){
       return 0;
 }
@@ -230,7 +342,8 @@ int32_t dir_close(int32_t fd){
 
 /* stringcompare
  * Compares the contents of two strings up to a given point
- * specified by int cmplen
+ * specified by int cmplen. Strings at the same offset from a word
+ * boundary are compared a word at a time once aligned (see strncmp)
  * INPUTS:        a and b - the two strings to compare
  *                cmplen - by how many values to compare them
  * OUTPUTS:       returns 0 when strings are equal and 1
@@ -238,25 +351,7 @@ int32_t dir_close(int32_t fd){
  * SIDE EFFECTS:  NONE
  */
 int32_t stringcompare(const uint8_t * a, const uint8_t * b, int cmplen){
-      int i = 0;
-
-      /*Iterate through the strings and compare*/
-      while(i < cmplen){
-            /*If they're different, return 1*/
-            if(a[i] != b[i]){
-                  return 1;
-            }
-            /*If we have reached the end of the strings and they are
-             *equal, return 0 */
-            if(a[i] == 0 || b[i] == 0){
-                  return 0;
-            }
-            i++;
-      }
-
-      /*If we have made it through the list with no issue,
-       * the two strings are equal, so we can return 0*/
-      return 0;
+      return strncmp((const int8_t *)a, (const int8_t *)b, cmplen) != 0;
 }
 
 /* stringlength
@@ -266,21 +361,80 @@ int32_t stringcompare(const uint8_t * a, const uint8_t * b, int cmplen){
  * SIDE EFFECTS:  NONE
  */
 int32_t stringlength(const uint8_t * string){
-      int32_t length;
-      /*Loop through the string and count the length*/
-      for(length = 0; string[length] != NULL; length++);
-      /*Now return the length*/
-      return length;
+      return (int32_t)strlen((const int8_t *)string);
 }
 
 /*fnamecopy
  *This function takes two strings as argument and copies the contents
- *of source into destination. It returns nothing.
+ *of source into destination, a word at a time. It returns nothing.
  */
 void fnamecopy(const uint8_t * source, uint8_t * dest){
+      const uint32_t * s = (const uint32_t *)source;
+      uint32_t * d = (uint32_t *)dest;
       int i;
-      for(i = 0; i < FNAME_MAX_LEN; i++){
-            dest[i] = source[i];
+      for(i = 0; i < FNAME_WORDS; i++){
+            d[i] = s[i];
       }
       return;
 }
+
+/* fname_key
+ * Turns a name being looked up into the words fname_match compares
+ * against: the name, zero padded to FNAME_MAX_LEN.
+ * INPUTS:        fname - the name
+ *                key - FNAME_WORDS words to fill in
+ * OUTPUTS:       0, or -1 if the name is too long for a dentry
+ * SIDE EFFECTS:  NONE
+ */
+static int32_t fname_key(const uint8_t * fname, uint32_t * key){
+      uint32_t len = strlen((const int8_t *)fname);
+      int i;
+
+      if(len > FNAME_MAX_LEN){
+            return -1;
+      }
+      for(i = 0; i < FNAME_WORDS; i++){
+            key[i] = 0;
+      }
+      (void)memcpy(key, fname, len);
+      return 0;
+}
+
+/* fname_match
+ * stringcompare(name, key, FNAME_MAX_LEN) for a dentry name, a word at
+ * a time: names are equal up to the end of the shorter, and a dentry
+ * name that fills all 32 bytes has no terminator. Only the word where
+ * they first differ is looked at byte by byte, to see whether both had
+ * already ended.
+ * INPUTS:        name - a dentry's file_name, word aligned
+ *                key - the name looked for, from fname_key
+ * OUTPUTS:       0 when they are equal and 1 when they are different
+ * SIDE EFFECTS:  NONE
+ */
+static int32_t fname_match(const uint8_t * name, const uint32_t * key){
+      const uint32_t * w = (const uint32_t *)name;
+      const uint8_t * a;
+      const uint8_t * b;
+      int i;
+      int j;
+
+      for(i = 0; i < FNAME_WORDS; i++){
+            if(w[i] != key[i]){
+                  a = (const uint8_t *)&w[i];
+                  b = (const uint8_t *)&key[i];
+                  for(j = 0; j < sizeof(uint32_t); j++){
+                        if(a[j] != b[j]){
+                              return 1;
+                        }
+                        if(a[j] == 0){
+                              return 0;
+                        }
+                  }
+            }
+            /*both ended inside this word*/
+            if(HAS_ZERO_BYTE(key[i])){
+                  return 0;
+            }
+      }
+      return 0;
+}
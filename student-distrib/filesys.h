@@ -6,6 +6,13 @@
 #define FOURKB 4096
 #define FILENAME_MAXLEN 32
 
+/*file types stored in the dentries (terminal is only reported by fstat)*/
+#define FILE_TYPE_RTC 0
+#define FILE_TYPE_DIR 1
+#define FILE_TYPE_REGULAR 2
+#define FILE_TYPE_TERMINAL 3
+#define FILE_TYPE_PROC 4
+
 #include "types.h"
 #include "structures.h"
 
@@ -30,6 +37,15 @@ int32_t read_data(uint32_t inode, uint32_t offset, uint8_t * buf, uint32_t lengt
 //finds and records a dentry when given a numerical index
 int32_t read_dentry_by_index(uint32_t index, dentry_t * dentry);
 
+//fills in the metadata of the file a dentry describes
+int32_t stat_dentry(const dentry_t * dentry, file_stat_t * st);
+
+//fills an array with directory names and metadata, starting at a dentry index
+int32_t dir_read_stat(uint32_t index, dirent_stat_t * records, uint32_t count);
+
+//block-copies directory entries into getdents records, starting at a dentry index
+int32_t dir_read_entries(uint32_t index, dirent_t * records, uint32_t count);
+
 //compares to strings to check if they are equal
 int32_t stringcompare(const uint8_t * a, const uint8_t * b, int cmplen);
 
@@ -0,0 +1,301 @@
+/*fpu.c
+ *The FPU and SSE. fpu_init turns them on: SSE instructions raise #UD
+ *until CR4.OSFXSR says the kernel saves their state with FXSAVE. The
+ *kernel's own SSE code (the large memcpy and memset in lib.c) borrows a
+ *few XMM registers and puts them back, so whatever a process left in them
+ *survives.
+ *
+ *Processes' FPU state is switched lazily. task_switch only sets CR0.TS,
+ *and the first FPU or SSE instruction the next process runs traps (#NM).
+ *The trap saves the registers into the PCB of the process they belong to,
+ *the CPU's fpu_owner, and loads the current one's. A process that never
+ *touches the FPU never traps and never has anything saved, and one that
+ *is the only FPU user runs with TS clear and traps once. An owner isn't
+ *moved to another CPU (see can_steal in term_sched.c), so its state never
+ *has to follow it there.
+ */
+
+#include "fpu.h"
+#include "lib.h"
+#include "spinlock.h"
+#include "smp.h"
+#include "syscall.h"
+
+/*CPUID.1:EDX bits*/
+#define CPUID_FXSR        0x01000000
+#define CPUID_SSE         0x02000000
+#define CPUID_SSE2        0x04000000
+
+/*CR0 bits: monitor coprocessor, emulation, task switched, numeric error*/
+#define CR0_MP            0x00000002
+#define CR0_EM            0x00000004
+#define CR0_TS            0x00000008
+#define CR0_NE            0x00000020
+
+/*CR4 bits: FXSAVE/FXRSTOR and SSE, and #XM for SIMD exceptions*/
+#define CR4_OSFXSR        0x00000200
+#define CR4_OSXMMEXCPT    0x00000400
+
+/*MXCSR after reset: all SIMD exceptions masked, round to nearest*/
+#define MXCSR_DEFAULT     0x1F80
+
+uint32_t sse2_enabled = 0;
+
+/*What a process starts with: FNINIT's x87 state, MXCSR_DEFAULT and zeroed
+ *XMM registers, rather than whatever the last owner left*/
+static uint8_t fpu_init_state[FPU_STATE_SIZE] __attribute__((aligned(16)));
+
+/*Held to change any CPU's fpu_owner: a new process clears the ownership
+ *a dead one with its PID left behind, on whichever CPU that was*/
+static spinlock_t fpu_lock = SPINLOCK_INIT;
+
+static void fpu_save(uint8_t * area);
+static void fpu_restore(uint8_t * area);
+
+/* fpu_init
+ * DESCRIPTION:   Turns on the x87 FPU (no emulation, errors through #MF)
+ *                and, if CPUID reports FXSAVE and SSE2, SSE too. Called
+ *                on every CPU, before anything uses SSE.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ */
+void fpu_init(void){
+      uint32_t edx;
+      uint32_t cr0;
+      uint32_t cr4;
+
+      asm volatile("                \n\
+            MOVL $1, %%EAX          \n\
+            CPUID                   \n\
+            "
+            : "=d"(edx)
+            :
+            : "eax", "ebx", "ecx"
+      );
+
+      asm volatile("MOVL %%CR0, %0" : "=r"(cr0));
+      cr0 &= ~(CR0_EM | CR0_TS);
+      cr0 |= CR0_MP | CR0_NE;
+      asm volatile("MOVL %0, %%CR0" : : "r"(cr0));
+      asm volatile("FNINIT");
+
+      if((edx & CPUID_FXSR) && (edx & CPUID_SSE) && (edx & CPUID_SSE2)){
+            asm volatile("MOVL %%CR4, %0" : "=r"(cr4));
+            cr4 |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+            asm volatile("MOVL %0, %%CR4" : : "r"(cr4));
+            sse2_enabled = 1;
+      }
+
+      if(sse2_enabled){
+            uint32_t mxcsr = MXCSR_DEFAULT;
+            asm volatile("                \n\
+                  LDMXCSR %0              \n\
+                  PXOR %%XMM0, %%XMM0     \n\
+                  PXOR %%XMM1, %%XMM1     \n\
+                  PXOR %%XMM2, %%XMM2     \n\
+                  PXOR %%XMM3, %%XMM3     \n\
+                  PXOR %%XMM4, %%XMM4     \n\
+                  PXOR %%XMM5, %%XMM5     \n\
+                  PXOR %%XMM6, %%XMM6     \n\
+                  PXOR %%XMM7, %%XMM7     \n\
+                  "
+                  :
+                  : "m"(mxcsr)
+            );
+      }
+      fpu_save(fpu_init_state);
+
+      this_cpu()->fpu_owner = -1;
+      return;
+}
+
+/* fpu_save
+ * DESCRIPTION:   Saves the FPU registers: FXSAVE with SSE, which takes
+ *                the XMM registers too, otherwise FNSAVE, which also
+ *                reinitializes the FPU.
+ * INPUTS:        area - FPU_STATE_SIZE bytes, 16-byte aligned
+ * OUTPUTS:       none
+ */
+static void fpu_save(uint8_t * area){
+      if(sse2_enabled){
+            asm volatile("FXSAVE (%0)" : : "r"(area) : "memory");
+      }
+      else{
+            asm volatile("FNSAVE (%0)" : : "r"(area) : "memory");
+      }
+      return;
+}
+
+/* fpu_restore
+ * DESCRIPTION:   Loads what fpu_save saved.
+ * INPUTS:        area - the saved state
+ * OUTPUTS:       none
+ */
+static void fpu_restore(uint8_t * area){
+      if(sse2_enabled){
+            asm volatile("FXRSTOR (%0)" : : "r"(area) : "memory");
+      }
+      else{
+            asm volatile("FRSTOR (%0)" : : "r"(area) : "memory");
+      }
+      return;
+}
+
+/* fpu_init_task
+ * DESCRIPTION:   Sets up a new process' FPU state. An exec'd program or
+ *                thread starts clean, on its first trap; a forked child
+ *                gets a copy of the parent's, which is still in the
+ *                registers if the parent owns them. Also forgets a dead
+ *                process that owned the registers under the same PID.
+ * INPUTS:        pcb - the new process, PID filled in
+ *                parent - the process to copy, or NULL
+ * OUTPUTS:       none
+ */
+void fpu_init_task(PCB_t * pcb, PCB_t * parent){
+      cpu_t * cpu;
+      uint32_t flags;
+      int i;
+
+      spin_lock_irqsave(&fpu_lock, flags);
+      cpu = this_cpu();
+
+      for(i = 0; i < num_cpus; i++){
+            if(cpus[i].fpu_owner == pcb->PID){
+                  cpus[i].fpu_owner = -1;
+            }
+      }
+
+      pcb->fpu_used = 0;
+      if(parent != NULL && parent->fpu_used){
+            if(cpu->fpu_owner == parent->PID){
+                  //TS is clear while the owner runs
+                  fpu_save(pcb->fpu_state);
+                  if(!sse2_enabled){
+                        //FNSAVE wiped the parent's registers
+                        fpu_restore(pcb->fpu_state);
+                  }
+            }
+            else{
+                  (void)memcpy(pcb->fpu_state, parent->fpu_state, FPU_STATE_SIZE);
+            }
+            pcb->fpu_used = 1;
+      }
+
+      spin_unlock_irqrestore(&fpu_lock, flags);
+      return;
+}
+
+/* fpu_switch
+ * DESCRIPTION:   Called by task_switch, interrupts off. Sets CR0.TS so the
+ *                next process' first FPU instruction traps, unless the
+ *                registers already hold its state.
+ * INPUTS:        PID - the process being switched to
+ * OUTPUTS:       none
+ */
+void fpu_switch(int32_t PID){
+      uint32_t cr0;
+
+      asm volatile("MOVL %%CR0, %0" : "=r"(cr0));
+      if(this_cpu()->fpu_owner == PID){
+            if(cr0 & CR0_TS){
+                  asm volatile("CLTS");
+            }
+      }
+      else if(!(cr0 & CR0_TS)){
+            asm volatile("MOVL %0, %%CR0" : : "r"(cr0 | CR0_TS));
+      }
+      return;
+}
+
+/* fpu_trap
+ * DESCRIPTION:   The #NM handler, for a user process' first FPU or SSE
+ *                instruction since it was switched to. Saves the
+ *                registers for their owner and loads the process' state,
+ *                then the instruction is retried. Interrupts are off.
+ *                The process is found from the kernel stack the trap
+ *                came in on, since the first shell runs before the
+ *                scheduler has set the CPU's current.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ * RETURN VALUE:  0
+ */
+int32_t fpu_trap(void){
+      cpu_t * cpu = this_cpu();
+      PCB_t * pcb = get_pcb_ptr();
+
+      asm volatile("CLTS");
+      if(cpu->fpu_owner == pcb->PID){
+            return 0;
+      }
+
+      spin_lock(&fpu_lock);
+      if(cpu->fpu_owner != -1){
+            fpu_save(task_pcb[cpu->fpu_owner]->fpu_state);
+      }
+      fpu_restore(pcb->fpu_used ? pcb->fpu_state : fpu_init_state);
+      pcb->fpu_used = 1;
+      cpu->fpu_owner = pcb->PID;
+      spin_unlock(&fpu_lock);
+      return 0;
+}
+
+/* kernel_fpu_begin
+ * DESCRIPTION:   Lets the kernel use XMM0-XMM3: saves them in state, and
+ *                clears CR0.TS so touching them doesn't fault. Preemption
+ *                stays off until kernel_fpu_end, since the next process
+ *                would find the kernel's values in them. Interrupt
+ *                handlers may nest their own begin/end inside.
+ * INPUTS:        state - where to save them, usually on the stack
+ * OUTPUTS:       none
+ */
+void kernel_fpu_begin(kernel_fpu_t * state){
+      uint32_t cr0;
+
+      preempt_disable();
+
+      asm volatile("MOVL %%CR0, %0" : "=r"(cr0));
+      state->ts = cr0 & CR0_TS;
+      if(state->ts){
+            asm volatile("CLTS");
+      }
+
+      asm volatile("                \n\
+            MOVDQU %%XMM0, 0(%0)    \n\
+            MOVDQU %%XMM1, 16(%0)   \n\
+            MOVDQU %%XMM2, 32(%0)   \n\
+            MOVDQU %%XMM3, 48(%0)   \n\
+            "
+            :
+            : "r"(state->xmm)
+            : "memory"
+      );
+      return;
+}
+
+/* kernel_fpu_end
+ * DESCRIPTION:   Puts back what kernel_fpu_begin saved.
+ * INPUTS:        state - what it saved
+ * OUTPUTS:       none
+ */
+void kernel_fpu_end(kernel_fpu_t * state){
+      uint32_t cr0;
+
+      asm volatile("                \n\
+            MOVDQU 0(%0), %%XMM0    \n\
+            MOVDQU 16(%0), %%XMM1   \n\
+            MOVDQU 32(%0), %%XMM2   \n\
+            MOVDQU 48(%0), %%XMM3   \n\
+            "
+            :
+            : "r"(state->xmm)
+            : "memory"
+      );
+
+      if(state->ts){
+            asm volatile("MOVL %%CR0, %0" : "=r"(cr0));
+            asm volatile("MOVL %0, %%CR0" : : "r"(cr0 | CR0_TS));
+      }
+
+      preempt_enable();
+      return;
+}
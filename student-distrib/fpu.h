@@ -0,0 +1,35 @@
+/* fpu.h: Header file for the FPU and SSE */
+#ifndef _FPU_H
+#define _FPU_H
+
+#include "types.h"
+#include "structures.h"
+
+/* 1 once fpu_init found SSE2 and turned it on */
+extern uint32_t sse2_enabled;
+
+/* What kernel_fpu_begin saves: the XMM registers the kernel's SSE code
+ * uses, and whether CR0.TS was set */
+#define KERNEL_XMM_REGS   4
+typedef struct kernel_fpu {
+      uint8_t xmm[KERNEL_XMM_REGS * 16];
+      uint32_t ts;
+} kernel_fpu_t;
+
+/* Turns on the FPU and, if the processor has it, SSE. Once per CPU */
+void fpu_init(void);
+
+/* Gives a new process a fresh FPU state, or a copy of parent's for fork */
+void fpu_init_task(PCB_t * pcb, PCB_t * parent);
+
+/* Called by task_switch: sets CR0.TS unless PID's state is loaded */
+void fpu_switch(int32_t PID);
+
+/* #NM handler: loads the current process' FPU state. 0 if it did */
+int32_t fpu_trap(void);
+
+/* Brackets kernel code using XMM0-XMM3; no switching away in between */
+void kernel_fpu_begin(kernel_fpu_t * state);
+void kernel_fpu_end(kernel_fpu_t * state);
+
+#endif  /* _FPU_H */
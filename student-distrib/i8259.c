@@ -141,3 +141,16 @@ void send_eoi(uint32_t irq_num) {
         outb(EOI | irq_num, MASTER_8259_PORT);
     }
 }
+
+/* Get the mask of both PICs: bit n set if IRQ n is disabled */
+uint16_t i8259_get_mask(void) {
+    return (uint16_t)(inb(MASTER_8259_PORT + 1) | (inb(SLAVE_8259_PORT + 1) << 8));
+}
+
+/* Disable every IRQ, when the IOAPIC takes over */
+void i8259_mask_all(void) {
+    master_mask = 0xFF;
+    slave_mask = 0xFF;
+    outb(slave_mask, SLAVE_8259_PORT + 1);
+    outb(master_mask, MASTER_8259_PORT + 1);
+}
@@ -42,5 +42,9 @@ void enable_irq(uint32_t irq_num);
 void disable_irq(uint32_t irq_num);
 /* Send end-of-interrupt signal for the specified IRQ */
 void send_eoi(uint32_t irq_num);
+/* Get the mask of both PICs: bit n set if IRQ n is disabled */
+uint16_t i8259_get_mask(void);
+/* Disable every IRQ, when the IOAPIC takes over */
+void i8259_mask_all(void);
 
 #endif /* _I8259_H */
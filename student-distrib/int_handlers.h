@@ -8,6 +8,8 @@
 #include "lib.h"
 #include "i8259.h"
 #include "rtc.h"
+#include "klog.h"
+#include "serial.h"
 
 #define VIDEO 0xB8000
 #define NUM_COLS 80
@@ -15,7 +17,9 @@
 #define RED 0xC
 
 /*RSOD()
- *Clears the screen and produces a scary error saying what went wrong
+ *Clears the screen and produces a scary error saying what went wrong.
+ *The error goes to the kernel log too, sent right away since the handlers
+ *halt with interrupts off and the serial interrupt would never come.
  */
 void RSOD(char * error){
       int screen_x, screen_y; /*Position on screen*/
@@ -45,6 +49,10 @@ void RSOD(char * error){
             *(uint8_t *)(video_mem + ((NUM_COLS * screen_y + screen_x) << 1) + 1) = RED;
             screen_x++;
       }
+
+      klog_puts(error);
+      klog_puts("\n");
+      serial_flush();
       return;
 }
 
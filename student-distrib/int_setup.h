@@ -3,11 +3,26 @@
  * related functions for use in kernel and other programs.
  */
 
+#include "types.h"
+
+/*Number of IDT vectors, plus the one default_linkage reports*/
+#define NUM_VECTORS 257
+
+/*vector_count[n] is how many times vector n was taken since boot*/
+extern uint32_t vector_count[NUM_VECTORS];
+
  /*int_setup() initializes the IDT and sets up the exception handlers*/
 void int_setup();
 
-/*C_int_dispatcher(UL) is the file that calls the interrupt handlers*/
-void C_int_dispatcher(unsigned long interrupt);
+/*C_int_dispatcher() calls the interrupt handlers; its arguments are the
+ *frame int_setup.S builds (see hw_context_t in signal.h)
+ */
+void C_int_dispatcher(unsigned long EBX, unsigned long ECX, unsigned long EDX,
+                      unsigned long ESI, unsigned long EDI, unsigned long EBP,
+                      unsigned long EAX, unsigned long DS, unsigned long ES,
+                      unsigned long FS, unsigned long vector_num,
+                      unsigned long error_code, unsigned long EIP,
+                      unsigned long CS, unsigned long EFLAGS);
 
 /*install_handler() installs a handler when given a pointer to a function*/
 void install_handler(int vector_number, void handler());
@@ -12,7 +12,26 @@
 #include "keyboard.h"
 #include "syscall.h"
 #include "pit.h"
+#include "signal.h"
+#include "paging.h"
+#include "tick.h"
+#include "term_sched.h"
+#include "acct.h"
+#include "smp.h"
+#include "irqstat.h"
+#include "bh.h"
+#include "int_setup.h"
+#include "fpu.h"
+#include "serial.h"
 
+/*Requested privilege level of a user-mode code segment*/
+#define USER_RPL 0x3
+/*Device-not-available vector: an FPU instruction with CR0.TS set*/
+#define DEVICE_NOT_AVAILABLE 7
+/*Page fault vector*/
+#define PAGE_FAULT 14
+/*First vector the interrupt controllers deliver device interrupts on*/
+#define FIRST_IRQ_VECTOR 0x20
 /*Total number of Intel-Defined interrupts*/
 #define NUM_INTEL_INTERRUPTS 30
 /*Total number of possible interrupt vectors (even though most will be unused)*/
@@ -24,11 +43,14 @@
  */
 extern void * assembly_linkage[NUM_INTEL_INTERRUPTS];
 
-/*These are the linkage files for the keyboard and RTC*/
-extern void keyboard();
-extern void RTC();
+/*irq_linkage is the same for the device interrupt vectors, entry n
+ *being vector FIRST_IRQ_VECTOR + n. Those go straight to the dispatcher
+ *without touching the segment registers when the kernel was interrupted.
+ */
+extern void * irq_linkage[TOTAL_VECTOR_NUM - FIRST_IRQ_VECTOR];
+
+/*This is the linkage for the system call trap*/
 extern void SYSC();
-extern void PIT();
 
 /*defualt_linkage is an external function that pushes 256 and then
  *calls common_interrupt. Because the highest possible vector number
@@ -44,6 +66,9 @@ extern void default_linkage();
 
 void (*handler_table[TOTAL_VECTOR_NUM+1])();
 
+/*How many times each vector was taken, shown by proc/interrupts*/
+uint32_t vector_count[TOTAL_VECTOR_NUM+1];
+
 void install_idt_entry(int idt_offset, void handler());
 void install_trap_entry(int idt_offset, void handler());
 void RSOD(char * error);
@@ -77,9 +102,12 @@ void int_setup(){
             install_idt_entry(i, &default_linkage);
       }
 
-      install_idt_entry(0x20, &PIT);
-      install_idt_entry(0x21, &keyboard);
-      install_idt_entry(0x28, &RTC);
+      /*Every device vector gets its own stub, so an interrupt nobody
+       *installed a handler for still shows up under its own number
+       */
+      for(i = FIRST_IRQ_VECTOR; i < TOTAL_VECTOR_NUM; i++){
+            install_idt_entry(i, irq_linkage[i - FIRST_IRQ_VECTOR]);
+      }
       install_trap_entry(0x80, &SYSC);
 
       /*Set up the first few interrupt vectors, which are intel
@@ -115,12 +143,19 @@ void int_setup(){
       install_handler(0x28, rtc_interrupt_handler);
       install_handler(0x21, keyboard_interrupt_handler);
       install_handler(0x20, pit_interrupt_handler);
+      install_handler(0x24, serial_interrupt_handler);
+      install_handler(RESCHED_VECTOR, resched_interrupt_handler);
 }
 
 /*C_int_Dispatcher is called whenever an interrupt occurs. The
  *linkage gives this function the vector number as argument so
  *this function then then calls the handler associated with this
- *interrupt vector
+ *interrupt vector. Exceptions raised by user code are turned into
+ *signals for the running process instead of stopping the kernel.
+ *Every call is timed into the vector's histogram (see irqstat.c), unless
+ *the handler switched to another process on the way, in which case the
+ *time would include that process running. Device interrupts then run
+ *the bottom halves their handlers raised (see bh.c), with interrupts on.
  */
 void C_int_dispatcher(  unsigned long EBX,
                         unsigned long ECX,
@@ -132,15 +167,72 @@ void C_int_dispatcher(  unsigned long EBX,
                         unsigned long DS,
                         unsigned long ES,
                         unsigned long FS,
-                        unsigned long vector_num){
+                        unsigned long vector_num,
+                        unsigned long error_code,
+                        unsigned long EIP,
+                        unsigned long CS,
+                        unsigned long EFLAGS){
+      cpu_t * cpu = this_cpu();
+      uint32_t start = rdtsc_lo();
+      uint32_t switches = nr_switches;
+      int32_t slot = irqstat_slot(vector_num);
+
+      //interrupt gates turn interrupts off; the syscall gate doesn't
+      if(vector_num != 0x80){
+            irqoff_begin();
+      }
+
+      vector_count[vector_num]++;
+
+      //charge the fault to whoever is running
+      if(vector_num == PAGE_FAULT && cpu->current != -1){
+            get_pcb_ptr()->acct.faults++;
+      }
+
       //special case - handle a syscall
       if(vector_num == 0x80){
-            EAX = syscall_dispatcher(EAX, EBX, ECX, EDX);
+            EAX = syscall_dispatcher(EAX, EBX, ECX, EDX, ESI);
+      }
+      //write to a copy-on-write page - copy it and retry the write
+      else if(vector_num == PAGE_FAULT && cow_fault(error_code) == 0){
+            //the write is retried on return
+      }
+      //first FPU use since the switch - load the process' FPU state
+      else if(vector_num == DEVICE_NOT_AVAILABLE && (CS & USER_RPL) == USER_RPL &&
+              fpu_trap() == 0){
+            //the instruction is retried on return
+      }
+      //user code faulted - signal the process
+      else if(vector_num < NUM_INTEL_INTERRUPTS && (CS & USER_RPL) == USER_RPL &&
+              signal_exception(vector_num) == 0){
+            //the signal is delivered on return
       }
       //otherwise we have just a normal interrupt
       else{
+            if(vector_num >= FIRST_IRQ_VECTOR){
+                  nr_interrupts++;
+                  cpu->irq_from_user = ((CS & USER_RPL) == USER_RPL);
+            }
             handler_table[vector_num]();
       }
+
+      if(nr_switches == switches){
+            irqstat_record(slot, rdtsc_lo() - start);
+      }
+      else{
+            irqstat[slot].switched++;
+      }
+
+      if(vector_num >= FIRST_IRQ_VECTOR && vector_num != 0x80){
+            run_bottom_halves();
+            //the interrupt may have woken a process that should run first
+            sched_preempt();
+      }
+
+      //IRET turns interrupts back on if they were on before
+      if(EFLAGS & EFLAGS_IF_BIT){
+            irqoff_end();
+      }
       return;
 }
 
@@ -0,0 +1,143 @@
+/*ioapic.c
+ *Driver for the IOAPIC, which replaces the two 8259s when the MP table
+ *lists one. Each of its pins has a redirection entry giving the vector and
+ *the CPU an interrupt is sent to; ISA IRQ n keeps vector 0x20 + n, so the
+ *IDT is the same with either controller.
+ */
+
+#include "ioapic.h"
+#include "lib.h"
+#include "smp.h"
+
+/*the IOAPIC is reached through an index and a data register*/
+#define IOREGSEL          0x00
+#define IOWIN             0x10
+/*register indexes*/
+#define IOAPIC_VERSION    0x01
+#define IOAPIC_REDIR      0x10
+/*redirection entry fields*/
+#define REDIR_MASKED      0x00010000
+#define REDIR_LEVEL       0x00008000
+#define REDIR_ACTIVE_LOW  0x00002000
+#define REDIR_DEST_SHIFT  24
+/*bits 16-23 of the version register: number of pins - 1*/
+#define MAX_REDIR_SHIFT   16
+#define BYTE_MASK         0xFF
+/*vector of ISA IRQ 0*/
+#define ISA_VECTOR_BASE   0x20
+
+uint32_t ioapic_addr = 0;
+
+/*pin and MP flags of every ISA IRQ; without an MP entry, IRQ n is on pin n*/
+static uint8_t isa_pin[NUM_ISA_IRQS] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+static uint8_t isa_flags[NUM_ISA_IRQS];
+
+static uint32_t ioapic_read(uint32_t reg);
+static void ioapic_write(uint32_t reg, uint32_t val);
+
+/* ioapic_read
+ * DESCRIPTION:   Reads an IOAPIC register.
+ * INPUTS:        reg - register index
+ * OUTPUTS:       its value
+ */
+static uint32_t ioapic_read(uint32_t reg){
+      *(volatile uint32_t *)(ioapic_addr + IOREGSEL) = reg;
+      return *(volatile uint32_t *)(ioapic_addr + IOWIN);
+}
+
+/* ioapic_write
+ * DESCRIPTION:   Writes an IOAPIC register.
+ * INPUTS:        reg - register index
+ *                val - value to write
+ * OUTPUTS:       none
+ */
+static void ioapic_write(uint32_t reg, uint32_t val){
+      *(volatile uint32_t *)(ioapic_addr + IOREGSEL) = reg;
+      *(volatile uint32_t *)(ioapic_addr + IOWIN) = val;
+      return;
+}
+
+/* ioapic_set_isa_route
+ * DESCRIPTION:   Called by smp_init for every ISA interrupt entry of the
+ *                MP table, e.g. the timer (IRQ 0) wired to pin 2.
+ * INPUTS:        irq - the ISA IRQ
+ *                pin - the IOAPIC input it is wired to
+ *                flags - MP polarity and trigger mode
+ * OUTPUTS:       none
+ */
+void ioapic_set_isa_route(uint32_t irq, uint32_t pin, uint32_t flags){
+      if(irq >= NUM_ISA_IRQS){
+            return;
+      }
+      isa_pin[irq] = pin;
+      isa_flags[irq] = flags;
+      return;
+}
+
+/* ioapic_init
+ * DESCRIPTION:   Masks every pin, then fills in the entries of the ISA IRQs
+ *                (still masked) with their vectors, polarity and trigger
+ *                mode, delivered to CPU 0. ISA interrupts are active high
+ *                and edge triggered unless the MP table says otherwise.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ */
+void ioapic_init(void){
+      uint32_t pins;
+      uint32_t entry;
+      uint32_t i;
+
+      pins = ((ioapic_read(IOAPIC_VERSION) >> MAX_REDIR_SHIFT) & BYTE_MASK) + 1;
+      for(i = 0; i < pins; i++){
+            ioapic_write(IOAPIC_REDIR + 2 * i, REDIR_MASKED);
+            ioapic_write(IOAPIC_REDIR + 2 * i + 1, 0);
+      }
+
+      for(i = 0; i < NUM_ISA_IRQS; i++){
+            if(isa_pin[i] >= pins){
+                  continue;
+            }
+            entry = REDIR_MASKED | (ISA_VECTOR_BASE + i);
+            if((isa_flags[i] & MP_POLARITY_MASK) == MP_POLARITY_LOW){
+                  entry |= REDIR_ACTIVE_LOW;
+            }
+            if((isa_flags[i] & MP_TRIGGER_MASK) == MP_TRIGGER_LEVEL){
+                  entry |= REDIR_LEVEL;
+            }
+            ioapic_write(IOAPIC_REDIR + 2 * isa_pin[i] + 1, cpus[0].apic_id << REDIR_DEST_SHIFT);
+            ioapic_write(IOAPIC_REDIR + 2 * isa_pin[i], entry);
+      }
+      return;
+}
+
+/* ioapic_enable_irq
+ * DESCRIPTION:   Lets an ISA IRQ through.
+ * INPUTS:        irq - the ISA IRQ
+ * OUTPUTS:       none
+ */
+void ioapic_enable_irq(uint32_t irq){
+      uint32_t reg;
+
+      if(irq >= NUM_ISA_IRQS){
+            return;
+      }
+      reg = IOAPIC_REDIR + 2 * isa_pin[irq];
+      ioapic_write(reg, ioapic_read(reg) & ~REDIR_MASKED);
+      return;
+}
+
+/* ioapic_disable_irq
+ * DESCRIPTION:   Stops an ISA IRQ from being delivered.
+ * INPUTS:        irq - the ISA IRQ
+ * OUTPUTS:       none
+ */
+void ioapic_disable_irq(uint32_t irq){
+      uint32_t reg;
+
+      if(irq >= NUM_ISA_IRQS){
+            return;
+      }
+      reg = IOAPIC_REDIR + 2 * isa_pin[irq];
+      ioapic_write(reg, ioapic_read(reg) | REDIR_MASKED);
+      return;
+}
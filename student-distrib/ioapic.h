@@ -0,0 +1,29 @@
+/* ioapic.h: Header file for the IOAPIC driver */
+#ifndef _IOAPIC_H
+#define _IOAPIC_H
+
+#include "types.h"
+
+/* ISA IRQs the IOAPIC can be told about */
+#define NUM_ISA_IRQS        16
+
+/* MP table interrupt flags: polarity in bits 0-1, trigger mode in 2-3 */
+#define MP_POLARITY_MASK    0x3
+#define MP_POLARITY_LOW     0x3
+#define MP_TRIGGER_MASK     0xC
+#define MP_TRIGGER_LEVEL    0xC
+
+/* Physical address of the IOAPIC registers, 0 if there is none */
+extern uint32_t ioapic_addr;
+
+/* Records which IOAPIC pin an ISA IRQ is wired to (from the MP table) */
+void ioapic_set_isa_route(uint32_t irq, uint32_t pin, uint32_t flags);
+
+/* Masks every pin and points the ISA IRQs at their vectors on CPU 0 */
+void ioapic_init(void);
+
+/* Unmasks and masks the pin of an ISA IRQ */
+void ioapic_enable_irq(uint32_t irq);
+void ioapic_disable_irq(uint32_t irq);
+
+#endif  /* _IOAPIC_H */
@@ -0,0 +1,108 @@
+/*irq.c
+ *Drivers enable, disable and acknowledge their IRQ through these functions,
+ *which go to the IOAPIC and local APIC when smp_init found them, and to
+ *the 8259s otherwise. ISA IRQ n is vector 0x20 + n either way.
+ */
+
+#include "irq.h"
+#include "lib.h"
+#include "i8259.h"
+#include "ioapic.h"
+#include "lapic.h"
+#include "smp.h"
+
+/*the IMCR, which some chipsets use to connect the 8259s to CPU 0
+ *directly, bypassing the APICs*/
+#define IMCR_SELECT       0x22
+#define IMCR_DATA         0x23
+#define IMCR_REG          0x70
+#define IMCR_APIC         0x01
+
+int32_t irq_use_apic = 0;
+
+/* irq_init
+ * DESCRIPTION:   Moves IRQ delivery from the 8259s to the IOAPIC if there
+ *                is one and a local APIC to receive from it. IRQs that
+ *                drivers already enabled on the 8259s stay enabled. Must
+ *                run after smp_init.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ * SIDE EFFECTS:  masks every 8259 IRQ when it switches
+ */
+void irq_init(void){
+      unsigned long flags;
+      uint16_t pic_mask;
+      uint32_t i;
+
+      if(lapic == NULL || ioapic_addr == 0){
+            return;
+      }
+
+      cli_and_save(flags);
+
+      pic_mask = i8259_get_mask();
+      ioapic_init();
+      for(i = 0; i < NUM_ISA_IRQS; i++){
+            //IRQ 2 only cascades the slave 8259
+            if(i != SLAVE_IRQ_ON_MASTER && !(pic_mask & (1 << i))){
+                  ioapic_enable_irq(i);
+            }
+      }
+      i8259_mask_all();
+
+      if(imcr_present){
+            outb(IMCR_REG, IMCR_SELECT);
+            outb(IMCR_APIC, IMCR_DATA);
+      }
+
+      irq_use_apic = 1;
+      restore_flags(flags);
+      return;
+}
+
+/* irq_enable
+ * DESCRIPTION:   Unmasks an IRQ on whichever controller is in use.
+ * INPUTS:        irq_num - the IRQ
+ * OUTPUTS:       none
+ */
+void irq_enable(uint32_t irq_num){
+      if(irq_use_apic){
+            ioapic_enable_irq(irq_num);
+      }
+      else{
+            enable_irq(irq_num);
+      }
+      return;
+}
+
+/* irq_disable
+ * DESCRIPTION:   Masks an IRQ on whichever controller is in use.
+ * INPUTS:        irq_num - the IRQ
+ * OUTPUTS:       none
+ */
+void irq_disable(uint32_t irq_num){
+      if(irq_use_apic){
+            ioapic_disable_irq(irq_num);
+      }
+      else{
+            disable_irq(irq_num);
+      }
+      return;
+}
+
+/* irq_eoi
+ * DESCRIPTION:   Acknowledges an IRQ. With the APICs this is one write to
+ *                the local APIC, whichever IRQ it was, instead of one or
+ *                two port writes to the 8259s.
+ * INPUTS:        irq_num - the IRQ
+ * OUTPUTS:       none
+ */
+void irq_eoi(uint32_t irq_num){
+      if(irq_use_apic){
+            lapic_eoi();
+      }
+      else{
+            send_eoi(irq_num);
+      }
+      return;
+}
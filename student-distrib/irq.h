@@ -0,0 +1,20 @@
+/* irq.h: Header file for IRQ routing */
+#ifndef _IRQ_H
+#define _IRQ_H
+
+#include "types.h"
+
+/* 1 once the IOAPIC and local APIC deliver IRQs instead of the 8259s */
+extern int32_t irq_use_apic;
+
+/* Switches IRQ delivery to the IOAPIC when there is one */
+void irq_init(void);
+
+/* Enable (unmask) the specified IRQ */
+void irq_enable(uint32_t irq_num);
+/* Disable (mask) the specified IRQ */
+void irq_disable(uint32_t irq_num);
+/* Send end-of-interrupt signal for the specified IRQ */
+void irq_eoi(uint32_t irq_num);
+
+#endif  /* _IRQ_H */
@@ -0,0 +1,111 @@
+/*irqstat.c
+ *Where interrupt time goes. C_int_dispatcher times every handler with the
+ *TSC and files the duration under its vector in a log2 histogram, and the
+ *cli/sti macros in lib.h mark every stretch the CPU spends with interrupts
+ *off, from an interrupt gate or a cli() until the next sti(), restore or
+ *IRET. Long stretches there are what delays the keyboard and makes the RTC
+ *tick unevenly. A third kind is how long a process woken for input (see
+ *wake_up_interactive) waits before schedule runs it: what a user feels
+ *as lag. proc/irqstat shows them.
+ */
+
+#include "irqstat.h"
+#include "lib.h"
+#include "pit.h"
+
+/*How long the TSC is measured against the PIT*/
+#define CALIBRATE_MS      10
+#define US_PER_MS         1000
+
+lat_hist_t irqstat[NUM_IRQSTATS];
+
+const int8_t * irqstat_names[NUM_IRQSTATS] = {
+      "timer", "keyboard", "rtc", "syscall", "exception", "other", "irqoff",
+      "wakeup"
+};
+
+/*TSC cycles per microsecond, 0 until irqstat_init*/
+uint32_t tsc_per_us = 0;
+
+/*TSC when interrupts went off, 0 while they are on. The low bit is
+ *forced on so a real reading is never 0.*/
+static volatile uint32_t irqoff_since = 0;
+
+/* irqstat_init
+ * DESCRIPTION:   Counts TSC cycles over a PIT-timed delay, so the
+ *                histograms can be read in microseconds.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ * SIDE EFFECTS:  busy-waits CALIBRATE_MS
+ */
+void irqstat_init(void){
+      uint32_t start = rdtsc_lo();
+
+      pit_delay_ms(CALIBRATE_MS);
+      tsc_per_us = (rdtsc_lo() - start) / (CALIBRATE_MS * US_PER_MS);
+      return;
+}
+
+/* irqstat_slot
+ * DESCRIPTION:   Picks the histogram for a vector.
+ * INPUTS:        vector_num - from C_int_dispatcher
+ * OUTPUTS:       one of the IRQSTAT_ slots
+ */
+int32_t irqstat_slot(uint32_t vector_num){
+      switch(vector_num){
+            case TIMER_VECTOR:      return IRQSTAT_TIMER;
+            case TIMER_VECTOR + 1:  return IRQSTAT_KEYBOARD;
+            case TIMER_VECTOR + 8:  return IRQSTAT_RTC;
+            case 0x80:              return IRQSTAT_SYSCALL;
+            default:
+                  return (vector_num < TIMER_VECTOR) ? IRQSTAT_EXCEPTION : IRQSTAT_OTHER;
+      }
+}
+
+/* irqstat_record
+ * DESCRIPTION:   Adds a duration to a histogram.
+ * INPUTS:        slot - which one
+ *                cycles - how long, in TSC cycles
+ * OUTPUTS:       none
+ */
+void irqstat_record(int32_t slot, uint32_t cycles){
+      lat_hist_t * hist = &irqstat[slot];
+      uint32_t bucket = 0;
+
+      if(cycles != 0){
+            asm volatile("bsrl %1, %0" : "=r"(bucket) : "rm"(cycles) : "cc");
+      }
+      hist->bucket[bucket]++;
+      hist->count++;
+      if(cycles > hist->max){
+            hist->max = cycles;
+      }
+      return;
+}
+
+/* irqoff_begin
+ * DESCRIPTION:   Interrupts were just turned off. Nested calls keep the
+ *                first start.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ */
+void irqoff_begin(void){
+      if(irqoff_since == 0){
+            irqoff_since = rdtsc_lo() | 1;
+      }
+      return;
+}
+
+/* irqoff_end
+ * DESCRIPTION:   Interrupts are about to come back on: records how long
+ *                they were off.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ */
+void irqoff_end(void){
+      if(irqoff_since != 0){
+            irqstat_record(IRQSTAT_IRQOFF, rdtsc_lo() - irqoff_since);
+            irqoff_since = 0;
+      }
+      return;
+}
@@ -0,0 +1,42 @@
+/* irqstat.h: Header file for interrupt latency histograms */
+#ifndef _IRQSTAT_H
+#define _IRQSTAT_H
+
+#include "types.h"
+
+/* Buckets of a histogram: bucket n counts durations of 2^n to 2^(n+1)-1
+ * TSC cycles */
+#define LAT_BUCKETS 32
+
+/* What the histograms are kept for */
+#define IRQSTAT_TIMER     0
+#define IRQSTAT_KEYBOARD  1
+#define IRQSTAT_RTC       2
+#define IRQSTAT_SYSCALL   3
+#define IRQSTAT_EXCEPTION 4
+#define IRQSTAT_OTHER     5
+#define IRQSTAT_IRQOFF    6     /* stretches with interrupts off */
+#define IRQSTAT_WAKEUP    7     /* from wake_up_interactive to running */
+#define NUM_IRQSTATS      8
+
+typedef struct lat_hist {
+      uint32_t count;               //durations recorded
+      uint32_t max;                 //longest, in cycles
+      uint32_t switched;            //not recorded: the handler switched tasks
+      uint32_t bucket[LAT_BUCKETS];
+} lat_hist_t;
+
+extern lat_hist_t irqstat[NUM_IRQSTATS];
+extern const int8_t * irqstat_names[NUM_IRQSTATS];
+extern uint32_t tsc_per_us;
+
+/* Measures the TSC against the PIT */
+void irqstat_init(void);
+
+/* Which histogram a vector's handler time goes into */
+int32_t irqstat_slot(uint32_t vector_num);
+
+/* Adds one duration, in cycles */
+void irqstat_record(int32_t slot, uint32_t cycles);
+
+#endif  /* _IRQSTAT_H */
@@ -17,10 +17,19 @@
 #include "video.h"
 #include "term_sched.h"
 #include "pit.h"
+#include "smp.h"
+#include "irq.h"
+#include "irqstat.h"
+#include "fpu.h"
+#include "serial.h"
+#include "klog.h"
+#include "bench.h"
 
 #define RUN_TESTS
 //#define RUN_EXCEPTION_TEST
 //#define PAGE_FAULT_TEST
+//#define RUN_BENCH
+//#define KLOG_CONSOLE
 
 /* Macros. */
 /* Check if the bit BIT in FLAGS is set. */
@@ -155,6 +164,9 @@ void entry(unsigned long magic, unsigned long addr) {
     lidt(idt_desc_ptr);
     int_setup();
 
+    /* Turn on the FPU and SSE, which memcpy and memset use */
+    fpu_init();
+
     /* Init the PIC */
     i8259_init();
 
@@ -164,9 +176,23 @@ void entry(unsigned long magic, unsigned long addr) {
     /* Init the keyboard */
     keyboard_init();
 
+    /* Init the serial port, for output a host can capture */
+    serial_init();
+
+#ifdef KLOG_CONSOLE
+    /* Copy everything the console prints to the serial port too */
+    klog_console = 1;
+#endif
+
     /* Init paging*/
     init_paging();
 
+    /* Find and start the other processors */
+    smp_init();
+
+    /* Route IRQs through the IOAPIC instead of the PIC, if there is one */
+    irq_init();
+
     /*Initialize the video functions*/
     vid_init();
 
@@ -175,8 +201,11 @@ void entry(unsigned long magic, unsigned long addr) {
     /* Prepare the shells to be ran */
     setup_shells();
 
-    /* Init the pit*/
-    pit_init();
+    /* Start the scheduler tick: local APIC timer, or the pit */
+    timer_init();
+
+    /* Measure the TSC, for the interrupt latency histograms */
+    irqstat_init();
 
     /* Initialize devices, memory, filesystem, enable device interrupts on the
      * PIC, any other initialization stuff... */
@@ -203,11 +232,17 @@ void entry(unsigned long magic, unsigned long addr) {
     /* Run test that will test page_faulting */
     launch_page_fault_test();
 #endif
+
+#ifdef RUN_BENCH
+    /* Time the kernel benchmarks (bench.c) in the first shell, before it
+     * enters user mode */
+    task_run_first(0, bench_main);
+#endif
     /* Execute the first program ("shell") ... */
 
     clear_term();
 
-    task_switch(0);
+    sched_start();
 
     /* Spin (nicely, so we don't chew up cycles) */
     asm volatile (".1: hlt; jmp .1;");
@@ -1,9 +1,11 @@
 #include "keyboard.h"
-#include "i8259.h"
+#include "irq.h"
 #include "lib.h"
 #include "vc.h"
 #include "video.h"
 #include "term_sched.h"
+#include "signal.h"
+#include "bh.h"
 
 #define KEYBOARD 256
 
@@ -32,6 +34,15 @@ static uint32_t     alt_flag;
 static unsigned char tmpbuffer[3][128];
 static unsigned int next_available[3];
 
+/*Scancodes read by the interrupt handler and not yet handled by
+ *keyboard_bh. A power of two, so the free-running indices wrap cleanly;
+ *scancodes that arrive with it full are dropped.
+ */
+#define SCANCODE_RING 64
+static unsigned char scancode_ring[SCANCODE_RING];
+static volatile uint32_t scancode_head;
+static volatile uint32_t scancode_tail;
+
 #define ENTER     0x1C
 #define CTRL_L    0x1D
 #define CTRL_R    0x1D
@@ -60,6 +71,7 @@ static unsigned int next_available[3];
 #define U_C_R 0x9D
 
 #define L 0xA6
+#define C 0x2E
 
 void clear_tmp_buffer();
 void handle_keyinput(unsigned char key_pressed);
@@ -67,6 +79,8 @@ void enter_pressed();
 void backspace_pressed();
 void populate_keymappings_upper();
 void switch_terminal(uint32_t fn_num);
+void keyboard_bh(void);
+void handle_scancode(unsigned char key_pressed);
 
 /* keyboard_init
  * Description: Initialize the keyboard driver
@@ -98,7 +112,7 @@ void keyboard_init(void) {
      next_available[current_display] = 0;
 
     /* enable keyboard IRQ line on master PIC */
-    enable_irq(KEYBOARD_IRQ_ON_MASTER);
+    irq_enable(KEYBOARD_IRQ_ON_MASTER);
 
     //clear tmp buffer so that people can type
     //clear flags
@@ -112,42 +126,103 @@ void keyboard_init(void) {
     populate_keymappings_caps();
     populate_alphanumeric();
 
+    scancode_head = 0;
+    scancode_tail = 0;
+    bh_install(BH_KEYBOARD, keyboard_bh);
+
     sti();
     return;
 }
 
 /* keyboard_interrupt_handler
- * Description: Handles interrupt input generated by the keyboard
+ * Description: Handles interrupt input generated by the keyboard. Only reads
+ *              the scancode and queues it; keyboard_bh does the rest
  * Input: none
  * Output: none
- * Side effects: echos key to terminal
+ * Side effects: raises the keyboard bottom half
  * Return: none
  */
 
 void keyboard_interrupt_handler(){
-      cli();
-
       unsigned char key_pressed;
       /*Get keyboard input*/
       key_pressed = inb(KEYBOARD_PORT);
 
-      /* arrow keys and page up / page down are non functional atm, poll for new input */
-      //TODO: add magic numbers for arrow keys page up and page down - Mike
-      if(key_pressed == UPARW || key_pressed == DNARW || key_pressed == L_ARW || key_pressed == R_ARW ||
-            key_pressed == PGEDN || key_pressed == PGEUP){
+      if(key_pressed == 0xE0){
+            //printchar_term(0x02); //FIXME: fairly certain we never actually call this code and the unpress would be the polled key_pressed anyway
+            key_pressed = inb(KEYBOARD_PORT);
+      }
 
-              send_eoi(1);
-              enable_irq(1);
-              return;
-          }
+      if(scancode_head - scancode_tail < SCANCODE_RING){
+            scancode_ring[scancode_head % SCANCODE_RING] = key_pressed;
+            scancode_head++;
+            bh_raise(BH_KEYBOARD);
+      }
 
+      /*Return from interrupt*/
+      irq_eoi(1);
+      irq_enable(1);
+      return;
+}
 
+/* keyboard_inject
+ * Description: Queues a scancode as if the keyboard had sent it, for the
+ *              keyboard echo benchmark. Handled by the next bottom half run
+ * Input: scancode
+ * Output: none
+ * Side effects: raises the keyboard bottom half
+ * Return: none
+ */
 
-      if(key_pressed == 0xE0){
-            //printchar_term(0x02); //FIXME: fairly certain we never actually call this code and the unpress would be the polled key_pressed anyway
-            key_pressed = inb(KEYBOARD_PORT);
+void keyboard_inject(unsigned char scancode){
+      unsigned long flags;
+
+      cli_and_save(flags);
+      if(scancode_head - scancode_tail < SCANCODE_RING){
+            scancode_ring[scancode_head % SCANCODE_RING] = scancode;
+            scancode_head++;
+            bh_raise(BH_KEYBOARD);
+      }
+      restore_flags(flags);
+      return;
+}
+
+/* keyboard_bh
+ * Description: Bottom half of the keyboard interrupt: handles the queued
+ *              scancodes, with interrupts on
+ * Input: none
+ * Output: none
+ * Side effects: see handle_scancode
+ * Return: none
+ */
+
+void keyboard_bh(void){
+      unsigned char key_pressed;
+
+      while(scancode_tail != scancode_head){
+            key_pressed = scancode_ring[scancode_tail % SCANCODE_RING];
+            scancode_tail++;
+            handle_scancode(key_pressed);
       }
+      return;
+}
+
+/* handle_scancode
+ * Description: Acts on one scancode: updates the modifier flags, edits the
+ *              line being typed and echos it, or switches terminals
+ * Input: scan code read from the keyboard
+ * Output: none
+ * Side effects: echos key to terminal
+ * Return: none
+ */
 
+void handle_scancode(unsigned char key_pressed){
+      /* arrow keys and page up / page down are non functional atm, poll for new input */
+      //TODO: add magic numbers for arrow keys page up and page down - Mike
+      if(key_pressed == UPARW || key_pressed == DNARW || key_pressed == L_ARW || key_pressed == R_ARW ||
+            key_pressed == PGEDN || key_pressed == PGEUP){
+              return;
+          }
 
       switch(key_pressed){
             case(ENTER): {
@@ -224,12 +299,8 @@ void keyboard_interrupt_handler(){
 
       }
 
-      /*Return from interrupt*/
-      send_eoi(1);
-      enable_irq(1);
-
-      sti();
-
+      /*the switch itself copies video memory, so keep it in one piece;
+       *the scheduling waits until the bottom half is done*/
       cli();
       if(alt_flag && (key_pressed == FUN_1)){
             asynchronous_task_switch(0);
@@ -276,6 +347,12 @@ void handle_keyinput(unsigned char key_pressed){
             return;
       }
 
+      /*ctrl + c interrupts the program running on this terminal*/
+      if((key_pressed == C) && ctrl_flag){
+            signal_interrupt_current_term();
+            return;
+      }
+
       if(key_pressed > MAXCH){
             return;
       }
@@ -326,6 +403,8 @@ void handle_keyinput(unsigned char key_pressed){
  */
 
 void enter_pressed(){
+      unsigned long flags;
+
       /*add the newline at the end of the buffer */
       tmpbuffer[current_display][next_available[current_display]] = '\n';
       next_available[current_display] ++;
@@ -337,13 +416,19 @@ void enter_pressed(){
       if(official == NULL){
             return;
       }
-      /*deep copy everything from the keyboard buffer to the official terminal buffer */
+      /*deep copy everything from the keyboard buffer to the official terminal
+       *buffer, which vc_read may be emptying */
       unsigned int i = 0;
+      spin_lock_irqsave(&vc_buffer_lock, flags);
       for(i = 0; i < next_available[current_display]; i++){
             official[i] = tmpbuffer[current_display][i];
       }
+      spin_unlock_irqrestore(&vc_buffer_lock, flags);
       /*clear the keyboard buffer */
       next_available[current_display] = 0;
+
+      /*wake the program waiting for the line in vc_read */
+      wake_up_interactive(official);
       return;
 }
 
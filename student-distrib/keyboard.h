@@ -11,6 +11,7 @@ void enter_pressed();
 void backspace_pressed();
 void keyboard_init(void);
 void keyboard_interrupt_handler(void);
+void keyboard_inject(unsigned char scancode);
 
 void populate_keymappings_upper();
 void populate_keymappings();
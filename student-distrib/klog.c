@@ -0,0 +1,85 @@
+/*klog.c
+ *The kernel log: text meant for a host watching the serial port rather
+ *than for the screen, where it would scroll away. Benchmark results and
+ *dumps of the profiling and trace files in proc/ (irqstat, interrupts,
+ *syscalls, sched) are written here, and with klog_console set, so is
+ *everything the console shows. It all goes through serial_write, which
+ *only copies into a ring, so logging is cheap enough for any path.
+ */
+
+#include "klog.h"
+#include "lib.h"
+#include "serial.h"
+#include "procfs.h"
+
+/*Largest proc/ file klog_dump copies, as much as procfs makes*/
+#define DUMP_SIZE         4096
+
+int32_t klog_console = 0;
+
+/*Where klog_dump reads a file into: too big for a kernel stack*/
+static uint8_t dump_buf[DUMP_SIZE];
+
+/* klog_write
+ * DESCRIPTION:   Adds bytes to the log.
+ * INPUTS:        buf - the bytes
+ *                n - how many
+ * OUTPUTS:       none
+ */
+void klog_write(const int8_t * buf, uint32_t n){
+      serial_write(buf, n);
+      return;
+}
+
+/* klog_puts
+ * DESCRIPTION:   Adds a string to the log.
+ * INPUTS:        s - the string
+ * OUTPUTS:       none
+ */
+void klog_puts(const int8_t * s){
+      serial_write(s, strlen(s));
+      return;
+}
+
+/* klog_console_write
+ * DESCRIPTION:   Copies console output to the log, if klog_console says
+ *                to. Called by putc in lib.c and print_term and
+ *                printchar_term in video.c.
+ * INPUTS:        buf - what was printed
+ *                n - how many bytes
+ * OUTPUTS:       none
+ */
+void klog_console_write(const int8_t * buf, uint32_t n){
+      if(klog_console){
+            serial_write(buf, n);
+      }
+      return;
+}
+
+/* klog_dump
+ * DESCRIPTION:   Copies a proc/ file to the log in one piece, between
+ *                lines naming it, so a host can pull it out of a capture.
+ *                Reading it in one go makes it a consistent snapshot.
+ * INPUTS:        name - the file, e.g. "proc/irqstat"
+ * OUTPUTS:       0 on success, -1 if there is no such file
+ * SIDE EFFECTS:  uses dump_buf, so one dump at a time
+ */
+int32_t klog_dump(const int8_t * name){
+      dentry_t dentry;
+      int32_t got;
+
+      if(procfs_lookup((const uint8_t *)name, &dentry) != 0){
+            return -1;
+      }
+      got = procfs_read(dentry.inode_num, 0, dump_buf, DUMP_SIZE);
+      if(got < 0){
+            return -1;
+      }
+
+      klog_puts("--- ");
+      klog_puts(name);
+      klog_puts(" ---\n");
+      klog_write((const int8_t *)dump_buf, got);
+      klog_puts("--- end ---\n");
+      return 0;
+}
@@ -0,0 +1,23 @@
+/* klog.h: Header file for the kernel log, which goes out the serial port */
+#ifndef _KLOG_H
+#define _KLOG_H
+
+#include "types.h"
+
+/* 1 to copy everything printed on the console to the log too (see
+ * KLOG_CONSOLE in kernel.c) */
+extern int32_t klog_console;
+
+/* Add text to the log. They never wait for the serial port; what it has
+ * no room for is dropped */
+void klog_write(const int8_t * buf, uint32_t n);
+void klog_puts(const int8_t * s);
+
+/* What printf, putc and the terminal print, when klog_console is set */
+void klog_console_write(const int8_t * buf, uint32_t n);
+
+/* Copies one of the proc/ files to the log; 0 on success, -1 if there is
+ * no such file */
+int32_t klog_dump(const int8_t * name);
+
+#endif  /* _KLOG_H */
@@ -0,0 +1,245 @@
+/*lapic.c
+ *Driver for the local APIC every processor has: the end of interrupt
+ *register, the interprocessor interrupts that wake the other processors
+ *up and make them reschedule, and the timer, which replaces the PIT when
+ *the IOAPIC routes IRQs.
+ */
+
+#include "lapic.h"
+#include "lib.h"
+#include "pit.h"
+
+/*SVR bit that software-enables the local APIC*/
+#define SVR_ENABLE        0x00000100
+/*ICR fields*/
+#define ICR_INIT          0x00000500
+#define ICR_STARTUP       0x00000600
+#define ICR_LEVEL_ASSERT  0x00004000
+#define ICR_LEVEL_TRIG    0x00008000
+#define ICR_BUSY          0x00001000
+#define ICR_DEST_SHIFT    24
+/*LVT bit that keeps an interrupt source from firing*/
+#define LVT_MASKED        0x00010000
+/*timer LVT bit: reload the initial count every time it reaches 0*/
+#define TIMER_PERIODIC    0x00020000
+/*divide configuration value that divides the bus clock by 16*/
+#define TIMER_DIV_16      0x3
+/*how long calibration counts for*/
+#define CALIBRATE_MS      10
+#define US_PER_MS         1000
+#define MS_PER_S          1000
+
+volatile uint32_t * lapic = NULL;
+uint32_t lapic_ticks_per_ms = 0;
+
+static void lapic_send_ipi(uint32_t apic_id, uint32_t command);
+
+/* lapic_read
+ * DESCRIPTION:   Reads a local APIC register. Every register is 32 bits at
+ *                a 16-byte aligned offset.
+ * INPUTS:        reg - byte offset of the register
+ * OUTPUTS:       its value
+ */
+uint32_t lapic_read(uint32_t reg){
+      return lapic[reg >> 2];
+}
+
+/* lapic_write
+ * DESCRIPTION:   Writes a local APIC register.
+ * INPUTS:        reg - byte offset of the register
+ *                val - value to write
+ * OUTPUTS:       none
+ */
+void lapic_write(uint32_t reg, uint32_t val){
+      lapic[reg >> 2] = val;
+      return;
+}
+
+/* lapic_init
+ * DESCRIPTION:   Software-enables the local APIC of the CPU this runs on
+ *                and lets it accept every priority. The LINT0 and LINT1
+ *                entries are left as the BIOS set them on CPU 0, so the
+ *                8259 keeps working through virtual wire mode; on the other
+ *                CPUs they are masked, so an 8259 interrupt or NMI only
+ *                ever reaches CPU 0.
+ * INPUTS:        bsp - 1 on CPU 0, 0 on the others
+ * OUTPUTS:       none
+ * SIDE EFFECTS:  clears any error the APIC latched
+ */
+void lapic_init(int32_t bsp){
+      if(lapic == NULL){
+            return;
+      }
+
+      lapic_write(LAPIC_SVR, SVR_ENABLE | SPURIOUS_VECTOR);
+      lapic_write(LAPIC_TPR, 0);
+      lapic_write(LAPIC_LVT_TIMER, LVT_MASKED);
+      lapic_write(LAPIC_LVT_ERROR, LVT_MASKED);
+      if(!bsp){
+            lapic_write(LAPIC_LVT_LINT0, LVT_MASKED);
+            lapic_write(LAPIC_LVT_LINT1, LVT_MASKED);
+      }
+
+      //the ESR only updates when written
+      lapic_write(LAPIC_ESR, 0);
+      lapic_write(LAPIC_ESR, 0);
+      return;
+}
+
+/* lapic_id
+ * DESCRIPTION:   Tells which CPU this code is running on.
+ * INPUTS:        none
+ * OUTPUTS:       the local APIC ID, 0 without a local APIC
+ */
+uint32_t lapic_id(void){
+      if(lapic == NULL){
+            return 0;
+      }
+      return lapic_read(LAPIC_ID) >> ICR_DEST_SHIFT;
+}
+
+/* lapic_eoi
+ * DESCRIPTION:   Tells the local APIC the current interrupt was handled.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ */
+void lapic_eoi(void){
+      lapic_write(LAPIC_EOI, 0);
+      return;
+}
+
+/* lapic_send_ipi
+ * DESCRIPTION:   Sends an interprocessor interrupt and waits until the
+ *                local APIC has delivered it.
+ * INPUTS:        apic_id - the destination CPU
+ *                command - low half of the ICR
+ * OUTPUTS:       none
+ */
+static void lapic_send_ipi(uint32_t apic_id, uint32_t command){
+      lapic_write(LAPIC_ICR_HIGH, apic_id << ICR_DEST_SHIFT);
+      lapic_write(LAPIC_ICR_LOW, command);
+      while(lapic_read(LAPIC_ICR_LOW) & ICR_BUSY);
+      return;
+}
+
+/* lapic_send_init
+ * DESCRIPTION:   Resets another CPU into its wait-for-STARTUP state.
+ * INPUTS:        apic_id - the CPU
+ * OUTPUTS:       none
+ */
+void lapic_send_init(uint32_t apic_id){
+      lapic_send_ipi(apic_id, ICR_INIT | ICR_LEVEL_ASSERT | ICR_LEVEL_TRIG);
+      return;
+}
+
+/* lapic_send_startup
+ * DESCRIPTION:   Starts a CPU waiting after INIT in real mode at
+ *                vector * 4kB.
+ * INPUTS:        apic_id - the CPU
+ *                vector - physical page the CPU starts at (below 1MB)
+ * OUTPUTS:       none
+ */
+void lapic_send_startup(uint32_t apic_id, uint32_t vector){
+      lapic_send_ipi(apic_id, ICR_STARTUP | (vector & 0xFF));
+      return;
+}
+
+/* lapic_send_vector
+ * DESCRIPTION:   Raises an interrupt on another CPU. The two ICR writes
+ *                can't be split by an interrupt handler sending its own.
+ * INPUTS:        apic_id - the CPU
+ *                vector - the IDT vector it takes
+ * OUTPUTS:       none
+ */
+void lapic_send_vector(uint32_t apic_id, uint32_t vector){
+      unsigned long flags;
+
+      cli_and_save(flags);
+      lapic_send_ipi(apic_id, ICR_LEVEL_ASSERT | (vector & 0xFF));
+      restore_flags(flags);
+      return;
+}
+
+/* lapic_timer_calibrate
+ * DESCRIPTION:   The timer counts at the bus clock divided by 16, which
+ *                the kernel can't know in advance: count down from the top
+ *                while the PIT measures CALIBRATE_MS.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ * SIDE EFFECTS:  sets lapic_ticks_per_ms; leaves the timer stopped
+ */
+void lapic_timer_calibrate(void){
+      uint32_t elapsed;
+
+      lapic_write(LAPIC_TIMER_DIVIDE, TIMER_DIV_16);
+      lapic_write(LAPIC_LVT_TIMER, LVT_MASKED);
+      lapic_write(LAPIC_TIMER_INIT, 0xFFFFFFFF);
+
+      pit_delay_ms(CALIBRATE_MS);
+
+      elapsed = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CURRENT);
+      lapic_timer_stop();
+
+      lapic_ticks_per_ms = elapsed / CALIBRATE_MS;
+      if(lapic_ticks_per_ms == 0){
+            lapic_ticks_per_ms = 1;
+      }
+      return;
+}
+
+/* lapic_timer_periodic
+ * DESCRIPTION:   Starts the timer in periodic mode.
+ * INPUTS:        vector - the interrupt to raise
+ *                hz - how many times a second
+ * OUTPUTS:       none
+ */
+void lapic_timer_periodic(uint32_t vector, uint32_t hz){
+      lapic_write(LAPIC_TIMER_DIVIDE, TIMER_DIV_16);
+      lapic_write(LAPIC_LVT_TIMER, TIMER_PERIODIC | (vector & 0xFF));
+      lapic_write(LAPIC_TIMER_INIT, lapic_ticks_per_ms * MS_PER_S / hz);
+      return;
+}
+
+/* lapic_timer_oneshot
+ * DESCRIPTION:   Starts the timer in one-shot mode, replacing whatever it
+ *                was counting down to before.
+ * INPUTS:        vector - the interrupt to raise
+ *                us - microseconds from now, at least one timer count and
+ *                     at most a minute
+ * OUTPUTS:       none
+ */
+void lapic_timer_oneshot(uint32_t vector, uint32_t us){
+      uint32_t count;
+
+      //whole milliseconds first, so the product doesn't overflow
+      count = lapic_ticks_per_ms * (us / US_PER_MS) +
+              lapic_ticks_per_ms * (us % US_PER_MS) / US_PER_MS;
+      if(count == 0){
+            count = 1;
+      }
+      lapic_write(LAPIC_TIMER_DIVIDE, TIMER_DIV_16);
+      lapic_write(LAPIC_LVT_TIMER, vector & 0xFF);
+      lapic_write(LAPIC_TIMER_INIT, count);
+      return;
+}
+
+/* lapic_timer_stop
+ * DESCRIPTION:   Stops the timer: a zero initial count never fires.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ */
+void lapic_timer_stop(void){
+      lapic_write(LAPIC_TIMER_INIT, 0);
+      lapic_write(LAPIC_LVT_TIMER, LVT_MASKED);
+      return;
+}
+
+/* lapic_timer_elapsed
+ * DESCRIPTION:   How far the timer got since it was started: a one-shot
+ *                timer that fired has counted all of its initial count.
+ * INPUTS:        none
+ * OUTPUTS:       timer counts (lapic_ticks_per_ms per millisecond)
+ */
+uint32_t lapic_timer_elapsed(void){
+      return lapic_read(LAPIC_TIMER_INIT) - lapic_read(LAPIC_TIMER_CURRENT);
+}
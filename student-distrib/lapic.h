@@ -0,0 +1,71 @@
+/* lapic.h: Header file for the local APIC driver */
+#ifndef _LAPIC_H
+#define _LAPIC_H
+
+#include "types.h"
+
+/* where the local APIC's registers are unless the MP table says otherwise */
+#define LAPIC_DEFAULT_BASE  0xFEE00000
+
+/* vector the local APIC raises for a spurious interrupt: needs no EOI */
+#define SPURIOUS_VECTOR     0xFF
+
+/* register offsets, in bytes */
+#define LAPIC_ID            0x020
+#define LAPIC_VERSION       0x030
+#define LAPIC_TPR           0x080
+#define LAPIC_EOI           0x0B0
+#define LAPIC_SVR           0x0F0
+#define LAPIC_ESR           0x280
+#define LAPIC_ICR_LOW       0x300
+#define LAPIC_ICR_HIGH      0x310
+#define LAPIC_LVT_TIMER     0x320
+#define LAPIC_LVT_LINT0     0x350
+#define LAPIC_LVT_LINT1     0x360
+#define LAPIC_LVT_ERROR     0x370
+#define LAPIC_TIMER_INIT    0x380
+#define LAPIC_TIMER_CURRENT 0x390
+#define LAPIC_TIMER_DIVIDE  0x3E0
+
+/* Non-NULL once smp_init found a local APIC */
+extern volatile uint32_t * lapic;
+
+/* Timer counts per millisecond, once lapic_timer_calibrate has run */
+extern uint32_t lapic_ticks_per_ms;
+
+/* Reads and writes a local APIC register */
+uint32_t lapic_read(uint32_t reg);
+void lapic_write(uint32_t reg, uint32_t val);
+
+/* Software-enables this CPU's local APIC; bsp is 1 on CPU 0 */
+void lapic_init(int32_t bsp);
+
+/* Returns this CPU's APIC ID */
+uint32_t lapic_id(void);
+
+/* Signals the end of the interrupt being handled */
+void lapic_eoi(void);
+
+/* Starts another CPU: INIT, then STARTUP at real-mode page vector */
+void lapic_send_init(uint32_t apic_id);
+void lapic_send_startup(uint32_t apic_id, uint32_t vector);
+
+/* Raises vector on another CPU */
+void lapic_send_vector(uint32_t apic_id, uint32_t vector);
+
+/* Measures the timer's rate against the PIT */
+void lapic_timer_calibrate(void);
+
+/* Raises vector hz times a second */
+void lapic_timer_periodic(uint32_t vector, uint32_t hz);
+
+/* Raises vector once, us microseconds from now */
+void lapic_timer_oneshot(uint32_t vector, uint32_t us);
+
+/* Stops the timer */
+void lapic_timer_stop(void);
+
+/* Timer counts since it was last started */
+uint32_t lapic_timer_elapsed(void);
+
+#endif  /* _LAPIC_H */
@@ -2,12 +2,25 @@
  * vim:ts=4 noexpandtab */
 
 #include "lib.h"
+#include "fpu.h"
+#include "klog.h"
 
 #define VIDEO       0xB8000
 #define NUM_COLS    80
 #define NUM_ROWS    25
 #define ATTRIB      0x7
 
+/* Sizes at which memcpy and memset change strategy: below MEM_SMALL an
+ * unrolled loop with no setup, from MEM_SSE_MIN 64 bytes at a time in XMM
+ * registers, and from MEM_NT_MIN stores that bypass the cache, since a
+ * block that big would only evict everything else from it */
+#define MEM_SMALL   64
+#define MEM_SSE_MIN 512
+#define MEM_NT_MIN  (256 * 1024)
+
+static void* memcpy_small(void* dest, const void* src, uint32_t n);
+static void* memset_small(void* s, uint32_t pattern, uint32_t n);
+
 static int screen_x;
 static int screen_y;
 static char* video_mem = (char *)VIDEO;
@@ -166,8 +179,10 @@ int32_t puts(int8_t* s) {
 /* void putc(uint8_t c);
  * Inputs: uint_8* c = character to print
  * Return Value: void
- *  Function: Output a character to the console */
+ *  Function: Output a character to the console, and the kernel log if
+ *  it mirrors the console */
 void putc(uint8_t c) {
+    klog_console_write((int8_t *)&c, 1);
     if(c == '\n' || c == '\r') {
         screen_y++;
         screen_x = 0;
@@ -240,12 +255,26 @@ int8_t* strrev(int8_t* s) {
 /* uint32_t strlen(const int8_t* s);
  * Inputs: const int8_t* s = string to take length of
  * Return Value: length of string s
- * Function: return length of string s */
+ * Function: return length of string s. Looks at a byte at a time up to a
+ *           word boundary, then a word at a time (see HAS_ZERO_BYTE). An
+ *           aligned word never crosses into another page, so reading the
+ *           bytes after the terminator in its word is safe */
 uint32_t strlen(const int8_t* s) {
-    register uint32_t len = 0;
-    while (s[len] != '\0')
-        len++;
-    return len;
+    const int8_t* p = s;
+    const uint32_t* w;
+
+    while ((uint32_t)p & 3) {
+        if (*p == '\0')
+            return p - s;
+        p++;
+    }
+    w = (const uint32_t*)p;
+    while (!HAS_ZERO_BYTE(*w))
+        w++;
+    p = (const int8_t*)w;
+    while (*p != '\0')
+        p++;
+    return p - s;
 }
 
 /* void* memset(void* s, int32_t c, uint32_t n);
@@ -253,8 +282,121 @@ uint32_t strlen(const int8_t* s) {
  *          int32_t c = value to set memory to
  *         uint32_t n = number of bytes to set
  * Return Value: new string
- * Function: set n consecutive bytes of pointer s to value c */
+ * Function: set n consecutive bytes of pointer s to value c, picking
+ *           the fastest way for the size (see MEM_SMALL) */
 void* memset(void* s, int32_t c, uint32_t n) {
+    uint32_t pattern = (c & 0xFF) * 0x01010101;
+    uint32_t head;
+    uint32_t blocks;
+    uint32_t fill[4];
+    uint8_t* p = (uint8_t*)s;
+    kernel_fpu_t fpu;
+
+    if (n < MEM_SMALL)
+        return memset_small(s, pattern, n);
+    if (n < MEM_SSE_MIN || !sse2_enabled)
+        return memset_rep(s, c, n);
+
+    /* up to a 16-byte boundary, then 64 bytes per loop, then the rest */
+    head = (-(uint32_t)p) & 0xF;
+    memset_small(p, pattern, head);
+    p += head;
+    n -= head;
+    blocks = n >> 6;
+    fill[0] = fill[1] = fill[2] = fill[3] = pattern;
+
+    kernel_fpu_begin(&fpu);
+    if (n >= MEM_NT_MIN) {
+        asm volatile ("                     \n\
+                movdqu  (%2), %%xmm0        \n\
+                1:                          \n\
+                movntdq %%xmm0, 0(%0)       \n\
+                movntdq %%xmm0, 16(%0)      \n\
+                movntdq %%xmm0, 32(%0)      \n\
+                movntdq %%xmm0, 48(%0)      \n\
+                addl    $64, %0             \n\
+                decl    %1                  \n\
+                jnz     1b                  \n\
+                sfence                      \n\
+                "
+                : "+r"(p), "+r"(blocks)
+                : "r"(fill)
+                : "memory", "cc"
+        );
+    } else {
+        asm volatile ("                     \n\
+                movdqu  (%2), %%xmm0        \n\
+                1:                          \n\
+                movdqa  %%xmm0, 0(%0)       \n\
+                movdqa  %%xmm0, 16(%0)      \n\
+                movdqa  %%xmm0, 32(%0)      \n\
+                movdqa  %%xmm0, 48(%0)      \n\
+                addl    $64, %0             \n\
+                decl    %1                  \n\
+                jnz     1b                  \n\
+                "
+                : "+r"(p), "+r"(blocks)
+                : "r"(fill)
+                : "memory", "cc"
+        );
+    }
+    kernel_fpu_end(&fpu);
+
+    memset_small(p, pattern, n & 0x3F);
+    return s;
+}
+
+/* void* memset_small(void* s, uint32_t pattern, uint32_t n);
+ * Inputs:    void* s = pointer to memory
+ *   uint32_t pattern = the byte to set, repeated four times
+ *         uint32_t n = number of bytes to set
+ * Return Value: s
+ * Function: memset for a few bytes: 16 at a time unrolled, no setup */
+static void* memset_small(void* s, uint32_t pattern, uint32_t n) {
+    uint8_t* p = (uint8_t*)s;
+    asm volatile ("                 \n\
+            cmpl    $16, %%ecx      \n\
+            jb      2f              \n\
+            1:                      \n\
+            movl    %%eax, 0(%%edi) \n\
+            movl    %%eax, 4(%%edi) \n\
+            movl    %%eax, 8(%%edi) \n\
+            movl    %%eax, 12(%%edi)\n\
+            addl    $16, %%edi      \n\
+            subl    $16, %%ecx      \n\
+            cmpl    $16, %%ecx      \n\
+            jae     1b              \n\
+            2:                      \n\
+            cmpl    $4, %%ecx       \n\
+            jb      3f              \n\
+            movl    %%eax, (%%edi)  \n\
+            addl    $4, %%edi       \n\
+            subl    $4, %%ecx       \n\
+            jmp     2b              \n\
+            3:                      \n\
+            testl   %%ecx, %%ecx    \n\
+            jz      4f              \n\
+            movb    %%al, (%%edi)   \n\
+            incl    %%edi           \n\
+            decl    %%ecx           \n\
+            jmp     3b              \n\
+            4:                      \n\
+            "
+            : "+D"(p), "+c"(n)
+            : "a"(pattern)
+            : "memory", "cc"
+    );
+    return s;
+}
+
+/* void* memset_rep(void* s, int32_t c, uint32_t n);
+ * Inputs:    void* s = pointer to memory
+ *          int32_t c = value to set memory to
+ *         uint32_t n = number of bytes to set
+ * Return Value: new string
+ * Function: set n consecutive bytes of pointer s to value c with rep
+ *           stosl; what memset falls back on without SSE2 */
+void* memset_rep(void* s, int32_t c, uint32_t n) {
     c &= 0xFF;
     asm volatile ("                 \n\
             .memset_top:            \n\
@@ -336,8 +478,139 @@ void* memset_dword(void* s, int32_t c, uint32_t n) {
  *         const void* src = source of copy
  *              uint32_t n = number of byets to copy
  * Return Value: pointer to dest
- * Function: copy n bytes of src to dest */
+ * Function: copy n bytes of src to dest, picking the fastest way for the
+ *           size (see MEM_SMALL) */
 void* memcpy(void* dest, const void* src, uint32_t n) {
+    uint32_t head;
+    uint32_t blocks;
+    uint8_t* d = (uint8_t*)dest;
+    const uint8_t* s = (const uint8_t*)src;
+    kernel_fpu_t fpu;
+
+    if (n < MEM_SMALL)
+        return memcpy_small(dest, src, n);
+    if (n < MEM_SSE_MIN || !sse2_enabled)
+        return memcpy_rep(dest, src, n);
+
+    /* up to a 16-byte boundary of dest (src may stay unaligned), then 64
+     * bytes per loop, then the rest */
+    head = (-(uint32_t)d) & 0xF;
+    memcpy_small(d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+    blocks = n >> 6;
+
+    kernel_fpu_begin(&fpu);
+    if (n >= MEM_NT_MIN) {
+        asm volatile ("                     \n\
+                1:                          \n\
+                movdqu  0(%1), %%xmm0       \n\
+                movdqu  16(%1), %%xmm1      \n\
+                movdqu  32(%1), %%xmm2      \n\
+                movdqu  48(%1), %%xmm3      \n\
+                movntdq %%xmm0, 0(%0)       \n\
+                movntdq %%xmm1, 16(%0)      \n\
+                movntdq %%xmm2, 32(%0)      \n\
+                movntdq %%xmm3, 48(%0)      \n\
+                addl    $64, %1             \n\
+                addl    $64, %0             \n\
+                decl    %2                  \n\
+                jnz     1b                  \n\
+                sfence                      \n\
+                "
+                : "+r"(d), "+r"(s), "+r"(blocks)
+                :
+                : "memory", "cc"
+        );
+    } else {
+        asm volatile ("                     \n\
+                1:                          \n\
+                movdqu  0(%1), %%xmm0       \n\
+                movdqu  16(%1), %%xmm1      \n\
+                movdqu  32(%1), %%xmm2      \n\
+                movdqu  48(%1), %%xmm3      \n\
+                movdqa  %%xmm0, 0(%0)       \n\
+                movdqa  %%xmm1, 16(%0)      \n\
+                movdqa  %%xmm2, 32(%0)      \n\
+                movdqa  %%xmm3, 48(%0)      \n\
+                addl    $64, %1             \n\
+                addl    $64, %0             \n\
+                decl    %2                  \n\
+                jnz     1b                  \n\
+                "
+                : "+r"(d), "+r"(s), "+r"(blocks)
+                :
+                : "memory", "cc"
+        );
+    }
+    kernel_fpu_end(&fpu);
+
+    memcpy_small(d, s, n & 0x3F);
+    return dest;
+}
+
+/* void* memcpy_small(void* dest, const void* src, uint32_t n);
+ * Inputs:      void* dest = destination of copy
+ *         const void* src = source of copy
+ *              uint32_t n = number of bytes to copy
+ * Return Value: pointer to dest
+ * Function: memcpy for a few bytes: 16 at a time unrolled, no setup */
+static void* memcpy_small(void* dest, const void* src, uint32_t n) {
+    uint8_t* d = (uint8_t*)dest;
+    const uint8_t* s = (const uint8_t*)src;
+    asm volatile ("                 \n\
+            cmpl    $16, %%ecx      \n\
+            jb      2f              \n\
+            1:                      \n\
+            movl    0(%%esi), %%eax \n\
+            movl    4(%%esi), %%edx \n\
+            movl    %%eax, 0(%%edi) \n\
+            movl    %%edx, 4(%%edi) \n\
+            movl    8(%%esi), %%eax \n\
+            movl    12(%%esi), %%edx\n\
+            movl    %%eax, 8(%%edi) \n\
+            movl    %%edx, 12(%%edi)\n\
+            addl    $16, %%esi      \n\
+            addl    $16, %%edi      \n\
+            subl    $16, %%ecx      \n\
+            cmpl    $16, %%ecx      \n\
+            jae     1b              \n\
+            2:                      \n\
+            cmpl    $4, %%ecx       \n\
+            jb      3f              \n\
+            movl    (%%esi), %%eax  \n\
+            movl    %%eax, (%%edi)  \n\
+            addl    $4, %%esi       \n\
+            addl    $4, %%edi       \n\
+            subl    $4, %%ecx       \n\
+            jmp     2b              \n\
+            3:                      \n\
+            testl   %%ecx, %%ecx    \n\
+            jz      4f              \n\
+            movb    (%%esi), %%al   \n\
+            movb    %%al, (%%edi)   \n\
+            incl    %%esi           \n\
+            incl    %%edi           \n\
+            decl    %%ecx           \n\
+            jmp     3b              \n\
+            4:                      \n\
+            "
+            : "+S"(s), "+D"(d), "+c"(n)
+            :
+            : "eax", "edx", "memory", "cc"
+    );
+    return dest;
+}
+
+/* void* memcpy_rep(void* dest, const void* src, uint32_t n);
+ * Inputs:      void* dest = destination of copy
+ *         const void* src = source of copy
+ *              uint32_t n = number of byets to copy
+ * Return Value: pointer to dest
+ * Function: copy n bytes of src to dest with rep movsl; what memcpy
+ *           falls back on without SSE2 */
+void* memcpy_rep(void* dest, const void* src, uint32_t n) {
     asm volatile ("                 \n\
             .memcpy_top:            \n\
             testl   %%ecx, %%ecx    \n\
@@ -415,8 +688,24 @@ void* memmove(void* dest, const void* src, uint32_t n) {
  *               indicates the opposite.
  * Function: compares string 1 and string 2 for equality */
 int32_t strncmp(const int8_t* s1, const int8_t* s2, uint32_t n) {
-    int32_t i;
-    for (i = 0; i < n; i++) {
+    uint32_t i = 0;
+
+    /* Strings at the same offset from a word boundary are compared a word
+     * at a time once aligned, up to the word that differs or ends them */
+    if ((((uint32_t)s1 ^ (uint32_t)s2) & 3) == 0) {
+        for (; i < n && ((uint32_t)(s1 + i) & 3); i++) {
+            if ((s1[i] != s2[i]) || (s1[i] == '\0'))
+                return s1[i] - s2[i];
+        }
+        while (i + 4 <= n) {
+            uint32_t w = *(const uint32_t*)(s1 + i);
+            if (w != *(const uint32_t*)(s2 + i) || HAS_ZERO_BYTE(w))
+                break;
+            i += 4;
+        }
+    }
+
+    for (; i < n; i++) {
         if ((s1[i] != s2[i]) || (s1[i] == '\0') /* || s2[i] == '\0' */) {
 
             /* The s2[i] == '\0' is unnecessary because of the short-circuit
@@ -436,12 +725,20 @@ int32_t strncmp(const int8_t* s1, const int8_t* s2, uint32_t n) {
  * Return Value: pointer to dest
  * Function: copy the source string into the destination string */
 int8_t* strcpy(int8_t* dest, const int8_t* src) {
-    int32_t i = 0;
-    while (src[i] != '\0') {
-        dest[i] = src[i];
-        i++;
+    int8_t* d = dest;
+
+    /* bytes up to a word boundary of src, then whole words until the one
+     * holding the terminator, which is finished a byte at a time */
+    while ((uint32_t)src & 3) {
+        if ((*d++ = *src++) == '\0')
+            return dest;
     }
-    dest[i] = '\0';
+    while (!HAS_ZERO_BYTE(*(const uint32_t*)src)) {
+        *(uint32_t*)d = *(const uint32_t*)src;
+        d += 4;
+        src += 4;
+    }
+    while ((*d++ = *src++) != '\0');
     return dest;
 }
 
@@ -464,6 +761,35 @@ int8_t* strncpy(int8_t* dest, const int8_t* src, uint32_t n) {
     return dest;
 }
 
+/* uint32_t strndelim(const int8_t* s, uint32_t n, int8_t d1, int8_t d2)
+ * Inputs: const int8_t* s = string to scan
+ *              uint32_t n = most bytes to look at
+ *        int8_t d1, d2 = characters that end the scan besides '\0'
+ * Return Value: index of the first '\0', d1 or d2 in s, or n if there is
+ *               none in the first n bytes
+ * Function: finds where a word or line ends, a word at a time once s is
+ *           aligned (see strlen) */
+uint32_t strndelim(const int8_t* s, uint32_t n, int8_t d1, int8_t d2) {
+    uint32_t i = 0;
+    uint32_t w;
+
+    for (; i < n && ((uint32_t)(s + i) & 3); i++) {
+        if (s[i] == '\0' || s[i] == d1 || s[i] == d2)
+            return i;
+    }
+    while (i + 4 <= n) {
+        w = *(const uint32_t*)(s + i);
+        if (HAS_ZERO_BYTE(w) || HAS_BYTE(w, d1) || HAS_BYTE(w, d2))
+            break;
+        i += 4;
+    }
+    for (; i < n; i++) {
+        if (s[i] == '\0' || s[i] == d1 || s[i] == d2)
+            return i;
+    }
+    return n;
+}
+
 /* void test_interrupts(void)
  * Inputs: void
  * Return Value: void
@@ -19,10 +19,20 @@ void* memset(void* s, int32_t c, uint32_t n);
 void* memset_word(void* s, int32_t c, uint32_t n);
 void* memset_dword(void* s, int32_t c, uint32_t n);
 void* memcpy(void* dest, const void* src, uint32_t n);
+void* memset_rep(void* s, int32_t c, uint32_t n);
+void* memcpy_rep(void* dest, const void* src, uint32_t n);
 void* memmove(void* dest, const void* src, uint32_t n);
 int32_t strncmp(const int8_t* s1, const int8_t* s2, uint32_t n);
 int8_t* strcpy(int8_t* dest, const int8_t*src);
 int8_t* strncpy(int8_t* dest, const int8_t*src, uint32_t n);
+uint32_t strndelim(const int8_t* s, uint32_t n, int8_t d1, int8_t d2);
+
+/* Word-at-a-time string scanning: non-zero if some byte of the 32-bit
+ * word w is 0 (or c). Only says whether there is one, not where */
+#define WORD_ONES           0x01010101
+#define WORD_HIGHS          0x80808080
+#define HAS_ZERO_BYTE(w)    (((w) - WORD_ONES) & ~(w) & WORD_HIGHS)
+#define HAS_BYTE(w, c)      HAS_ZERO_BYTE((w) ^ ((uint8_t)(c) * WORD_ONES))
 
 /* Userspace address-check functions */
 int32_t bad_userspace_addr(const void* addr, int32_t len);
@@ -102,6 +112,26 @@ do {                                    \
     );                                  \
 } while (0)
 
+/* Reads the low 32 bits of the time stamp counter. They wrap every few
+ * seconds, so only the difference of two close reads means anything. */
+static inline uint32_t rdtsc_lo(void) {
+    uint32_t lo;
+    asm volatile ("rdtsc"
+            : "=a"(lo)
+            :
+            : "edx"
+    );
+    return lo;
+}
+
+/* Interrupt flag bit of EFLAGS */
+#define EFLAGS_IF_BIT 0x00000200
+
+/* Time spent with interrupts off is measured in irqstat.c: these mark
+ * where it starts and ends */
+void irqoff_begin(void);
+void irqoff_end(void);
+
 /* Clear interrupt flag - disables interrupts on this processor */
 #define cli()                           \
 do {                                    \
@@ -110,6 +140,7 @@ do {                                    \
             :                           \
             : "memory", "cc"            \
     );                                  \
+    irqoff_begin();                     \
 } while (0)
 
 /* Save flags and then clear interrupt flag
@@ -126,11 +157,14 @@ do {                                    \
             :                           \
             : "memory", "cc"            \
     );                                  \
+    if ((flags) & EFLAGS_IF_BIT)        \
+        irqoff_begin();                 \
 } while (0)
 
 /* Set interrupt flag - enable interrupts on this processor */
 #define sti()                           \
 do {                                    \
+    irqoff_end();                       \
     asm volatile ("sti"                 \
             :                           \
             :                           \
@@ -143,6 +177,8 @@ do {                                    \
  * after a cli_and_save_flags(flags) */
 #define restore_flags(flags)            \
 do {                                    \
+    if ((flags) & EFLAGS_IF_BIT)        \
+        irqoff_end();                   \
     asm volatile ("                   \n\
             pushl %0                  \n\
             popfl                     \n\
@@ -0,0 +1,117 @@
+/*mutex.c
+ *Sleeping locks, for state a process keeps to itself for a long time (a
+ *terminal it is writing a lot to, a PCB it is loading a program into).
+ *Unlike a spinlock the holder can be preempted and can sleep, and other
+ *processes wanting the lock sleep instead of spinning. Not for interrupt
+ *handlers or bottom halves, which can't sleep.
+ *Each lock records the PID holding it, and each PCB the locks it holds,
+ *so a process that ends holding one can't leave it locked for good.
+ *The locks themselves are guarded by wait_lock, which sleeping on them
+ *needs anyway (see sleep_on).
+ */
+
+#include "mutex.h"
+#include "lib.h"
+#include "syscall.h"
+#include "term_sched.h"
+
+/* mutex_lock
+ * DESCRIPTION:   Takes a lock, sleeping on it while another process holds
+ *                it. A signal doesn't end the wait.
+ * INPUTS:        lock - the lock
+ * OUTPUTS:       none
+ * SIDE EFFECTS:  may sleep; adds the lock to the caller's held_mutexes
+ */
+void mutex_lock(mutex_t * lock){
+      PCB_t * pcb = get_pcb_ptr();
+      unsigned long flags;
+
+      spin_lock_irqsave(&wait_lock, flags);
+      while(lock->locked){
+            sleep_on((void *)lock);
+      }
+      lock->locked = 1;
+      lock->owner = pcb->PID;
+      if(pcb->num_held_mutexes < MUTEX_HELD_MAX){
+            pcb->held_mutexes[pcb->num_held_mutexes++] = lock;
+      }
+      spin_unlock_irqrestore(&wait_lock, flags);
+      return;
+}
+
+/* release
+ * DESCRIPTION:   Frees a lock and wakes the processes waiting for it; the
+ *                first to run takes it, the others sleep again. Called
+ *                with wait_lock held.
+ * INPUTS:        lock - the lock
+ * OUTPUTS:       none
+ */
+static void release(mutex_t * lock){
+      lock->locked = 0;
+      lock->owner = -1;
+      wake_up_locked((void *)lock);
+      return;
+}
+
+/* mutex_unlock
+ * DESCRIPTION:   Releases a lock held by the caller. A lock it doesn't
+ *                hold is left alone.
+ * INPUTS:        lock - the lock
+ * OUTPUTS:       none
+ */
+void mutex_unlock(mutex_t * lock){
+      PCB_t * pcb = get_pcb_ptr();
+      unsigned long flags;
+      uint32_t i;
+
+      spin_lock_irqsave(&wait_lock, flags);
+      if(!lock->locked || lock->owner != pcb->PID){
+            spin_unlock_irqrestore(&wait_lock, flags);
+            return;
+      }
+      for(i = 0; i < pcb->num_held_mutexes; i++){
+            if(pcb->held_mutexes[i] == lock){
+                  pcb->held_mutexes[i] = pcb->held_mutexes[--pcb->num_held_mutexes];
+                  break;
+            }
+      }
+      release(lock);
+      spin_unlock_irqrestore(&wait_lock, flags);
+      return;
+}
+
+/* mutex_init_task
+ * DESCRIPTION:   Starts a new process holding no locks.
+ * INPUTS:        pcb - the process being created
+ * OUTPUTS:       none
+ */
+void mutex_init_task(PCB_t * pcb){
+      pcb->num_held_mutexes = 0;
+      return;
+}
+
+/* mutex_release_all
+ * DESCRIPTION:   Releases the locks a process still holds as it is torn
+ *                down. Nothing should end while holding one (threads are
+ *                only ended on their way back to user mode, see
+ *                end_threads), so this is a safety net: what the process
+ *                was doing under the lock is left half done, but nobody
+ *                waits on it forever.
+ * INPUTS:        pcb - the process
+ * OUTPUTS:       how many locks it held
+ */
+int32_t mutex_release_all(PCB_t * pcb){
+      unsigned long flags;
+      int32_t held;
+
+      spin_lock_irqsave(&wait_lock, flags);
+      held = pcb->num_held_mutexes;
+      while(pcb->num_held_mutexes > 0){
+            pcb->num_held_mutexes--;
+            if(pcb->held_mutexes[pcb->num_held_mutexes]->owner == pcb->PID){
+                  release(pcb->held_mutexes[pcb->num_held_mutexes]);
+            }
+      }
+      spin_unlock_irqrestore(&wait_lock, flags);
+      return held;
+}
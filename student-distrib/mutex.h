@@ -0,0 +1,34 @@
+/* mutex.h: Header file for sleeping locks */
+#ifndef _MUTEX_H
+#define _MUTEX_H
+
+#include "types.h"
+
+struct PCB;
+
+/* A lock a process can hold across long work: 0 when free, 1 when held,
+ * and the PID holding it */
+typedef struct mutex {
+      volatile uint32_t locked;
+      volatile int32_t owner;
+} mutex_t;
+
+#define MUTEX_INIT {0, -1}
+
+/* Most mutexes one process holds at once (see PCB_t's held_mutexes) */
+#define MUTEX_HELD_MAX 4
+
+/* Sleeps until the lock is ours. Process context only */
+void mutex_lock(mutex_t * lock);
+
+/* Releases a lock taken with mutex_lock, waking whoever waits for it */
+void mutex_unlock(mutex_t * lock);
+
+/* A new process holds no locks */
+void mutex_init_task(struct PCB * pcb);
+
+/* Releases every lock a process being torn down still holds; returns how
+ * many there were */
+int32_t mutex_release_all(struct PCB * pcb);
+
+#endif  /* _MUTEX_H */
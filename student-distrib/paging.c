@@ -1,8 +1,42 @@
 #include "types.h"
 #include "paging.h"
+#include "lib.h"
+#include "syscall.h"
+#include "video.h"
+#include "spinlock.h"
 
 extern void init_control_reg(uint32_t * CR3);
 
+/*page fault error code bits*/
+#define PF_PRESENT 0x1        //the page was present (protection fault)
+#define PF_WRITE   0x2        //the access was a write
+
+/*index of the program's page table in a page directory (128MB / 4MB)*/
+#define USER_PDE_INDEX (_128MB >> 22)
+
+/*kernel virtual address where cow_fault maps a frame it is filling*/
+#define COW_SCRATCH (_3MB + 4 * _4KB)
+
+/*pages in the first 1MB, which low_mem_map may identity-map*/
+#define LOW_MEM_PAGES (0x100000 >> PAGING_SHIFT)
+
+/*One 4kB page table per process for its 4MB at 128MB*/
+uint32_t user_pt[MAX_CONCURRENT_TASKS][PAGE_SIZE] __attribute__((aligned (_4KB)));
+
+/*How many user page table entries point at each frame of the user region.
+ *Each process maps at most 1024 pages and every used frame is mapped at
+ *least once, so the region (1024 frames per process) can't run out.
+ */
+static uint8_t frame_refs[NUM_USER_FRAMES];
+
+/*Protects frame_refs, user_pt and the COW_SCRATCH mapping. Taken with
+ *interrupts off: cow_fault runs in the page fault handler.
+ */
+static spinlock_t paging_lock = SPINLOCK_INIT;
+
+static uint32_t frame_alloc(int PID);
+static void set_scratch(uint32_t phys_addr, uint32_t present);
+
 
 /* init_paging function :
  * DESCRIPTION:  the funcion is being called to enable paging ,
@@ -138,7 +172,384 @@ void init_paging(){
           temp_kernel.page_base_addr = 1;
           directory_paging[1] = (uint32_t) temp_kernel.val;
 
+        // map the APIC registers the same way. Caching must stay disabled
+        // here so every access reaches the device
+          temp_kernel.write_through = 1;
+          temp_kernel.cached = 1;
+          temp_kernel.page_base_addr = APIC_MMIO_BASE >> 22;
+          directory_paging[APIC_PDE_INDEX] = (uint32_t) temp_kernel.val;
+
           init_control_reg(directory_paging);
 
       return;
 }
+
+/* frame_alloc
+ * DESCRIPTION:  finds an unused 4kB frame in the user region, looking first
+ *               at the 4MB that used to belong to PID alone, so a process
+ *               that doesn't share anything ends up with the same physical
+ *               layout as before 4kB user pages.
+ * INPUT : PID - process the frame is for
+ * OUTPUT : physical address of the frame, with its reference count at 1
+ */
+static uint32_t frame_alloc(int PID){
+      int i;
+      int idx;
+
+      for(i = 0; i < NUM_USER_FRAMES; i++){
+            idx = (PID * PAGE_SIZE + i) % NUM_USER_FRAMES;
+            if(frame_refs[idx] == 0){
+                  frame_refs[idx] = 1;
+                  return USER_FRAMES_BEGIN + idx * _4KB;
+            }
+      }
+
+      //can't happen, see frame_refs
+      return 0;
+}
+
+/* set_scratch
+ * DESCRIPTION:  maps (or unmaps) a physical frame at COW_SCRATCH so the
+ *               kernel can write into a frame no process has mapped yet.
+ * INPUT : phys_addr - frame to map
+ *         present - 1 to map, 0 to unmap
+ * OUTPUT : none
+ */
+static void set_scratch(uint32_t phys_addr, uint32_t present){
+      page_table_entry_t temp;
+
+      temp.val = 0;
+      temp.present = present;
+      temp.wr = 1;
+      temp.us = 0;
+      temp.write_through = 1;
+      temp.physical_page_addr = phys_addr >> PAGING_SHIFT;
+      paging_table[(COW_SCRATCH >> PAGING_SHIFT) & 0x03FF] = temp.val;
+
+      flush_tlb();
+      return;
+}
+
+/* user_space_create
+ * DESCRIPTION:  gives a new program its own 4MB at 128MB, made of 4kB pages
+ *               backed by frames nobody else uses, plus the kernel mappings.
+ * INPUT : PID - the new process; its old pages must have been freed
+ * OUTPUT : none
+ */
+void user_space_create(int PID){
+      page_directory_entry_4kb_t pde;
+      page_table_entry_t pte;
+      unsigned long flags;
+      int i;
+
+      //set up the vid mem
+      task_pd[PID].PDE[0] = directory_paging[0];
+      //set up the kernel mem
+      task_pd[PID].PDE[1] = directory_paging[1];
+      //and the APIC registers
+      task_pd[PID].PDE[APIC_PDE_INDEX] = directory_paging[APIC_PDE_INDEX];
+      //no vidmap page until it asks for one
+      task_pd[PID].PDE[_132MB >> 22] = 0;
+
+      //the program's page table
+      pde.val = 0;
+      pde.present = 1;
+      pde.wr = 1;
+      pde.us = 1;
+      pde.write_through = 1;
+      pde.table_base_addr = ((uint32_t)user_pt[PID]) >> PAGING_SHIFT;
+      task_pd[PID].PDE[USER_PDE_INDEX] = pde.val;
+
+      //same attributes the old 4MB program page had
+      spin_lock_irqsave(&paging_lock, flags);
+      for(i = 0; i < PAGE_SIZE; i++){
+            pte.val = 0;
+            pte.present = 1;
+            pte.wr = 1;
+            pte.us = 1;
+            pte.write_through = 1;
+            pte.cached = 1;
+            pte.physical_page_addr = frame_alloc(PID) >> PAGING_SHIFT;
+            user_pt[PID][i] = pte.val;
+      }
+      spin_unlock_irqrestore(&paging_lock, flags);
+
+      return;
+}
+
+/* user_space_fork
+ * DESCRIPTION:  gives child the same user memory as parent without copying
+ *               any of it: both page tables point at the parent's frames,
+ *               read-only and marked PTE_COW. The first write by either
+ *               process copies the page (see cow_fault).
+ * INPUT : parent - PID being forked
+ *         child - new PID; its old pages must have been freed
+ * OUTPUT : none
+ * SIDE EFFECTS : reloads CR3 so the parent sees its pages as read-only
+ */
+void user_space_fork(int parent, int child){
+      page_directory_entry_4kb_t pde;
+      page_table_entry_t pte;
+      unsigned long flags;
+      int i;
+
+      task_pd[child].PDE[0] = directory_paging[0];
+      task_pd[child].PDE[1] = directory_paging[1];
+      task_pd[child].PDE[APIC_PDE_INDEX] = directory_paging[APIC_PDE_INDEX];
+      //keep the parent's vidmap mapping, if any, in a table of its own.
+      //vidchange moves it under video_lock
+      spin_lock_irqsave(&video_lock, flags);
+      pde.val = task_pd[parent].PDE[_132MB >> 22];
+      if(pde.present){
+            (void)memcpy(vidmap_pt[child], vidmap_pt[parent], sizeof(vidmap_pt[child]));
+            pde.table_base_addr = ((uint32_t)vidmap_pt[child]) >> PAGING_SHIFT;
+      }
+      task_pd[child].PDE[_132MB >> 22] = pde.val;
+      spin_unlock_irqrestore(&video_lock, flags);
+
+      pde.val = task_pd[parent].PDE[USER_PDE_INDEX];
+      pde.table_base_addr = ((uint32_t)user_pt[child]) >> PAGING_SHIFT;
+      task_pd[child].PDE[USER_PDE_INDEX] = pde.val;
+
+      spin_lock_irqsave(&paging_lock, flags);
+      for(i = 0; i < PAGE_SIZE; i++){
+            pte.val = user_pt[parent][i];
+            if(!pte.present){
+                  user_pt[child][i] = 0;
+                  continue;
+            }
+            if(pte.wr){
+                  pte.wr = 0;
+                  pte.available |= PTE_COW;
+            }
+            pte.accessed = 0;
+            pte.dirty = 0;
+            user_pt[parent][i] = pte.val;
+            user_pt[child][i] = pte.val;
+            frame_refs[((pte.physical_page_addr << PAGING_SHIFT) - USER_FRAMES_BEGIN) >> PAGING_SHIFT]++;
+      }
+
+      flush_tlb();
+      spin_unlock_irqrestore(&paging_lock, flags);
+      return;
+}
+
+/* user_space_free
+ * DESCRIPTION:  drops a halting program's references to its frames. The
+ *               page table is left empty for the next program with this PID.
+ * INPUT : PID - the halting process
+ * OUTPUT : none
+ */
+void user_space_free(int PID){
+      page_table_entry_t pte;
+      unsigned long flags;
+      int i;
+
+      spin_lock_irqsave(&paging_lock, flags);
+      for(i = 0; i < PAGE_SIZE; i++){
+            pte.val = user_pt[PID][i];
+            if(pte.present){
+                  frame_refs[((pte.physical_page_addr << PAGING_SHIFT) - USER_FRAMES_BEGIN) >> PAGING_SHIFT]--;
+            }
+            user_pt[PID][i] = 0;
+      }
+      spin_unlock_irqrestore(&paging_lock, flags);
+
+      return;
+}
+
+/* user_frame_usage
+ * DESCRIPTION:  counts the frames of the user region in use, and how many
+ *               of those are shared copy-on-write by more than one process.
+ * INPUT : used, shared - where to put the counts
+ * OUTPUT : none
+ */
+void user_frame_usage(uint32_t * used, uint32_t * shared){
+      int i;
+
+      *used = 0;
+      *shared = 0;
+      for(i = 0; i < NUM_USER_FRAMES; i++){
+            if(frame_refs[i] > 0){
+                  (*used)++;
+            }
+            if(frame_refs[i] > 1){
+                  (*shared)++;
+            }
+      }
+      return;
+}
+
+/* user_space_pages
+ * DESCRIPTION:  counts the pages mapped in the 4MB at 128MB of a process.
+ * INPUT : PID - owner of the page table (a thread's mm_pid)
+ * OUTPUT : number of present pages
+ */
+uint32_t user_space_pages(int PID){
+      page_table_entry_t pte;
+      uint32_t pages = 0;
+      int i;
+
+      for(i = 0; i < PAGE_SIZE; i++){
+            pte.val = user_pt[PID][i];
+            if(pte.present){
+                  pages++;
+            }
+      }
+      return pages;
+}
+
+/* cow_fault
+ * DESCRIPTION:  handles a write to a PTE_COW page of the running process,
+ *               from user code or from the kernel writing to a user buffer
+ *               (CR0.WP is set, so both fault). If nobody else maps the
+ *               frame any more it is simply made writable; otherwise the
+ *               page is copied into a new frame first.
+ * INPUT : error_code - the page fault's error code
+ * OUTPUT : 0 if the fault was handled and the write can be retried,
+ *          -1 if it is a real fault
+ */
+int32_t cow_fault(uint32_t error_code){
+      uint32_t addr;
+      uint32_t old_frame;
+      uint32_t new_frame;
+      page_table_entry_t pte;
+      unsigned long flags;
+      int PID;
+      int page;
+
+      asm volatile("                \n\
+            MOVL %%CR2, %0          \n\
+            "
+            : "=r"(addr)
+      );
+
+      if(!(error_code & PF_PRESENT) || !(error_code & PF_WRITE)){
+            return -1;
+      }
+      if(addr < _128MB || addr >= _128MB + _4MB){
+            return -1;
+      }
+
+      PID = get_pcb_ptr()->mm_pid;
+      page = (addr - _128MB) >> PAGING_SHIFT;
+      spin_lock_irqsave(&paging_lock, flags);
+      pte.val = user_pt[PID][page];
+      if(!pte.present || !(pte.available & PTE_COW)){
+            spin_unlock_irqrestore(&paging_lock, flags);
+            return -1;
+      }
+
+      old_frame = pte.physical_page_addr << PAGING_SHIFT;
+      if(frame_refs[(old_frame - USER_FRAMES_BEGIN) >> PAGING_SHIFT] > 1){
+            new_frame = frame_alloc(PID);
+            set_scratch(new_frame, 1);
+            (void)memcpy((void *)COW_SCRATCH, (void *)(addr & ~(_4KB - 1)), _4KB);
+            set_scratch(0, 0);
+            frame_refs[(old_frame - USER_FRAMES_BEGIN) >> PAGING_SHIFT]--;
+            pte.physical_page_addr = new_frame >> PAGING_SHIFT;
+      }
+
+      pte.wr = 1;
+      pte.available &= ~PTE_COW;
+      user_pt[PID][page] = pte.val;
+
+      flush_tlb();
+      spin_unlock_irqrestore(&paging_lock, flags);
+      return 0;
+}
+
+/* low_mem_map
+ * DESCRIPTION:  identity-maps the pages of the first 1MB covering
+ *               [phys_addr, phys_addr + len) in the kernel page table, so
+ *               smp_init can read the BIOS tables and write the AP
+ *               trampoline. Nothing else in the first 1MB is mapped but
+ *               video memory.
+ * INPUT : phys_addr - first byte to map
+ *         len - number of bytes
+ * OUTPUT : none
+ */
+void low_mem_map(uint32_t phys_addr, uint32_t len){
+      page_table_entry_t temp;
+      uint32_t page;
+
+      for(page = phys_addr >> PAGING_SHIFT; page <= (phys_addr + len - 1) >> PAGING_SHIFT; page++){
+            if(page >= LOW_MEM_PAGES || page == (VIDMEM >> PAGING_SHIFT)){
+                  continue;
+            }
+            temp.val = 0;
+            temp.present = 1;
+            temp.wr = 1;
+            temp.us = 0;
+            temp.write_through = 1;
+            temp.physical_page_addr = page;
+            paging_table[page] = temp.val;
+      }
+
+      flush_tlb();
+      return;
+}
+
+/* low_mem_unmap
+ * DESCRIPTION:  removes every mapping low_mem_map made.
+ * INPUT : none
+ * OUTPUT : none
+ */
+void low_mem_unmap(void){
+      uint32_t page;
+
+      for(page = 0; page < LOW_MEM_PAGES; page++){
+            if(page != (VIDMEM >> PAGING_SHIFT)){
+                  paging_table[page] = 0;
+            }
+      }
+
+      flush_tlb();
+      return;
+}
+
+/* big_page_map
+ * DESCRIPTION:  maps 4MB of physical memory at virt in the page directory
+ *               CR3 points at, for the kernel only. For tests that need
+ *               more room than the kernel's own 4MB, which take it from
+ *               the BENCH_FRAMES region so no process's frames are touched.
+ * INPUT : virt - 4MB-aligned virtual address
+ *         phys - 4MB-aligned physical address
+ * OUTPUT : the entry that was there, for big_page_unmap to put back
+ */
+uint32_t big_page_map(uint32_t virt, uint32_t phys){
+      page_directory_entry_4mb_t pde;
+      uint32_t * pd;
+      uint32_t old_pde;
+
+      asm volatile("MOVL %%CR3, %0" : "=r"(pd));
+
+      pde.val = 0;
+      pde.present = 1;
+      pde.wr = 1;
+      pde.us = 0;
+      pde.page_size = 1;
+      pde.page_base_addr = phys >> 22;
+      old_pde = pd[virt >> 22];
+      pd[virt >> 22] = pde.val;
+
+      flush_tlb();
+      return old_pde;
+}
+
+/* big_page_unmap
+ * DESCRIPTION:  undoes big_page_map, in the same page directory: call it
+ *               from the process that made the mapping.
+ * INPUT : virt - the address it was mapped at
+ *         old_pde - what big_page_map returned
+ * OUTPUT : none
+ */
+void big_page_unmap(uint32_t virt, uint32_t old_pde){
+      uint32_t * pd;
+
+      asm volatile("MOVL %%CR3, %0" : "=r"(pd));
+      pd[virt >> 22] = old_pde;
+
+      flush_tlb();
+      return;
+}
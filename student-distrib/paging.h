@@ -7,6 +7,25 @@
 #define _3MB 0x300000
 #define _4KB 0x1000
 
+/*Physical memory programs are loaded into: 4MB for each of the six PIDs,
+ *handed out 4kB at a time*/
+#define USER_FRAMES_BEGIN 0x800000
+#define NUM_USER_FRAMES (6 * PAGE_SIZE)
+
+/*Physical memory kept for the benchmarks' buffers, just past the user
+ *frames: two 4MB pages that nothing else allocates (see big_page_map)*/
+#define BENCH_FRAMES_BEGIN (USER_FRAMES_BEGIN + NUM_USER_FRAMES * _4KB)
+#define BENCH_FRAMES_SIZE 0x800000
+
+/*Set in a user PTE's available bits: read-only because it is shared
+ *after a fork, not because the program may not write it*/
+#define PTE_COW 0x1
+
+/*The 4MB holding the IOAPIC (0xFEC00000) and local APIC (0xFEE00000)
+ *registers, mapped uncached into every page directory*/
+#define APIC_MMIO_BASE 0xFEC00000
+#define APIC_PDE_INDEX (APIC_MMIO_BASE >> 22)
+
 /* This is a page directory entry for page table.  It goes in the Page Directory . */
 typedef struct page_directory_entry_4kb  {
     union {
@@ -93,4 +112,23 @@ void install_pte_entry(uint32_t * pte, uint32_t phys_addr, uint32_t virt_addr, u
 
 void set_cr3(void * pd);
 
+/*4kB user address spaces with copy-on-write fork (see paging.c)*/
+void user_space_create(int PID);
+void user_space_fork(int parent, int child);
+void user_space_free(int PID);
+int32_t cow_fault(uint32_t error_code);
+
+/*frame usage of the user region and of one address space, for procfs*/
+void user_frame_usage(uint32_t * used, uint32_t * shared);
+uint32_t user_space_pages(int PID);
+
+/*identity mappings of the first 1MB, for firmware tables and the AP
+ *trampoline while smp_init runs*/
+void low_mem_map(uint32_t phys_addr, uint32_t len);
+void low_mem_unmap(void);
+
+/*4MB kernel mappings for tests that need room (see paging.c)*/
+uint32_t big_page_map(uint32_t virt, uint32_t phys);
+void big_page_unmap(uint32_t virt, uint32_t old_pde);
+
 #endif  /* _PAGING_H */
@@ -1,10 +1,14 @@
 #include "lib.h"
 #include "pit.h"
-#include "i8259.h"
+#include "irq.h"
+#include "lapic.h"
+#include "tick.h"
 #include "keyboard.h"
 #include "term_sched.h"
 #include "syscall.h"
 #include "video.h"
+#include "signal.h"
+#include "smp.h"
 
 /* definition of different PIT ports */
 #define PIT_REG       0x36
@@ -14,7 +18,56 @@
 #define PIT_MODE      0x43
 #define BIT8_MASK     0xFF
 #define BYTE_LENGTH   8
-#define MAX_PIT_CLOCK 1193180
+/* channel 0 or 2, low then high byte, mode 0 (interrupt on terminal count) */
+#define PIT_C0_ONESHOT 0x30
+#define PIT_C2_ONESHOT 0xB0
+/* copy channel 0's count to be read */
+#define PIT_C0_LATCH  0x00
+/* port B of the keyboard controller: channel 2 gate and output */
+#define PORT_B        0x61
+#define C2_GATE       0x01
+#define SPEAKER_ON    0x02
+#define C2_OUT        0x20
+#define MS_PER_S      1000
+
+/* timer_init
+ * Starts the scheduler tick. When the IOAPIC routes IRQs the local APIC
+ * timer is used instead of the PIT: its interrupt needs no port I/O to
+ * acknowledge, and it can be reprogrammed to any deadline. Both raise
+ * TIMER_VECTOR, handled by pit_interrupt_handler.
+ */
+void timer_init(void){
+      if(irq_use_apic){
+            lapic_timer_calibrate();
+            lapic_timer_periodic(TIMER_VECTOR, TICK_HZ);
+            return;
+      }
+      pit_init();
+}
+
+/* pit_delay_ms
+ * Waits ms milliseconds (at most 50, the longest 16-bit count) by counting
+ * down PIT channel 2, which never raises an interrupt. Used to measure
+ * other clocks against.
+ */
+void pit_delay_ms(uint32_t ms){
+      uint32_t count = MAX_PIT_CLOCK * ms / MS_PER_S;
+      uint8_t port_b;
+
+      /* gate channel 2 off, and keep the speaker quiet */
+      port_b = inb(PORT_B) & ~(C2_GATE | SPEAKER_ON);
+      outb(port_b, PORT_B);
+
+      outb(PIT_C2_ONESHOT, PIT_MODE);
+      outb(count & BIT8_MASK, PIT_C2);
+      outb((count >> BYTE_LENGTH) & BIT8_MASK, PIT_C2);
+
+      /* raising the gate starts the count; OUT goes high when it ends */
+      outb(port_b | C2_GATE, PORT_B);
+      while(!(inb(PORT_B) & C2_OUT));
+
+      outb(port_b, PORT_B);
+}
 
 /* Initialization borrowed from here
  * http://www.jamesmolloy.co.uk/tutorial_html/5.-IRQs%20and%20the%20PIT.html
@@ -22,69 +75,83 @@
 
 /* Function to initialize the pit */
 void pit_init(void)  {
-  /* Variable of our desired frequemcy for PIT */
-  uint32_t desiredFrequency = 100;  // 100Hz
-  uint32_t dividedFrequency = MAX_PIT_CLOCK / desiredFrequency;
-
-  /* We need to write the frequency as lower and upper byte
-   * to make 16 bit frequency
-   */
-  uint8_t upper = (uint8_t) (dividedFrequency & BIT8_MASK);
-  uint8_t lower = (uint8_t) ((dividedFrequency >> BYTE_LENGTH) & BIT8_MASK);
-
   /* Disable interrupts to set registers */
   cli();
 
-  /* send initial command byte */
-  outb(PIT_REG, PIT_MODE);
+  pit_periodic();
 
-  /* write frequency to the proper ports */
-  outb(lower, PIT_C0);
-  outb(upper, PIT_C0);
   /* enable the PIT IRQ line */
-  enable_irq(0);
+  irq_enable(0);
 
   /* re-enable all interrupts */
   sti();
 }
 
-void pit_interrupt_handler(void)  {
-  /* basically, keep global variable of active terminal number, and we'll check if
-   * calculated terminal number aka dest = (curr +1) % TERMINAL_COUNT is equal
-   * to the current terminal. If it is, send EOI, else, modify dest ID to
-   * dest = (dest+1) % TERMINAL_COUNT.
-   */
+/* pit_periodic
+ * Makes channel 0 interrupt TICK_HZ times a second. The divisor goes out
+ * low byte first.
+ */
+void pit_periodic(void)  {
+  uint32_t divisor = MAX_PIT_CLOCK / TICK_HZ;
 
-   send_eoi(0);
+  /* send initial command byte */
+  outb(PIT_REG, PIT_MODE);
 
-   int old_display;
+  /* write frequency to the proper ports */
+  outb(divisor & BIT8_MASK, PIT_C0);
+  outb((divisor >> BYTE_LENGTH) & BIT8_MASK, PIT_C0);
+}
 
-   page_table_entry_t temp_pte;
+/* pit_oneshot
+ * Makes channel 0 interrupt once, count PIT clocks from now (at most
+ * 0xFFFF), instead of periodically.
+ */
+void pit_oneshot(uint32_t count)  {
+  outb(PIT_C0_ONESHOT, PIT_MODE);
+  outb(count & BIT8_MASK, PIT_C0);
+  outb((count >> BYTE_LENGTH) & BIT8_MASK, PIT_C0);
+}
 
-   running_display++;
-   if(running_display > 2){
-         running_display = 0;
-   }
+/* pit_read_count
+ * Returns what channel 0 has left to count. After a one-shot count ends
+ * the counter wraps around to 0xFFFF and keeps going.
+ */
+uint32_t pit_read_count(void)  {
+  uint32_t count;
 
-   if(flag_for_term_change != -1){
-         old_display = current_display;
-         current_display = flag_for_term_change;
-         flag_for_term_change = -1;
-         vidchange(old_display, current_display);
-   }
+  outb(PIT_C0_LATCH, PIT_MODE);
+  count = inb(PIT_C0);
+  count |= inb(PIT_C0) << BYTE_LENGTH;
+  return count;
+}
 
-   temp_pte.val = vidmap_pt[(_132MB >> 12) & 0x03FF];
+void pit_interrupt_handler(void)  {
+  /* every tick, apply any pending terminal change and let the scheduler
+   * decide whether the running process keeps the CPU (see next_task in
+   * term_sched.c). Terminals don't matter to it.
+   */
 
-   if(current_display == running_display){
-         temp_pte.physical_page_addr = (VIDMEM) >> 12;
-   }
-   else{
-         temp_pte.physical_page_addr = (_3MB + running_display*_4KB) >> 12;
-   }
+   uint32_t ticks;
 
-   vidmap_pt[(_132MB >> 12) & 0x03FF] = temp_pte.val;
+   irq_eoi(0);
+
+   /* count the ticks since the last interrupt: more than one if the
+    * periodic tick was stopped (see tick.c), and charge them to the
+    * running process */
+   ticks = tick_interrupt();
+   tick_charge(ticks);
+
+   /* the other CPUs' timers only preempt (see tick.c) */
+   if(this_cpu()->id == 0){
+         signal_alarm_tick();
+
+         if(flag_for_term_change != -1){
+               vidchange(current_display, flag_for_term_change);
+               flag_for_term_change = -1;
+         }
+   }
 
-   task_switch(current_pid[running_display]);
+   schedule();
 
    return;
 }
@@ -2,9 +2,36 @@
 #ifndef _PIT_H
 #define _PIT_H
 
+#include "types.h"
+
+/* Scheduler ticks per second */
+#define TICK_HZ 100
+
+/* PIT input clock, and the count of one tick */
+#define MAX_PIT_CLOCK 1193180
+#define PIT_TICK_COUNT (MAX_PIT_CLOCK / TICK_HZ)
+
+/* Vector of the scheduler tick, from the PIT or the local APIC timer */
+#define TIMER_VECTOR 0x20
+
+/* Starts the scheduler tick on the local APIC timer, or the PIT */
+void timer_init(void);
+
 /* Function to initialize the pit */
 void pit_init(void);
 
+/* Programs channel 0 to interrupt TICK_HZ times a second */
+void pit_periodic(void);
+
+/* Programs channel 0 to interrupt once, count clocks from now */
+void pit_oneshot(uint32_t count);
+
+/* Returns channel 0's current count */
+uint32_t pit_read_count(void);
+
+/* Busy-waits with PIT channel 2, for up to 50ms */
+void pit_delay_ms(uint32_t ms);
+
 /* Function that handles pit-generated interrupts */
 void pit_interrupt_handler(void);
 
@@ -0,0 +1,528 @@
+/*procfs.c
+ *Read-only text files that describe the running kernel, generated from its
+ *state on every read, so cat can inspect a live system. They aren't in the
+ *boot block: open and stat fall back to procfs_lookup for names starting
+ *with "proc/", and the descriptor gets procfs_op_table. The inode number
+ *says which file it is.
+ *
+ *    proc            the list of files below
+ *    proc/ps         one line per process
+ *    proc/<pid>      everything about one process
+ *    proc/meminfo    user frames and process slots
+ *    proc/interrupts how often each vector was taken
+ *    proc/syscalls   how often each syscall was made
+ *    proc/sched      ticks, switches, and what each CPU runs
+ *    proc/irqstat    handler, interrupts-off and wakeup time histograms
+ */
+
+#include "procfs.h"
+#include "lib.h"
+#include "filesys.h"
+#include "syscall.h"
+#include "paging.h"
+#include "smp.h"
+#include "tick.h"
+#include "pit.h"
+#include "int_setup.h"
+#include "irqstat.h"
+
+/*Largest file procfs generates; longer text is cut off*/
+#define PROCFS_BUF_SIZE   4096
+/*Names of the files below proc/*/
+#define PROC_PREFIX       "proc/"
+#define PROC_PREFIX_LEN   5
+/*Inode numbers: the fixed files, then one per PID*/
+#define PROC_ROOT         0
+#define PROC_PS           1
+#define PROC_MEMINFO      2
+#define PROC_INTERRUPTS   3
+#define PROC_SYSCALLS     4
+#define PROC_SCHED        5
+#define PROC_IRQSTAT      6
+#define NUM_PROC_FILES    7
+#define PROC_PID_BASE     16
+/*Digits in a 32-bit number, and a NUL*/
+#define NUM_BUF_SIZE      11
+
+static const int8_t * proc_files[NUM_PROC_FILES] = {
+      "", "ps", "meminfo", "interrupts", "syscalls", "sched", "irqstat"
+};
+
+static const int8_t * state_names[] = {
+      "running", "waiting", "zombie", "futex", "sleeping"
+};
+
+static const int8_t * syscall_names[NUM_SYSCALLS + 1] = {
+      "(bad)", "halt", "execute", "read", "write", "open", "close",
+      "getargs", "vidmap", "set_handler", "sigreturn", "fcntl", "lseek",
+      "pread", "pwrite", "readv", "writev", "stat", "fstat", "dirstat",
+      "getdents", "kill", "spawn", "wait", "waitpid", "fork",
+      "thread_create", "futex", "sysstat", "nice", "procstat"
+};
+
+/*The text of the file being read*/
+static int8_t text[PROCFS_BUF_SIZE];
+static uint32_t text_len;
+
+static void emit(const int8_t * s);
+static void emit_col(const int8_t * s, uint32_t width);
+static void emit_num(uint32_t value, uint32_t width);
+static void emit_field(const int8_t * name, uint32_t value);
+static int32_t parse_pid(const uint8_t * s);
+static int32_t generate(uint32_t inode);
+static void gen_root(void);
+static void gen_ps(void);
+static void gen_pid(int PID);
+static void gen_meminfo(void);
+static void gen_interrupts(void);
+static void gen_syscalls(void);
+static void gen_sched(void);
+static void gen_irqstat(void);
+
+/* emit
+ * Appends s to the text, as much of it as fits.
+ */
+static void emit(const int8_t * s){
+      while(*s != '\0' && text_len < PROCFS_BUF_SIZE){
+            text[text_len++] = *s++;
+      }
+      return;
+}
+
+/* emit_col
+ * Appends s left-aligned in a column of width characters.
+ */
+static void emit_col(const int8_t * s, uint32_t width){
+      uint32_t len = strlen(s);
+
+      emit(s);
+      while(len++ < width){
+            emit(" ");
+      }
+      return;
+}
+
+/* emit_num
+ * Appends value in decimal, in a column of width characters.
+ */
+static void emit_num(uint32_t value, uint32_t width){
+      int8_t buf[NUM_BUF_SIZE];
+
+      emit_col(itoa(value, buf, 10), width);
+      return;
+}
+
+/* emit_field
+ * Appends a "name: value" line.
+ */
+static void emit_field(const int8_t * name, uint32_t value){
+      emit(name);
+      emit(": ");
+      emit_num(value, 0);
+      emit("\n");
+      return;
+}
+
+/* parse_pid
+ * Reads a decimal PID. Returns it, or -1 if s isn't one.
+ */
+static int32_t parse_pid(const uint8_t * s){
+      int32_t pid = 0;
+
+      if(*s == '\0'){
+            return -1;
+      }
+      for(; *s != '\0'; s++){
+            if(*s < '0' || *s > '9' || pid >= MAX_CONCURRENT_TASKS){
+                  return -1;
+            }
+            pid = pid * 10 + (*s - '0');
+      }
+      return (pid < MAX_CONCURRENT_TASKS) ? pid : -1;
+}
+
+/* procfs_lookup
+ * DESCRIPTION:   Finds the generated file called filename: "proc" itself,
+ *                one of the fixed files below it, or the PID of a live
+ *                process.
+ * INPUTS:        filename - the name passed to open or stat
+ *                dentry - filled in with FILE_TYPE_PROC and the inode
+ * OUTPUTS:       0 on success, -1 if there is no such file
+ */
+int32_t procfs_lookup(const uint8_t * filename, dentry_t * dentry){
+      const uint8_t * name;
+      int32_t inode = -1;
+      int32_t pid;
+      int i;
+
+      if(strncmp((const int8_t *)filename, "proc", FNAME_MAX_LEN) == 0){
+            inode = PROC_ROOT;
+      }
+      else if(strncmp((const int8_t *)filename, PROC_PREFIX, PROC_PREFIX_LEN) == 0){
+            name = filename + PROC_PREFIX_LEN;
+            for(i = PROC_PS; i < NUM_PROC_FILES; i++){
+                  if(strncmp((const int8_t *)name, proc_files[i], FNAME_MAX_LEN) == 0){
+                        inode = i;
+                  }
+            }
+            pid = parse_pid(name);
+            if(pid != -1 && task_pcb[pid]->is_active){
+                  inode = PROC_PID_BASE + pid;
+            }
+      }
+      if(inode == -1){
+            return -1;
+      }
+
+      (void)memset(dentry, 0, sizeof(dentry_t));
+      (void)strncpy((int8_t *)dentry->file_name, (const int8_t *)filename, FNAME_MAX_LEN);
+      dentry->file_type = FILE_TYPE_PROC;
+      dentry->inode_num = inode;
+      return 0;
+}
+
+int32_t procfs_open(const uint8_t * filename){
+      return 0;
+}
+
+int32_t procfs_close(int32_t fd){
+      return 0;
+}
+
+/* procfs_write
+ * The files are read-only.
+ */
+int32_t procfs_write(int32_t fd, const void * buf, int32_t n_bytes){
+      return -1;
+}
+
+/* procfs_read
+ * DESCRIPTION:   Generates the file from the current kernel state and
+ *                copies the part of it at offset. Every read generates it
+ *                again, so a file read in pieces can be a mix of two
+ *                moments; read it in one go for a consistent view.
+ * INPUTS:        inode_index - which file
+ *                offset - the descriptor's position
+ *                buf, nbytes - where to copy to, and how much at most
+ * OUTPUTS:       bytes copied, 0 at the end, -1 if the process a
+ *                proc/<pid> file describes has gone
+ */
+int32_t procfs_read(uint32_t inode_index, uint32_t offset, uint8_t * buf, uint32_t nbytes){
+      unsigned long flags;
+      uint32_t count;
+
+      cli_and_save(flags);
+      if(generate(inode_index)){
+            restore_flags(flags);
+            return -1;
+      }
+
+      if(offset >= text_len){
+            restore_flags(flags);
+            return 0;
+      }
+      count = text_len - offset;
+      if(count > nbytes){
+            count = nbytes;
+      }
+      (void)memcpy(buf, text + offset, count);
+      restore_flags(flags);
+      return count;
+}
+
+/* generate
+ * Fills text with one file. Returns 0, or -1 for a proc/<pid> file whose
+ * process has halted.
+ */
+static int32_t generate(uint32_t inode){
+      text_len = 0;
+
+      switch(inode){
+            case PROC_ROOT:
+                  gen_root();
+                  return 0;
+            case PROC_PS:
+                  gen_ps();
+                  return 0;
+            case PROC_MEMINFO:
+                  gen_meminfo();
+                  return 0;
+            case PROC_INTERRUPTS:
+                  gen_interrupts();
+                  return 0;
+            case PROC_SYSCALLS:
+                  gen_syscalls();
+                  return 0;
+            case PROC_SCHED:
+                  gen_sched();
+                  return 0;
+            case PROC_IRQSTAT:
+                  gen_irqstat();
+                  return 0;
+            default:
+                  if(inode < PROC_PID_BASE || inode >= PROC_PID_BASE + MAX_CONCURRENT_TASKS ||
+                     !task_pcb[inode - PROC_PID_BASE]->is_active){
+                        return -1;
+                  }
+                  gen_pid(inode - PROC_PID_BASE);
+                  return 0;
+      }
+}
+
+/* gen_root
+ * The names of the files below proc/, live PIDs included.
+ */
+static void gen_root(void){
+      int i;
+
+      for(i = PROC_PS; i < NUM_PROC_FILES; i++){
+            emit(PROC_PREFIX);
+            emit(proc_files[i]);
+            emit("\n");
+      }
+      for(i = 0; i < MAX_CONCURRENT_TASKS; i++){
+            if(task_pcb[i]->is_active){
+                  emit(PROC_PREFIX);
+                  emit_num(i, 0);
+                  emit("\n");
+            }
+      }
+      return;
+}
+
+/* gen_ps
+ * One line per process: who it is and what it is doing.
+ */
+static void gen_ps(void){
+      PCB_t * pcb;
+      int i;
+
+      emit("PID PPID TTY CPU STATE    PRI NI NAME\n");
+      for(i = 0; i < MAX_CONCURRENT_TASKS; i++){
+            pcb = task_pcb[i];
+            if(!pcb->is_active){
+                  continue;
+            }
+            emit_num(i, 4);
+            if(i < 3){
+                  emit_col("-", 5);
+            }
+            else{
+                  emit_num(pcb->parent_pcb->PID, 5);
+            }
+            emit_num(pcb->terminal + 1, 4);
+            emit_num(pcb->cpu, 4);
+            emit_col((pcb->state <= TASK_SLEEPING) ? state_names[pcb->state] : "?", 9);
+            emit_num(pcb->prio, 4);
+            emit_num(pcb->nice, 3);
+            emit((const int8_t *)pcb->name);
+            emit("\n");
+      }
+      return;
+}
+
+/* gen_pid
+ * Everything the PCB says about one process, a field per line.
+ */
+static void gen_pid(int PID){
+      PCB_t * pcb = task_pcb[PID];
+
+      emit("name: ");
+      emit((const int8_t *)pcb->name);
+      emit("\n");
+      emit_field("pid", PID);
+      if(PID >= 3){
+            emit_field("parent", pcb->parent_pcb->PID);
+      }
+      emit("state: ");
+      emit((pcb->state <= TASK_SLEEPING) ? state_names[pcb->state] : "?");
+      emit("\n");
+      emit_field("terminal", pcb->terminal + 1);
+      emit_field("cpu", pcb->cpu);
+      emit_field("mm", pcb->mm_pid);
+      emit_field("pages", user_space_pages(pcb->mm_pid));
+      emit_field("prio", pcb->prio);
+      emit_field("nice", pcb->nice);
+      emit_field("utime", pcb->acct.utime);
+      emit_field("stime", pcb->acct.stime);
+      emit_field("switches", pcb->acct.switches);
+      emit_field("syscalls", pcb->acct.syscalls);
+      emit_field("bytes_read", pcb->acct.bytes_read);
+      emit_field("bytes_written", pcb->acct.bytes_written);
+      emit_field("faults", pcb->acct.faults);
+      emit_field("sig_pending", pcb->sig_pending);
+      emit_field("sig_mask", pcb->sig_mask);
+      return;
+}
+
+/* gen_meminfo
+ * Use of the 4kB frames user programs get, and of the process slots.
+ */
+static void gen_meminfo(void){
+      uint32_t used;
+      uint32_t shared;
+      uint32_t active = 0;
+      int i;
+
+      user_frame_usage(&used, &shared);
+      for(i = 0; i < MAX_CONCURRENT_TASKS; i++){
+            if(task_pcb[i]->is_active){
+                  active++;
+            }
+      }
+
+      emit_field("user_frames", NUM_USER_FRAMES);
+      emit_field("user_frames_used", used);
+      emit_field("user_frames_free", NUM_USER_FRAMES - used);
+      emit_field("user_frames_shared", shared);
+      emit_field("processes", active);
+      emit_field("processes_max", MAX_CONCURRENT_TASKS);
+      return;
+}
+
+/* gen_interrupts
+ * Every vector taken at least once, with its count.
+ */
+static void gen_interrupts(void){
+      int i;
+
+      emit("VEC COUNT      NAME\n");
+      for(i = 0; i < NUM_VECTORS; i++){
+            if(vector_count[i] == 0){
+                  continue;
+            }
+            emit_num(i, 4);
+            emit_num(vector_count[i], 11);
+            switch(i){
+                  case 0x0E: emit("page fault");  break;
+                  case 0x20: emit("timer");       break;
+                  case 0x21: emit("keyboard");    break;
+                  case 0x24: emit("serial");      break;
+                  case 0x28: emit("rtc");         break;
+                  case 0x80: emit("syscall");     break;
+                  case 0xFF: emit("spurious");    break;
+                  case 0x100: emit("unhandled");  break;
+                  default:
+                        if(i < 0x20){
+                              emit("exception");
+                        }
+                        break;
+            }
+            emit("\n");
+      }
+      return;
+}
+
+/* gen_syscalls
+ * Every syscall made at least once, with its count.
+ */
+static void gen_syscalls(void){
+      int i;
+
+      emit("NUM COUNT      NAME\n");
+      for(i = 0; i <= NUM_SYSCALLS; i++){
+            if(syscall_count[i] == 0){
+                  continue;
+            }
+            emit_num(i, 4);
+            emit_num(syscall_count[i], 11);
+            emit(syscall_names[i]);
+            emit("\n");
+      }
+      return;
+}
+
+/* gen_sched
+ * The tick, the switch counts, and what every CPU is doing.
+ */
+static void gen_sched(void){
+      uint32_t level_count[MLFQ_LEVELS];
+      int i;
+
+      for(i = 0; i < MLFQ_LEVELS; i++){
+            level_count[i] = 0;
+      }
+      for(i = 0; i < MAX_CONCURRENT_TASKS; i++){
+            if(task_pcb[i]->is_active && task_pcb[i]->state == TASK_RUNNING){
+                  level_count[task_pcb[i]->prio]++;
+            }
+      }
+
+      emit_field("tick_hz", TICK_HZ);
+      emit_field("jiffies", jiffies);
+      emit_field("idle_jiffies", idle_jiffies);
+      emit_field("tick_stopped", tick_stopped);
+      emit_field("interrupts", nr_interrupts);
+      emit_field("switches", nr_switches);
+      for(i = 0; i < MLFQ_LEVELS; i++){
+            emit("runnable_level");
+            emit_num(i, 0);
+            emit(": ");
+            emit_num(level_count[i], 0);
+            emit("\n");
+      }
+      emit_field("cpus", num_cpus);
+      for(i = 0; i < num_cpus; i++){
+            emit("cpu");
+            emit_num(i, 0);
+            emit(": online ");
+            emit_num(cpus[i].online, 0);
+            emit(" idle ");
+            emit_num(cpus[i].idle, 0);
+            emit(" current ");
+            if(cpus[i].current == -1){
+                  emit("-");
+            }
+            else{
+                  emit_num(cpus[i].current, 0);
+            }
+            emit("\n");
+      }
+      return;
+}
+
+/* gen_irqstat
+ * The handler time histograms and the interrupts-off histogram, one
+ * line per non-empty log2 bucket with its lower bound in cycles and,
+ * once the TSC is measured, in microseconds.
+ */
+static void gen_irqstat(void){
+      lat_hist_t * hist;
+      int i;
+      int b;
+
+      emit_field("tsc_per_us", tsc_per_us);
+      for(i = 0; i < NUM_IRQSTATS; i++){
+            hist = &irqstat[i];
+            if(hist->count == 0 && hist->switched == 0){
+                  continue;
+            }
+            emit(irqstat_names[i]);
+            emit(": count ");
+            emit_num(hist->count, 0);
+            emit(" switched ");
+            emit_num(hist->switched, 0);
+            emit(" max ");
+            emit_num(hist->max, 0);
+            if(tsc_per_us != 0){
+                  emit(" cycles = ");
+                  emit_num(hist->max / tsc_per_us, 0);
+                  emit("us");
+            }
+            emit("\n");
+            for(b = 0; b < LAT_BUCKETS; b++){
+                  if(hist->bucket[b] == 0){
+                        continue;
+                  }
+                  emit("  >= 2^");
+                  emit_num(b, 3);
+                  if(tsc_per_us != 0){
+                        emit_num((1U << b) / tsc_per_us, 7);
+                        emit("us ");
+                  }
+                  emit_num(hist->bucket[b], 0);
+                  emit("\n");
+            }
+      }
+      return;
+}
@@ -0,0 +1,17 @@
+/* procfs.h: Header file for the generated proc/ files */
+#ifndef _PROCFS_H
+#define _PROCFS_H
+
+#include "types.h"
+#include "structures.h"
+
+/* Fills in a dentry for a proc/ name; returns 0 if there is such a file */
+int32_t procfs_lookup(const uint8_t * filename, dentry_t * dentry);
+
+/* op table functions: read-only text made up on every read */
+int32_t procfs_open(const uint8_t * filename);
+int32_t procfs_read(uint32_t inode_index, uint32_t offset, uint8_t * buf, uint32_t nbytes);
+int32_t procfs_write(int32_t fd, const void * buf, int32_t n_bytes);
+int32_t procfs_close(int32_t fd);
+
+#endif  /* _PROCFS_H */
@@ -1,8 +1,10 @@
 #include "lib.h"
 #include "rtc.h"
-#include "i8259.h"
+#include "irq.h"
 #include "keyboard.h"
 #include "term_sched.h"
+#include "signal.h"
+#include "bh.h"
 
 #define REGISTER_A          0x8A
 #define REGISTER_B          0x8B
@@ -14,6 +16,13 @@
 #define RTC_IRQ_ON_MASTER   0x08
 #define HERTZ_2             0x0F
 #define EINVAL              1
+#define EINTR               4
+/* Interrupts nobody reads before the periodic interrupt is turned off */
+#define RTC_IDLE_IRQS       2
+
+static void rtc_set_periodic(unsigned int on);
+static void rtc_want(void);
+static void rtc_bh(void);
 
 
 /* Used in a test for checkpoint 1
@@ -23,6 +32,9 @@ volatile unsigned int rtc_count = 0;
 /* Variable checks if rtc has been initialized */
 volatile unsigned int rtc_init_check = 0;
 volatile unsigned int rtc_interrupt_flag[3];
+/* Whether the periodic interrupt is on, and how many went unread */
+static volatile unsigned int rtc_periodic_on = 0;
+static volatile unsigned int rtc_unread = 0;
 
 /* Variable checks if an interrupt has been raised */
 
@@ -46,9 +58,10 @@ void rtc_init(void) {
     /* Activate Bit 6 of Register B */
     reg_b_bit_6 = curr_reg_b_val | BIT_6_MASK;
     outb(reg_b_bit_6, REG_CMOS);
+    rtc_periodic_on = 1;
 
     /* Once initialized, enable the IRQ line for the RTC */
-    enable_irq(RTC_IRQ_ON_MASTER);
+    irq_enable(RTC_IRQ_ON_MASTER);
 
     /* Change value to one to show we've initialized the rtc */
     rtc_init_check = 1;
@@ -57,16 +70,18 @@ void rtc_init(void) {
     rtc_interrupt_flag[1] = 0;
     rtc_interrupt_flag[2] = 0;
 
+    bh_install(BH_RTC, rtc_bh);
+
     /* Re-enable interrupts */
     sti();
 }
 
-/* Function that handles rtc-generated interrupts */
+/* Function that handles rtc-generated interrupts: acknowledges the
+ * interrupt and leaves waking the readers to rtc_bh
+ */
 void rtc_interrupt_handler(void) {
-  /* Disable all interrupts */
-  cli();
   /* send E0I on RTC line */
-  send_eoi(RTC_IRQ_ON_MASTER);
+  irq_eoi(RTC_IRQ_ON_MASTER);
 
   /* Set interrupt flag to 1 because an interrupt is occuring */
   rtc_interrupt_flag[0] = 1;
@@ -83,8 +98,19 @@ void rtc_interrupt_handler(void) {
   outb(REGISTER_C, REG_NUM_PORT);
   inb(REG_CMOS);
 
-  /* Re-enable interrupts */
-  sti();
+  bh_raise(BH_RTC);
+}
+
+/* Bottom half of the RTC interrupt, run with interrupts on */
+static void rtc_bh(void) {
+  wake_up_interactive((void *)rtc_interrupt_flag);
+
+  /* Nobody has read the RTC for a while: stop interrupting an idle
+   * CPU until somebody does again.
+   */
+  rtc_unread++;
+  if(rtc_unread >= RTC_IDLE_IRQS)
+      rtc_set_periodic(0);
 }
 
 /* Function that opens the RTC */
@@ -172,17 +198,58 @@ int32_t rtc_write(int32_t fd, const void * buf, int32_t nbytes) {
     return nbytes;
 }
 
+/* Function that turns the periodic interrupt (bit 6 of register B) on or off */
+static void rtc_set_periodic(unsigned int on) {
+    unsigned long flags;
+    unsigned char reg_b;
+
+    cli_and_save(flags);
+    if(rtc_periodic_on != on) {
+        outb(REGISTER_B, REG_NUM_PORT);
+        reg_b = inb(REG_CMOS);
+        outb(REGISTER_B, REG_NUM_PORT);
+        outb(on ? (reg_b | BIT_6_MASK) : (reg_b & ~BIT_6_MASK), REG_CMOS);
+        rtc_periodic_on = on;
+    }
+    rtc_unread = 0;
+    restore_flags(flags);
+}
+
+/* Function that marks the RTC as in use, turning interrupts back on */
+static void rtc_want(void) {
+    if(rtc_init_check)
+        rtc_set_periodic(1);
+}
+
 /* Function that reads the RTC */
 int32_t rtc_read(uint32_t inode_index, uint32_t offset, uint8_t * buf, uint32_t nbytes) {
-    /* Spin while we wait for interrupts to get disabled */
-    while(!rtc_interrupt_flag[running_display]) {}
+    unsigned long flags;
+
+    /* Sleep until the interrupt handler wakes us */
+    spin_lock_irqsave(&wait_lock, flags);
+    rtc_want();
+    while(!rtc_interrupt_flag[running_display]) {
+        /* Give up if the program is about to be killed */
+        if(signal_fatal_pending()) {
+            spin_unlock_irqrestore(&wait_lock, flags);
+            return -EINTR;
+        }
+        sleep_on((void *)rtc_interrupt_flag);
+    }
 
     /* When interrupt is completed, set to 0 */
     rtc_interrupt_flag[running_display] = 0;
+    spin_unlock_irqrestore(&wait_lock, flags);
 
     return 0;
 }
 
+/* Function that reports whether an RTC read would return without waiting */
+int32_t rtc_poll(uint32_t inode_index) {
+    rtc_want();
+    return rtc_interrupt_flag[running_display];
+}
+
 /* Function that closes the RTC */
 int32_t rtc_close(int32_t fd) {
     return 0;
@@ -27,6 +27,9 @@ int32_t rtc_write(int32_t fd, const void * buf, int32_t n_bytes);
 /* Function that reads the RTC */
 int32_t rtc_read(uint32_t inode_index, uint32_t offset, uint8_t * buf, uint32_t nbytes);
 
+/* Function that reports whether an RTC read would return without waiting */
+int32_t rtc_poll(uint32_t inode_index);
+
 /* Function that closes the RTC */
 int32_t rtc_close(int32_t fd);
 
@@ -0,0 +1,250 @@
+/*serial.c
+ *COM1, a 16550 UART, for output a host can capture (QEMU's -serial).
+ *Writes only copy into tx_ring; the UART takes it from there a FIFO's
+ *worth at a time, refilled from its transmit interrupt, so nothing that
+ *logs ever waits on the line. A write that doesn't fit in the ring is
+ *dropped whole rather than waited for. serial_flush is the one place
+ *that polls, for when interrupts won't come again.
+ */
+
+#include "serial.h"
+#include "lib.h"
+#include "irq.h"
+#include "spinlock.h"
+
+/*COM1 and its registers, as offsets from it*/
+#define COM1              0x3F8
+#define UART_DATA         0           //transmit/receive, divisor low with DLAB
+#define UART_IER          1           //interrupt enable, divisor high with DLAB
+#define UART_IIR          2           //interrupt identification, when read
+#define UART_FCR          2           //FIFO control, when written
+#define UART_LCR          3           //line control
+#define UART_MCR          4           //modem control
+#define UART_LSR          5           //line status
+#define UART_SCRATCH      7
+
+#define LCR_DLAB          0x80        //data registers are the divisor
+#define LCR_8N1           0x03
+#define FCR_ENABLE_CLEAR  0x07        //FIFOs on and emptied
+#define MCR_DTR_RTS_OUT2  0x0B        //OUT2 connects the UART's IRQ
+#define LSR_THRE          0x20        //transmit FIFO empty
+#define IER_THRI          0x02        //interrupt when the transmit FIFO empties
+#define IIR_NONE          0x01        //no interrupt pending
+#define IIR_ID            0x0E
+#define IIR_THRI          0x02
+
+/*115200 baud: the 1.8432MHz clock over 16, divided by 1*/
+#define BAUD_DIVISOR      1
+
+/*Bytes the UART takes at once when its FIFO is empty*/
+#define TX_FIFO_SIZE      16
+
+/*Bytes queued for sending, a power of two. At 115200 baud this is a
+ *second and a half of output.*/
+#define TX_RING_SIZE      16384
+
+/*How many times serial_flush polls for an empty FIFO before giving up on
+ *a stuck UART, and how many interrupt causes the handler takes at once*/
+#define TX_SPINS          100000
+#define MAX_IIR_LOOPS     16
+
+#define SCRATCH_TEST      0xAE
+
+/*0 if there is no UART at COM1, so output is just dropped*/
+static uint32_t serial_present = 0;
+
+/*The bytes waiting to go out, from tx_tail up to tx_head. Both only ever
+ *count up; their difference is the number queued.*/
+static uint8_t tx_ring[TX_RING_SIZE];
+static uint32_t tx_head = 0;
+static uint32_t tx_tail = 0;
+/*What IER was last set to: IER_THRI while the UART is sending from the
+ *ring and will interrupt for more*/
+static uint32_t tx_ier = 0;
+static spinlock_t tx_lock = SPINLOCK_INIT;
+
+uint32_t serial_dropped = 0;
+
+static void tx_fill(void);
+
+/* serial_init
+ * DESCRIPTION:   Checks for a UART at COM1 through its scratch register,
+ *                and sets it to 115200 8N1 with the FIFOs on. Its
+ *                interrupt is enabled, though the UART only raises it
+ *                while there is something to send.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ */
+void serial_init(void){
+      outb(SCRATCH_TEST, COM1 + UART_SCRATCH);
+      if(inb(COM1 + UART_SCRATCH) != SCRATCH_TEST){
+            return;
+      }
+
+      outb(0, COM1 + UART_IER);
+      outb(LCR_DLAB, COM1 + UART_LCR);
+      outb(BAUD_DIVISOR & 0xFF, COM1 + UART_DATA);
+      outb(BAUD_DIVISOR >> 8, COM1 + UART_IER);
+      outb(LCR_8N1, COM1 + UART_LCR);
+      outb(FCR_ENABLE_CLEAR, COM1 + UART_FCR);
+      outb(MCR_DTR_RTS_OUT2, COM1 + UART_MCR);
+      serial_present = 1;
+
+      irq_enable(SERIAL_IRQ);
+      return;
+}
+
+/* tx_fill
+ * DESCRIPTION:   Moves up to a FIFO's worth of the ring into the UART if
+ *                its FIFO is empty, and has it interrupt when it empties
+ *                again for as long as anything is left. Called with
+ *                tx_lock held.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ */
+static void tx_fill(void){
+      uint32_t ier;
+      uint32_t n;
+
+      if(inb(COM1 + UART_LSR) & LSR_THRE){
+            for(n = 0; n < TX_FIFO_SIZE && tx_tail != tx_head; n++){
+                  outb(tx_ring[tx_tail % TX_RING_SIZE], COM1 + UART_DATA);
+                  tx_tail++;
+            }
+      }
+
+      ier = (tx_tail != tx_head) ? IER_THRI : 0;
+      if(ier != tx_ier){
+            outb(ier, COM1 + UART_IER);
+            tx_ier = ier;
+      }
+      return;
+}
+
+/* serial_write
+ * DESCRIPTION:   Queues bytes to be sent, with a carriage return before
+ *                each newline, for terminals. Never waits: if they don't
+ *                all fit in the ring, none of them are queued.
+ * INPUTS:        buf - the bytes
+ *                n - how many
+ * OUTPUTS:       none
+ * SIDE EFFECTS:  starts the UART sending if it was idle
+ */
+void serial_write(const int8_t * buf, uint32_t n){
+      unsigned long flags;
+      uint32_t needed = n;
+      uint32_t i;
+
+      if(!serial_present || n == 0){
+            return;
+      }
+      for(i = 0; i < n; i++){
+            if(buf[i] == '\n'){
+                  needed++;
+            }
+      }
+
+      spin_lock_irqsave(&tx_lock, flags);
+      if(needed > TX_RING_SIZE - (tx_head - tx_tail)){
+            serial_dropped += n;
+            spin_unlock_irqrestore(&tx_lock, flags);
+            return;
+      }
+      for(i = 0; i < n; i++){
+            if(buf[i] == '\n'){
+                  tx_ring[tx_head % TX_RING_SIZE] = '\r';
+                  tx_head++;
+            }
+            tx_ring[tx_head % TX_RING_SIZE] = buf[i];
+            tx_head++;
+      }
+      //while the interrupt is armed it will come for these too
+      if(!tx_ier){
+            tx_fill();
+      }
+      spin_unlock_irqrestore(&tx_lock, flags);
+      return;
+}
+
+/* serial_putc
+ * DESCRIPTION:   Queues one character.
+ * INPUTS:        c - the character
+ * OUTPUTS:       none
+ */
+void serial_putc(uint8_t c){
+      serial_write((const int8_t *)&c, 1);
+      return;
+}
+
+/* serial_puts
+ * DESCRIPTION:   Queues a string.
+ * INPUTS:        s - the string
+ * OUTPUTS:       none
+ */
+void serial_puts(const int8_t * s){
+      serial_write(s, strlen(s));
+      return;
+}
+
+/* serial_interrupt_handler
+ * DESCRIPTION:   The UART's transmit FIFO emptied: refill it from the
+ *                ring, or stop the interrupt once the ring is empty.
+ *                Reading IIR acknowledges it.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ */
+void serial_interrupt_handler(void){
+      uint32_t iir;
+      uint32_t i;
+
+      spin_lock(&tx_lock);
+      for(i = 0; i < MAX_IIR_LOOPS; i++){
+            iir = inb(COM1 + UART_IIR);
+            if(iir & IIR_NONE){
+                  break;
+            }
+            if((iir & IIR_ID) == IIR_THRI){
+                  tx_fill();
+            }
+      }
+      spin_unlock(&tx_lock);
+
+      irq_eoi(SERIAL_IRQ);
+      return;
+}
+
+/* serial_flush
+ * DESCRIPTION:   Sends everything queued by polling the UART, with
+ *                interrupts off. Only for when the transmit interrupt
+ *                won't come, like a crash about to halt: it doesn't take
+ *                tx_lock, which the crashed code may hold.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ */
+void serial_flush(void){
+      unsigned long flags;
+      uint32_t spins;
+      uint32_t n;
+
+      if(!serial_present){
+            return;
+      }
+
+      cli_and_save(flags);
+      while(tx_tail != tx_head){
+            for(spins = 0; spins < TX_SPINS; spins++){
+                  if(inb(COM1 + UART_LSR) & LSR_THRE){
+                        break;
+                  }
+            }
+            if(spins == TX_SPINS){
+                  break;
+            }
+            for(n = 0; n < TX_FIFO_SIZE && tx_tail != tx_head; n++){
+                  outb(tx_ring[tx_tail % TX_RING_SIZE], COM1 + UART_DATA);
+                  tx_tail++;
+            }
+      }
+      restore_flags(flags);
+      return;
+}
@@ -0,0 +1,28 @@
+/* serial.h: Header file for the serial port (COM1) */
+#ifndef _SERIAL_H
+#define _SERIAL_H
+
+#include "types.h"
+
+/* COM1's IRQ, vector 0x24 */
+#define SERIAL_IRQ        4
+
+/* Bytes serial_write dropped because the ring was full */
+extern uint32_t serial_dropped;
+
+/* Sets up COM1 for 115200 8N1 and enables its IRQ, if there is one */
+void serial_init(void);
+
+/* Queue bytes to be sent from the transmit interrupt, without waiting;
+ * '\n' goes out as "\r\n" */
+void serial_write(const int8_t * buf, uint32_t n);
+void serial_putc(uint8_t c);
+void serial_puts(const int8_t * s);
+
+/* Refills the UART from the ring when it has sent what it had */
+void serial_interrupt_handler(void);
+
+/* Sends everything queued by polling, for when interrupts are off for good */
+void serial_flush(void);
+
+#endif  /* _SERIAL_H */
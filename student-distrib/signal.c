@@ -0,0 +1,369 @@
+/*signal.c
+ *Per-process signal handler tables, pending and masked signals, and the
+ *code that builds and tears down the user-stack frames signal handlers run
+ *on. Signals are only ever delivered on the way back to user mode, from
+ *common_interrupt in int_setup.S.
+ */
+
+#include "signal.h"
+#include "lib.h"
+#include "x86_desc.h"
+#include "syscall.h"
+#include "term_sched.h"
+#include "smp.h"
+#include "tick.h"
+
+/*All signals: blocked while a handler runs*/
+#define ALL_SIGNALS ((1 << NUM_SIGNALS) - 1)
+/*Requested privilege level bits of a segment selector*/
+#define RPL_MASK 0x3
+#define USER_RPL 0x3
+/*EFLAGS bits user code may change through a signal frame*/
+#define EFLAGS_USER_MASK 0x00000CD5
+/*Interrupt enable flag*/
+#define EFLAGS_IF 0x00000200
+/*PIDs 0-2 are the base shells, one per terminal*/
+#define BASE_SHELLS 3
+/*Bytes reserved on the user stack for the sigreturn trampoline*/
+#define TRAMPOLINE_LEN 8
+
+/*The sigreturn trampoline copied onto the user stack:
+ *    MOVL $10, %EAX
+ *    INT $0x80
+ *A handler's RET lands here, which calls sigreturn.
+ */
+static const uint8_t sigreturn_trampoline[TRAMPOLINE_LEN] = {
+      0xB8, 0x0A, 0x00, 0x00, 0x00,
+      0xCD, 0x80,
+      0x90
+};
+
+/*jiffies at the last ALARM*/
+static uint32_t last_alarm = 0;
+
+static int32_t default_is_kill(int32_t signum);
+
+/* signal_init
+ * DESCRIPTION:   Gives a new process default actions for every signal, with
+ *                nothing pending and nothing masked, and not exiting.
+ * INPUTS:        pcb - the process being created
+ * OUTPUTS:       none
+ * SIDE EFFECTS:  resets pcb's signal state
+ */
+void signal_init(PCB_t * pcb){
+      int i;
+      for(i = 0; i < NUM_SIGNALS; i++){
+            pcb->sig_handlers[i] = NULL;
+      }
+      pcb->sig_pending = 0;
+      pcb->sig_mask = 0;
+      pcb->exiting = 0;
+      return;
+}
+
+/* default_is_kill
+ * DESCRIPTION:   The default action of DIV_ZERO, SEGFAULT and INTERRUPT is
+ *                to kill the program; ALARM and USER1 are ignored.
+ * INPUTS:        signum - the signal
+ * OUTPUTS:       1 if the default action kills the process, 0 otherwise
+ */
+static int32_t default_is_kill(int32_t signum){
+      return (signum == DIV_ZERO || signum == SEGFAULT || signum == INTERRUPT);
+}
+
+/* send_signal
+ * DESCRIPTION:   Marks a signal as pending on a process, waking it if it
+ *                sleeps in futex or on a wait channel. Signals whose action would be to do
+ *                nothing are dropped right away so they never wake
+ *                anything up.
+ * INPUTS:        pcb - the receiving process
+ *                signum - the signal to send
+ * OUTPUTS:       none
+ * SIDE EFFECTS:  sets a bit in pcb->sig_pending
+ */
+void send_signal(PCB_t * pcb, int32_t signum){
+      unsigned long flags;
+
+      if(pcb == NULL || !pcb->is_active){
+            return;
+      }
+      if(signum < 0 || signum >= NUM_SIGNALS){
+            return;
+      }
+      if(pcb->sig_handlers[signum] == NULL && !default_is_kill(signum)){
+            return;
+      }
+      //under wait_lock, so a sleeper checking for signals on another CPU
+      //either sees it or is woken
+      spin_lock_irqsave(&wait_lock, flags);
+      pcb->sig_pending |= (1 << signum);
+
+      //cut a sleep short so the signal gets delivered
+      if((pcb->state == TASK_FUTEX || pcb->state == TASK_SLEEPING) &&
+         !(pcb->sig_mask & (1 << signum))){
+            wake_task(pcb);
+      }
+      spin_unlock_irqrestore(&wait_lock, flags);
+      return;
+}
+
+/* signal_exception
+ * DESCRIPTION:   Converts an exception raised by user code into a signal for
+ *                the running process: DIV_ZERO for a divide error and
+ *                SEGFAULT for everything else. The faulting instruction is
+ *                retried after the handler returns, so a fault raised while
+ *                the signal is masked (inside its own handler) kills the
+ *                program instead of looping forever.
+ * INPUTS:        vector_num - the exception vector
+ * OUTPUTS:       0 if the signal was raised, -1 if the process is a base
+ *                shell with no handler, which can't be killed
+ * SIDE EFFECTS:  may make the current process' signal pending and unmasked
+ */
+int32_t signal_exception(uint32_t vector_num){
+      PCB_t * pcb = get_pcb_ptr();
+      int32_t signum = (vector_num == 0) ? DIV_ZERO : SEGFAULT;
+
+      if(pcb->sig_mask & (1 << signum)){
+            pcb->sig_handlers[signum] = NULL;
+            pcb->sig_mask &= ~(1 << signum);
+      }
+      if(pcb->PID < BASE_SHELLS && pcb->sig_handlers[signum] == NULL){
+            return -1;
+      }
+      send_signal(pcb, signum);
+      return 0;
+}
+
+/* signal_interrupt_current_term
+ * DESCRIPTION:   Ctrl+C: sends INTERRUPT to the program in the foreground
+ *                of the terminal currently on screen.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ * SIDE EFFECTS:  may make INTERRUPT pending on that process
+ */
+void signal_interrupt_current_term(void){
+      send_signal(task_pcb[current_pid[current_display]], INTERRUPT);
+      return;
+}
+
+/* signal_alarm_tick
+ * DESCRIPTION:   Called on every timer interrupt. Every ALARM_TICKS ticks
+ *                the foreground program of each terminal gets an ALARM.
+ *                Goes by jiffies, so ticks skipped while idle still count.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ * SIDE EFFECTS:  may make ALARM pending on up to three processes
+ */
+void signal_alarm_tick(void){
+      int i;
+
+      if(jiffies - last_alarm < ALARM_TICKS){
+            return;
+      }
+      last_alarm = jiffies;
+
+      for(i = 0; i < BASE_SHELLS; i++){
+            send_signal(task_pcb[current_pid[i]], ALARM);
+      }
+      return;
+}
+
+/* signal_alarm_next
+ * DESCRIPTION:   How long the timer may stay quiet before the next ALARM
+ *                is due.
+ * INPUTS:        none
+ * OUTPUTS:       ticks until the next ALARM, at least 1
+ */
+uint32_t signal_alarm_next(void){
+      uint32_t since = jiffies - last_alarm;
+
+      if(since >= ALARM_TICKS){
+            return 1;
+      }
+      return ALARM_TICKS - since;
+}
+
+/* signal_fatal_pending
+ * DESCRIPTION:   Lets drivers that wait for input give up early when the
+ *                current process is about to be killed, e.g. by Ctrl+C
+ *                while it waits for a line from the keyboard.
+ * INPUTS:        none
+ * OUTPUTS:       1 if an unmasked pending signal will kill the process
+ */
+int32_t signal_fatal_pending(void){
+      PCB_t * pcb = get_pcb_ptr();
+      uint32_t deliverable = pcb->sig_pending & ~pcb->sig_mask;
+      int i;
+
+      //a thread whose program ended is killed like a signal would
+      if(pcb->exiting){
+            return 1;
+      }
+      for(i = 0; i < NUM_SIGNALS; i++){
+            if((deliverable & (1 << i)) && pcb->sig_handlers[i] == NULL && default_is_kill(i)){
+                  return 1;
+            }
+      }
+      return 0;
+}
+
+/* do_signal
+ * DESCRIPTION:   Delivers the lowest-numbered pending, unmasked signal of
+ *                the current process. Runs the default action if there is
+ *                no handler. Otherwise it copies the interrupted context,
+ *                the signal number, and a return address into a sigreturn
+ *                trampoline onto the user stack, then makes the IRET in
+ *                common_interrupt enter the handler.
+ * INPUTS:        context - the registers saved by common_interrupt
+ * OUTPUTS:       none
+ * SIDE EFFECTS:  may rewrite the user stack, EIP and ESP in context; may
+ *                halt the process
+ */
+void do_signal(hw_context_t * context){
+      PCB_t * pcb;
+      unsigned long flags;
+      uint32_t deliverable;
+      int32_t signum;
+      uint32_t user_esp;
+      uint32_t trampoline;
+
+      //only deliver on the way back to user mode
+      if((context->CS & RPL_MASK) != USER_RPL){
+            return;
+      }
+
+      pcb = get_pcb_ptr();
+
+      //the other threads of a program that ended leave here, where they
+      //are sure to hold no locks (see end_threads)
+      if(pcb->exiting){
+            (void)halt_process(SIGNAL_KILL_STATUS);
+            return;
+      }
+
+      deliverable = pcb->sig_pending & ~pcb->sig_mask;
+      if(deliverable == 0){
+            return;
+      }
+
+      for(signum = 0; !(deliverable & (1 << signum)); signum++);
+      spin_lock_irqsave(&wait_lock, flags);
+      pcb->sig_pending &= ~(1 << signum);
+      spin_unlock_irqrestore(&wait_lock, flags);
+
+      //default actions
+      if(pcb->sig_handlers[signum] == NULL){
+            if(default_is_kill(signum)){
+                  (void)halt_process(SIGNAL_KILL_STATUS);
+            }
+            return;
+      }
+
+      //build the signal frame, from the top of the user stack down:
+      //trampoline code, saved context, signal number, return address
+      user_esp = context->ESP;
+      user_esp -= TRAMPOLINE_LEN;
+      trampoline = user_esp;
+      user_esp -= sizeof(hw_context_t);
+      user_esp -= 2 * sizeof(uint32_t);
+
+      if(user_esp < _128MB || context->ESP > _128MB + _4MB){
+            (void)halt_process(SIGNAL_KILL_STATUS);
+            return;
+      }
+
+      memcpy((void *)trampoline, sigreturn_trampoline, TRAMPOLINE_LEN);
+      memcpy((void *)(user_esp + 2 * sizeof(uint32_t)), context, sizeof(hw_context_t));
+      ((uint32_t *)user_esp)[1] = (uint32_t)signum;
+      ((uint32_t *)user_esp)[0] = trampoline;
+
+      //block all signals until the handler calls sigreturn
+      pcb->sig_mask = ALL_SIGNALS;
+
+      context->ESP = user_esp;
+      context->EIP = (uint32_t)pcb->sig_handlers[signum];
+      return;
+}
+
+/* set_handler
+ * DESCRIPTION:   Installs a user function as the handler of a signal. A
+ *                NULL handler restores the default action.
+ * INPUTS:        signum - the signal
+ *                handler_address - the user-level handler, or NULL
+ * OUTPUTS:       0 on success, -1 if signum is invalid
+ * SIDE EFFECTS:  changes the current process' handler table
+ */
+int32_t set_handler(int32_t signum, void * handler_address){
+      PCB_t * pcb = get_pcb_ptr();
+
+      if(signum < 0 || signum >= NUM_SIGNALS){
+            return -1;
+      }
+      if(handler_address != NULL &&
+         ((uint32_t)handler_address < _128MB || (uint32_t)handler_address >= _128MB + _4MB)){
+            return -1;
+      }
+
+      pcb->sig_handlers[signum] = handler_address;
+      return 0;
+}
+
+/* sigreturn_handler
+ * DESCRIPTION:   Called by the trampoline when a handler returns. Copies
+ *                the context saved by do_signal from the user stack back
+ *                over this syscall's own kernel frame, so the IRET resumes
+ *                the interrupted code. Segment and privilege state is not
+ *                taken from user memory.
+ * INPUTS:        none
+ * OUTPUTS:       the interrupted code's EAX, so the dispatcher's write of
+ *                the return value doesn't clobber it
+ * SIDE EFFECTS:  unmasks signals; rewrites the kernel frame
+ */
+int32_t sigreturn_handler(void){
+      PCB_t * pcb = get_pcb_ptr();
+      hw_context_t * kernel_frame;
+      hw_context_t * saved;
+
+      //the syscall came from user mode, so its frame sits right below esp0
+      kernel_frame = (hw_context_t *)(this_cpu()->tss->esp0 - sizeof(hw_context_t));
+
+      //the handler's RET popped the return address: ESP is at signum
+      saved = (hw_context_t *)(kernel_frame->ESP + sizeof(uint32_t));
+      if((uint32_t)saved < _128MB || (uint32_t)saved + sizeof(hw_context_t) > _128MB + _4MB){
+            (void)halt_process(SIGNAL_KILL_STATUS);
+            return -1;
+      }
+
+      kernel_frame->EBX = saved->EBX;
+      kernel_frame->ECX = saved->ECX;
+      kernel_frame->EDX = saved->EDX;
+      kernel_frame->ESI = saved->ESI;
+      kernel_frame->EDI = saved->EDI;
+      kernel_frame->EBP = saved->EBP;
+      kernel_frame->EAX = saved->EAX;
+      kernel_frame->EIP = saved->EIP;
+      kernel_frame->ESP = saved->ESP;
+      kernel_frame->EFLAGS = (kernel_frame->EFLAGS & ~EFLAGS_USER_MASK) |
+                             (saved->EFLAGS & EFLAGS_USER_MASK) | EFLAGS_IF;
+
+      pcb->sig_mask = 0;
+      return (int32_t)saved->EAX;
+}
+
+/* kill_handler
+ * DESCRIPTION:   Sends a signal to another process, e.g. USER1.
+ * INPUTS:        pid - the receiving process
+ *                signum - the signal to send
+ * OUTPUTS:       0 on success, -1 if pid or signum is invalid
+ * SIDE EFFECTS:  may make a signal pending on pid
+ */
+int32_t kill_handler(int32_t pid, int32_t signum){
+      if(pid < 0 || pid >= MAX_CONCURRENT_TASKS || !task_pcb[pid]->is_active){
+            return -1;
+      }
+      if(signum < 0 || signum >= NUM_SIGNALS){
+            return -1;
+      }
+      send_signal(task_pcb[pid], signum);
+      return 0;
+}
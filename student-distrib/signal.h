@@ -0,0 +1,76 @@
+/* signal.h: Header file for signal delivery */
+#ifndef _SIGNAL_H
+#define _SIGNAL_H
+
+#include "types.h"
+#include "structures.h"
+
+/* signal numbers, shared with user programs (see ece391syscall.h) */
+#define DIV_ZERO    0
+#define SEGFAULT    1
+#define INTERRUPT   2
+#define ALARM       3
+#define USER1       4
+
+/* PIT ticks between ALARM signals (10 seconds at 100Hz) */
+#define ALARM_TICKS 1000
+
+/* status returned to the parent when a signal kills a program */
+#define SIGNAL_KILL_STATUS 256
+
+/* Everything common_interrupt leaves on the kernel stack, lowest address
+ * first. A copy of this is what a signal handler finds on its user stack
+ * right after the signal number. */
+typedef struct hw_context {
+      uint32_t EBX;
+      uint32_t ECX;
+      uint32_t EDX;
+      uint32_t ESI;
+      uint32_t EDI;
+      uint32_t EBP;
+      uint32_t EAX;
+      uint16_t ds_pad;
+      uint16_t DS;
+      uint16_t es_pad;
+      uint16_t ES;
+      uint16_t fs_pad;
+      uint16_t FS;
+      uint32_t vector_num;
+      uint32_t error_code;
+      uint32_t EIP;
+      uint32_t CS;
+      uint32_t EFLAGS;
+      uint32_t ESP;
+      uint32_t SS;
+} hw_context_t;
+
+/* Clears the handlers, pending and masked signals of a new process */
+void signal_init(PCB_t * pcb);
+
+/* Marks a signal pending on a process, dropping it if it would be ignored */
+void send_signal(PCB_t * pcb, int32_t signum);
+
+/* Raises the signal for an exception that user code caused */
+int32_t signal_exception(uint32_t vector_num);
+
+/* Sends INTERRUPT to the program in the foreground of the visible terminal */
+void signal_interrupt_current_term(void);
+
+/* Counts PIT ticks and sends ALARM to every terminal's program */
+void signal_alarm_tick(void);
+
+/* Ticks until the next ALARM is due */
+uint32_t signal_alarm_next(void);
+
+/* Returns 1 if a pending signal will kill the current process */
+int32_t signal_fatal_pending(void);
+
+/* Called on every return to user mode from common_interrupt */
+void do_signal(hw_context_t * context);
+
+/* syscalls */
+int32_t set_handler(int32_t signum, void * handler_address);
+int32_t sigreturn_handler(void);
+int32_t kill_handler(int32_t pid, int32_t signum);
+
+#endif  /* _SIGNAL_H */
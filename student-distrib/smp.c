@@ -0,0 +1,550 @@
+/*smp.c
+ *Multiprocessor bring-up. The BIOS describes the processors and the IOAPIC
+ *in the MP configuration table; smp_init reads it, gives every other CPU
+ *its own TSS and kernel stack, and starts it with INIT and STARTUP IPIs.
+ *Once the shells exist, smp_start lets the other CPUs into the scheduler,
+ *each with its own local APIC timer tick. Without an MP table or a local
+ *APIC the kernel runs on CPU 0 alone; without the IOAPIC (no local APIC
+ *timer) the other CPUs start but never take processes.
+ */
+
+#include "smp.h"
+#include "lapic.h"
+#include "lib.h"
+#include "paging.h"
+#include "syscall.h"
+#include "ioapic.h"
+#include "fpu.h"
+#include "irq.h"
+#include "pit.h"
+#include "term_sched.h"
+
+/*where the BIOS data area keeps the EBDA segment*/
+#define BDA_EBDA_SEG      0x40E
+/*last 1kB of conventional memory, if the EBDA pointer is missing*/
+#define BASE_MEM_LAST_KB  0x9FC00
+/*the BIOS ROM*/
+#define BIOS_ROM_BEGIN    0xF0000
+#define BIOS_ROM_SIZE     0x10000
+#define KB                0x400
+/*everything low_mem_map can reach*/
+#define LOW_MEM_END       0x100000
+
+/*MP configuration table entry types, and their sizes*/
+#define MP_PROCESSOR      0
+#define MP_BUS            1
+#define MP_IOAPIC         2
+#define MP_IOINTR         3
+#define MP_LINTR          4
+#define MP_PROCESSOR_LEN  20
+#define MP_OTHER_LEN      8
+/*processor entry flags*/
+#define MP_CPU_ENABLED    0x1
+#define MP_CPU_BSP        0x2
+/*IOAPIC entry flag*/
+#define MP_IOAPIC_ENABLED 0x1
+/*interrupt entry type of a vectored interrupt*/
+#define MP_INT            0
+/*feature byte 2 bit: the IMCR is present and the PIC mode is in use*/
+#define MP_IMCRP          0x80
+
+/*CPUID.1:EDX bit: the processor has a local APIC*/
+#define CPUID_APIC        0x200
+/*each CPU's stack while it has no process to run*/
+#define CPU_STACK_SIZE    0x1000
+/*rounds of polling for a started CPU before giving up on it*/
+#define AP_START_TIMEOUT  10000000
+/*port 0x80 writes take about 1us, long enough for the IPI delays*/
+#define DELAY_PORT        0x80
+#define INIT_DELAY_US     10000
+#define STARTUP_DELAY_US  200
+
+/*MP floating pointer structure, found by its "_MP_" signature*/
+typedef struct mp_float {
+      uint8_t signature[4];
+      uint32_t config;              //physical address of the config table
+      uint8_t length;               //in 16-byte units
+      uint8_t spec_rev;
+      uint8_t checksum;
+      uint8_t feature[5];           //feature[0] != 0: a default config
+} __attribute__ ((packed)) mp_float_t;
+
+/*MP configuration table header; the entries follow it*/
+typedef struct mp_config {
+      uint8_t signature[4];         //"PCMP"
+      uint16_t length;
+      uint8_t spec_rev;
+      uint8_t checksum;
+      uint8_t oem_id[8];
+      uint8_t product_id[12];
+      uint32_t oem_table;
+      uint16_t oem_table_size;
+      uint16_t entry_count;
+      uint32_t lapic_addr;
+      uint16_t ext_length;
+      uint8_t ext_checksum;
+      uint8_t reserved;
+} __attribute__ ((packed)) mp_config_t;
+
+typedef struct mp_processor {
+      uint8_t type;
+      uint8_t apic_id;
+      uint8_t apic_version;
+      uint8_t flags;
+      uint32_t signature;
+      uint32_t features;
+      uint32_t reserved[2];
+} __attribute__ ((packed)) mp_processor_t;
+
+typedef struct mp_bus {
+      uint8_t type;
+      uint8_t bus_id;
+      uint8_t bus_type[6];          //"ISA   ", "PCI   ", ...
+} __attribute__ ((packed)) mp_bus_t;
+
+typedef struct mp_ioapic {
+      uint8_t type;
+      uint8_t apic_id;
+      uint8_t apic_version;
+      uint8_t flags;
+      uint32_t addr;
+} __attribute__ ((packed)) mp_ioapic_t;
+
+/*where one bus interrupt is wired*/
+typedef struct mp_intr {
+      uint8_t type;
+      uint8_t int_type;
+      uint16_t flags;               //polarity and trigger mode
+      uint8_t src_bus;
+      uint8_t src_irq;
+      uint8_t dst_ioapic;
+      uint8_t dst_pin;
+} __attribute__ ((packed)) mp_intr_t;
+
+cpu_t cpus[MAX_CPUS];
+int32_t num_cpus = 1;
+
+/*set if interrupts must be switched from the 8259s with the IMCR*/
+int32_t imcr_present = 0;
+
+/*read by ap_entry in ap_boot.S*/
+uint32_t ap_boot_stack;
+
+/*which CPU the one being started is*/
+static volatile int32_t ap_boot_cpu;
+
+/*set by smp_start: the started CPUs may go on from ap_main*/
+static volatile int32_t smp_started = 0;
+
+/*CPU index of every APIC ID*/
+static uint8_t apic_to_cpu[256];
+
+static tss_t cpu_tss[MAX_CPUS];
+static uint8_t cpu_stack[MAX_CPUS][CPU_STACK_SIZE] __attribute__((aligned (CPU_STACK_SIZE)));
+
+extern uint8_t ap_trampoline[];
+extern uint8_t ap_trampoline_end[];
+extern uint8_t ap_gdtr[];
+
+static int32_t has_apic(void);
+static uint8_t checksum(uint8_t * addr, uint32_t len);
+static mp_float_t * mp_search(uint32_t addr, uint32_t len);
+static mp_float_t * mp_find(void);
+static mp_config_t * mp_config(void);
+static void cpu_setup_tss(cpu_t * cpu);
+static void start_cpu(cpu_t * cpu);
+static void io_delay(uint32_t us);
+
+/* has_apic
+ * DESCRIPTION:   Asks CPUID whether the processor has a local APIC.
+ * INPUTS:        none
+ * OUTPUTS:       1 if it does, 0 otherwise
+ */
+static int32_t has_apic(void){
+      uint32_t edx;
+
+      asm volatile("                \n\
+            MOVL $1, %%EAX          \n\
+            CPUID                   \n\
+            "
+            : "=d"(edx)
+            :
+            : "eax", "ebx", "ecx"
+      );
+      return (edx & CPUID_APIC) != 0;
+}
+
+/* checksum
+ * DESCRIPTION:   MP structures are valid when their bytes add up to 0.
+ * INPUTS:        addr, len - the structure
+ * OUTPUTS:       the sum of its bytes
+ */
+static uint8_t checksum(uint8_t * addr, uint32_t len){
+      uint8_t sum = 0;
+      uint32_t i;
+
+      for(i = 0; i < len; i++){
+            sum += addr[i];
+      }
+      return sum;
+}
+
+/* mp_search
+ * DESCRIPTION:   Looks for the MP floating pointer, which sits on a 16-byte
+ *                boundary, in one range of physical memory.
+ * INPUTS:        addr, len - the range, below 1MB
+ * OUTPUTS:       the structure, or NULL
+ */
+static mp_float_t * mp_search(uint32_t addr, uint32_t len){
+      mp_float_t * mp;
+
+      low_mem_map(addr, len);
+      for(mp = (mp_float_t *)addr; (uint32_t)mp < addr + len; mp++){
+            if(strncmp((int8_t *)mp->signature, "_MP_", 4) == 0 &&
+               checksum((uint8_t *)mp, sizeof(mp_float_t)) == 0){
+                  return mp;
+            }
+      }
+      return NULL;
+}
+
+/* mp_find
+ * DESCRIPTION:   Looks for the MP floating pointer where the spec says it
+ *                may be: the first 1kB of the EBDA, the last 1kB of base
+ *                memory, or the BIOS ROM.
+ * INPUTS:        none
+ * OUTPUTS:       the structure, or NULL
+ */
+static mp_float_t * mp_find(void){
+      mp_float_t * mp;
+      uint32_t ebda;
+
+      low_mem_map(BDA_EBDA_SEG, sizeof(uint16_t));
+      ebda = (uint32_t)(*(uint16_t *)BDA_EBDA_SEG) << 4;
+
+      if(ebda != 0 && (mp = mp_search(ebda, KB)) != NULL){
+            return mp;
+      }
+      if((mp = mp_search(BASE_MEM_LAST_KB, KB)) != NULL){
+            return mp;
+      }
+      return mp_search(BIOS_ROM_BEGIN, BIOS_ROM_SIZE);
+}
+
+/* mp_config
+ * DESCRIPTION:   Finds and checks the MP configuration table. Tables above
+ *                1MB and the default configurations (no table at all) are
+ *                not supported.
+ * INPUTS:        none
+ * OUTPUTS:       the table, mapped, or NULL
+ */
+static mp_config_t * mp_config(void){
+      mp_float_t * mp;
+      mp_config_t * config;
+
+      mp = mp_find();
+      if(mp == NULL || mp->config == 0 || mp->feature[0] != 0){
+            return NULL;
+      }
+      if(mp->config + sizeof(mp_config_t) > LOW_MEM_END){
+            return NULL;
+      }
+
+      low_mem_map(mp->config, sizeof(mp_config_t));
+      config = (mp_config_t *)mp->config;
+      if(strncmp((int8_t *)config->signature, "PCMP", 4) != 0 ||
+         mp->config + config->length > LOW_MEM_END){
+            return NULL;
+      }
+
+      low_mem_map(mp->config, config->length);
+      if(checksum((uint8_t *)config, config->length) != 0){
+            return NULL;
+      }
+      imcr_present = (mp->feature[1] & MP_IMCRP) != 0;
+      return config;
+}
+
+/* smp_init
+ * DESCRIPTION:   Fills cpus[] from the MP table, enables the local APIC of
+ *                CPU 0, and starts every other enabled CPU. Must run after
+ *                paging is on and before interrupts are enabled.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ * SIDE EFFECTS:  sets num_cpus, lapic and ioapic_addr, and the ISA IRQ
+ *                wiring; uses the first 1MB
+ *                of physical memory until it returns
+ */
+void smp_init(void){
+      mp_config_t * config;
+      uint8_t * entry;
+      mp_processor_t * proc;
+      mp_ioapic_t * io;
+      mp_bus_t * bus;
+      mp_intr_t * intr;
+      int32_t isa_bus = -1;
+      int32_t ioapic_id = -1;
+      int32_t i;
+
+      cpus[0].id = 0;
+      cpus[0].apic_id = 0;
+      cpus[0].online = 1;
+      cpus[0].sched = 1;
+      cpus[0].tss_sel = KERNEL_TSS;
+      cpus[0].tss = &tss;
+      cpus[0].stack_top = _8MB;
+      cpus[0].current = -1;
+      cpus[0].display = -1;
+      num_cpus = 1;
+
+      if(!has_apic() || (config = mp_config()) == NULL){
+            low_mem_unmap();
+            return;
+      }
+      //only the 4MB mapped at APIC_MMIO_BASE can be reached
+      if((config->lapic_addr & ~(_4MB - 1)) != APIC_MMIO_BASE){
+            low_mem_unmap();
+            return;
+      }
+      lapic = (volatile uint32_t *)config->lapic_addr;
+
+      entry = (uint8_t *)(config + 1);
+      for(i = 0; i < config->entry_count; i++){
+            switch(*entry){
+            case MP_PROCESSOR:
+                  proc = (mp_processor_t *)entry;
+                  if((proc->flags & MP_CPU_ENABLED) && !(proc->flags & MP_CPU_BSP) &&
+                     num_cpus < MAX_CPUS){
+                        cpus[num_cpus].id = num_cpus;
+                        cpus[num_cpus].apic_id = proc->apic_id;
+                        num_cpus++;
+                  }
+                  entry += MP_PROCESSOR_LEN;
+                  break;
+            case MP_BUS:
+                  bus = (mp_bus_t *)entry;
+                  if(strncmp((int8_t *)bus->bus_type, "ISA", 3) == 0){
+                        isa_bus = bus->bus_id;
+                  }
+                  entry += MP_OTHER_LEN;
+                  break;
+            case MP_IOAPIC:
+                  //only the first IOAPIC is used: it has the ISA IRQs
+                  io = (mp_ioapic_t *)entry;
+                  if(ioapic_addr == 0 && (io->flags & MP_IOAPIC_ENABLED) &&
+                     (io->addr & ~(_4MB - 1)) == APIC_MMIO_BASE){
+                        ioapic_addr = io->addr;
+                        ioapic_id = io->apic_id;
+                  }
+                  entry += MP_OTHER_LEN;
+                  break;
+            case MP_IOINTR:
+                  //entries are sorted by type: buses and IOAPICs come first
+                  intr = (mp_intr_t *)entry;
+                  if(intr->int_type == MP_INT && intr->src_bus == isa_bus &&
+                     intr->dst_ioapic == ioapic_id){
+                        ioapic_set_isa_route(intr->src_irq, intr->dst_pin, intr->flags);
+                  }
+                  entry += MP_OTHER_LEN;
+                  break;
+            default:
+                  entry += MP_OTHER_LEN;
+                  break;
+            }
+      }
+
+      lapic_init(1);
+      cpus[0].apic_id = lapic_id();
+      apic_to_cpu[cpus[0].apic_id] = 0;
+
+      //the trampoline, with the GDT it has to load
+      low_mem_map(AP_TRAMPOLINE, ap_trampoline_end - ap_trampoline);
+      (void)memcpy((void *)AP_TRAMPOLINE, ap_trampoline, ap_trampoline_end - ap_trampoline);
+      (void)memcpy((void *)(AP_TRAMPOLINE + (ap_gdtr - ap_trampoline)), &gdt_desc.size, 6);
+
+      for(i = 1; i < num_cpus; i++){
+            apic_to_cpu[cpus[i].apic_id] = i;
+            start_cpu(&cpus[i]);
+      }
+
+      low_mem_unmap();
+      return;
+}
+
+/* cpu_setup_tss
+ * DESCRIPTION:   Gives a CPU other than CPU 0 its own TSS, described by
+ *                its own GDT entry, with ring 0 stack at its own kernel
+ *                stack. A TSS can only be loaded by one CPU at a time.
+ * INPUTS:        cpu - the CPU
+ * OUTPUTS:       none
+ */
+static void cpu_setup_tss(cpu_t * cpu){
+      seg_desc_t the_tss_desc;
+
+      cpu->tss = &cpu_tss[cpu->id];
+      cpu->tss_sel = CPU_TSS(cpu->id);
+      cpu->stack_top = (uint32_t)cpu_stack[cpu->id] + CPU_STACK_SIZE;
+      cpu->current = -1;
+      cpu->display = -1;
+
+      cpu->tss->ldt_segment_selector = KERNEL_LDT;
+      cpu->tss->ss0 = KERNEL_DS;
+      cpu->tss->esp0 = cpu->stack_top;
+
+      the_tss_desc.val[0] = 0;
+      the_tss_desc.val[1] = 0;
+      the_tss_desc.present = 0x1;
+      the_tss_desc.dpl = 0x0;
+      the_tss_desc.sys = 0x0;
+      the_tss_desc.type = 0x9;
+      SET_TSS_PARAMS(the_tss_desc, cpu->tss, tss_size);
+      cpu_tss_desc_ptr[cpu->id - 1] = the_tss_desc;
+      return;
+}
+
+/* start_cpu
+ * DESCRIPTION:   Starts one CPU with the INIT, STARTUP, STARTUP sequence of
+ *                the MP spec and waits for it to reach ap_main. A CPU that
+ *                doesn't answer stays offline.
+ * INPUTS:        cpu - the CPU
+ * OUTPUTS:       none
+ */
+static void start_cpu(cpu_t * cpu){
+      uint32_t i;
+
+      cpu_setup_tss(cpu);
+      ap_boot_stack = cpu->stack_top;
+      ap_boot_cpu = cpu->id;
+
+      lapic_send_init(cpu->apic_id);
+      io_delay(INIT_DELAY_US);
+
+      for(i = 0; i < 2 && !cpu->online; i++){
+            lapic_send_startup(cpu->apic_id, AP_TRAMPOLINE >> 12);
+            io_delay(STARTUP_DELAY_US);
+      }
+
+      for(i = 0; i < AP_START_TIMEOUT && !cpu->online; i++){
+            asm volatile("PAUSE");
+      }
+      return;
+}
+
+/* io_delay
+ * DESCRIPTION:   Waits about us microseconds, before the PIT is running.
+ * INPUTS:        us - how long
+ * OUTPUTS:       none
+ */
+static void io_delay(uint32_t us){
+      while(us--){
+            outb(0, DELAY_PORT);
+      }
+      return;
+}
+
+/* ap_main
+ * DESCRIPTION:   Where a started CPU enters C, on its own stack with
+ *                paging on. Loads the IDT and its TSS, enables its local
+ *                APIC and reports in. Once smp_start lets it, it starts
+ *                its own timer tick and enters the scheduler, which
+ *                halts it until a process is put on its run queue or it
+ *                can steal one (see next_task in term_sched.c).
+ * INPUTS:        none
+ * OUTPUTS:       none, never returns
+ */
+void ap_main(void){
+      cpu_t * cpu = &cpus[ap_boot_cpu];
+
+      lidt(idt_desc_ptr);
+      ltr(cpu->tss_sel);
+      lapic_init(0);
+      fpu_init();
+
+      cpu->online = 1;
+
+      //the timer rate is only known once CPU 0 has calibrated it
+      while(!smp_started){
+            asm volatile("PAUSE");
+      }
+
+      //no timer to preempt with: stay out of the scheduler
+      if(!cpu->sched){
+            while(1){
+                  asm volatile("HLT");
+            }
+      }
+
+      lapic_timer_periodic(TIMER_VECTOR, TICK_HZ);
+
+      //schedule only comes back here if it was called with nothing to
+      //switch to, and it halts until there is something
+      while(1){
+            schedule();
+      }
+}
+
+/* smp_start
+ * DESCRIPTION:   Lets the started CPUs go on from ap_main into the
+ *                scheduler. Called by CPU 0 once the shells exist and its
+ *                own timer runs; CPU 0 must have claimed the process it
+ *                starts with, or another CPU could steal it first. The
+ *                other CPUs only take processes if they have a timer to
+ *                preempt them with, i.e. with the IOAPIC and local APIC
+ *                timer in use.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ */
+void smp_start(void){
+      int32_t i;
+
+      if(irq_use_apic){
+            for(i = 1; i < num_cpus; i++){
+                  cpus[i].sched = cpus[i].online;
+            }
+      }
+      smp_started = 1;
+      return;
+}
+
+/* smp_kick
+ * DESCRIPTION:   Sends another CPU the RESCHED_VECTOR IPI, so it runs the
+ *                scheduler on the way out of it: a process was put on its
+ *                run queue (waking it from HLT if it is idle), or a
+ *                mapping its process uses changed and it must be flushed
+ *                (see task_switch).
+ * INPUTS:        cpu - the CPU; nothing is sent to this one, or to CPUs
+ *                that don't schedule
+ * OUTPUTS:       none
+ */
+void smp_kick(cpu_t * cpu){
+      if(cpu == this_cpu() || !cpu->sched){
+            return;
+      }
+      lapic_send_vector(cpu->apic_id, RESCHED_VECTOR);
+      return;
+}
+
+/* resched_interrupt_handler
+ * DESCRIPTION:   Handles smp_kick on the CPU it was sent to. The dispatcher
+ *                calls schedule on the way out (see sched_preempt).
+ * INPUTS:        none
+ * OUTPUTS:       none
+ */
+void resched_interrupt_handler(void){
+      lapic_eoi();
+      this_cpu()->need_resched = 1;
+      return;
+}
+
+/* this_cpu
+ * DESCRIPTION:   Finds the cpu_t of the processor running this code, from
+ *                its local APIC ID.
+ * INPUTS:        none
+ * OUTPUTS:       the CPU
+ */
+cpu_t * this_cpu(void){
+      if(lapic == NULL){
+            return &cpus[0];
+      }
+      return &cpus[apic_to_cpu[lapic_id()]];
+}
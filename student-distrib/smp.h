@@ -0,0 +1,58 @@
+/* smp.h: Header file for multiprocessor bring-up */
+#ifndef _SMP_H
+#define _SMP_H
+
+/* physical address the other CPUs start at, in real mode (page 7) */
+#define AP_TRAMPOLINE 0x7000
+
+/* vector of the IPI that makes another CPU look at its run queue */
+#define RESCHED_VECTOR 0xFD
+
+#ifndef ASM
+
+#include "types.h"
+#include "x86_desc.h"
+
+/* Everything the kernel keeps for one processor */
+typedef struct cpu {
+      int32_t id;                   //index into cpus[]
+      uint32_t apic_id;             //local APIC ID, for IPIs
+      volatile uint8_t online;      //set by the CPU once it runs kernel code
+      volatile uint8_t sched;       //takes processes: CPU 0, the others after smp_start
+      uint16_t tss_sel;             //GDT selector of its TSS
+      tss_t * tss;                  //its TSS: ring 0 stack for interrupts
+      uint32_t stack_top;           //its own kernel stack, when idle
+      volatile int32_t current;     //PID it runs, -1 before the first switch
+      volatile int32_t display;     //terminal of that process, see running_display
+      volatile uint8_t idle;        //halted in schedule with nothing to run
+      volatile uint8_t need_resched;//a process better than current woke up
+      volatile uint8_t irq_from_user;//the interrupt being handled came from user mode
+      volatile uint32_t preempt_count;//spinlocks held etc.: no switching away while non-zero
+      int32_t fpu_owner;            //PID whose FPU state is in the registers, -1 for none
+} cpu_t;
+
+extern cpu_t cpus[MAX_CPUS];
+extern int32_t num_cpus;
+extern int32_t imcr_present;
+
+/* Finds the other processors and starts them */
+void smp_init(void);
+
+/* Returns the CPU this code is running on */
+cpu_t * this_cpu(void);
+
+/* Where the trampoline leaves the other CPUs (see ap_boot.S) */
+void ap_main(void);
+
+/* Lets the other CPUs into the scheduler, once there are processes */
+void smp_start(void);
+
+/* Makes another CPU schedule: it has a process to run, or a stale mapping */
+void smp_kick(cpu_t * cpu);
+
+/* The RESCHED_VECTOR handler */
+void resched_interrupt_handler(void);
+
+#endif /* ASM */
+
+#endif  /* _SMP_H */
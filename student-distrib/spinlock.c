@@ -0,0 +1,91 @@
+/*spinlock.c
+ *Test-and-test-and-set locks for state that more than one CPU touches.
+ *On a single CPU cli is enough, but it does nothing to stop the others.
+ *Holding one also keeps the holder from being switched away from: a
+ *process that spun on a lock held by a process it preempted would wait
+ *for a whole time slice.
+ */
+
+#include "spinlock.h"
+#include "smp.h"
+#include "term_sched.h"
+
+/* preempt_disable
+ * DESCRIPTION:   Keeps this CPU on the current process until the matching
+ *                preempt_enable. Interrupts still come in.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ */
+void preempt_disable(void){
+      this_cpu()->preempt_count++;
+      asm volatile("" : : : "memory");
+      return;
+}
+
+/* preempt_enable
+ * DESCRIPTION:   Undoes a preempt_disable. If that was the last one and a
+ *                switch was put off meanwhile, it happens now - unless
+ *                interrupts are off, in which case the next interrupt
+ *                (or schedule call) picks it up.
+ * INPUTS:        none
+ * OUTPUTS:       none
+ * SIDE EFFECTS:  may switch to another process
+ */
+void preempt_enable(void){
+      cpu_t * cpu;
+      unsigned long flags;
+
+      asm volatile("" : : : "memory");
+      cli_and_save(flags);
+      cpu = this_cpu();
+      cpu->preempt_count--;
+      if(cpu->preempt_count == 0 && cpu->need_resched && (flags & EFLAGS_IF_BIT)){
+            schedule();
+      }
+      restore_flags(flags);
+      return;
+}
+
+/* spin_lock
+ * DESCRIPTION:   Takes a lock with an atomic exchange, waiting with plain
+ *                reads while it is held so the waiting CPUs don't keep
+ *                pulling the cache line away from the owner.
+ * INPUTS:        lock - the lock
+ * OUTPUTS:       none
+ * SIDE EFFECTS:  may spin until another CPU releases the lock
+ */
+void spin_lock(spinlock_t * lock){
+      uint32_t old;
+
+      preempt_disable();
+      while(1){
+            old = 1;
+            asm volatile("                \n\
+                  XCHGL %0, %1            \n\
+                  "
+                  : "+r"(old), "+m"(lock->locked)
+                  :
+                  : "memory"
+            );
+            if(old == 0){
+                  return;
+            }
+            while(lock->locked){
+                  asm volatile("PAUSE");
+            }
+      }
+}
+
+/* spin_unlock
+ * DESCRIPTION:   Releases a lock. A plain store is enough on x86: it can't
+ *                be reordered with the earlier loads and stores of the
+ *                critical section.
+ * INPUTS:        lock - the lock, held by this CPU
+ * OUTPUTS:       none
+ */
+void spin_unlock(spinlock_t * lock){
+      asm volatile("" : : : "memory");
+      lock->locked = 0;
+      preempt_enable();
+      return;
+}
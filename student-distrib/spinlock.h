@@ -0,0 +1,45 @@
+/* spinlock.h: Header file for locks shared between CPUs, and preemption */
+#ifndef _SPINLOCK_H
+#define _SPINLOCK_H
+
+#include "types.h"
+#include "lib.h"
+
+/* A lock word: 0 when free, 1 when held */
+typedef struct spinlock {
+      volatile uint32_t locked;
+} spinlock_t;
+
+#define SPINLOCK_INIT {0}
+
+/* Kernel code is preempted (see schedule in term_sched.c) whenever
+ * interrupts are on, unless preemption is disabled: then a switch only
+ * sets need_resched, and it happens when the last preempt_enable runs with
+ * interrupts on. The calls nest. Holding a spinlock disables preemption. */
+void preempt_disable(void);
+void preempt_enable(void);
+
+/* Spins until the lock is ours; preemption stays off until spin_unlock */
+void spin_lock(spinlock_t * lock);
+
+/* Releases a lock taken with spin_lock, and may switch if something better
+ * woke up meanwhile */
+void spin_unlock(spinlock_t * lock);
+
+/* Takes a lock that an interrupt handler on this CPU may also take: the
+ * interrupt flag is saved in flags and cleared first, so the handler can't
+ * spin on a lock its own CPU holds */
+#define spin_lock_irqsave(lock, flags)  \
+do {                                    \
+      cli_and_save(flags);              \
+      spin_lock(lock);                  \
+} while (0)
+
+/* Releases a lock taken with spin_lock_irqsave */
+#define spin_unlock_irqrestore(lock, flags) \
+do {                                        \
+      spin_unlock(lock);                    \
+      restore_flags(flags);                 \
+} while (0)
+
+#endif  /* _SPINLOCK_H */
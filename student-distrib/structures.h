@@ -2,6 +2,7 @@
 #define _STRUCTURES_H
 
 #include "types.h"
+#include "mutex.h"
 
 /*Directory entry structure*/
 typedef struct dentry {
@@ -32,7 +33,7 @@ typedef struct inode {
 
 typedef struct flags{
       uint8_t in_use;
-      uint8_t reserved1;
+      uint8_t status;         //status flags set through fcntl (O_NONBLOCK)
       uint8_t reserved2;
       uint8_t reserved3;
 } flags_t;
@@ -43,6 +44,7 @@ typedef struct op_jmp_table {
       int32_t (*dev_read)(uint32_t inode_index, uint32_t offset, uint8_t * buf, uint32_t nbytes);
       int32_t (*dev_write)(int32_t fd, const void * buf, int32_t n_bytes);
       int32_t (*dev_close)(int32_t fd);
+      int32_t (*dev_poll)(uint32_t inode_index);   //NULL if reads never block
 } op_jmp_table_t;
 
 /*file descriptor pointer*/
@@ -58,11 +60,80 @@ typedef struct file_descriptor {
       } __attribute__ ((packed));
 } file_descriptor_t;
 
+/*File metadata returned by stat and fstat*/
+typedef struct file_stat {
+      uint32_t file_type;
+      uint32_t inode_num;
+      uint32_t length;
+      uint32_t num_blocks;
+} file_stat_t;
+
+/*One record of a batched directory read: a name with its metadata*/
+typedef struct dirent_stat {
+      uint8_t file_name[32];
+      file_stat_t stat;
+} dirent_stat_t;
+
+/*One record of getdents. The first 40 bytes share the dentry layout so
+ *each record is filled with a single block copy of the dentry*/
+typedef struct dirent {
+      uint8_t file_name[32];
+      uint32_t file_type;
+      uint32_t inode_num;
+      uint32_t name_len;
+} dirent_t;
+
+/*One buffer of a readv/writev call*/
+typedef struct iovec {
+      void * iov_base;
+      int32_t iov_len;
+} iovec_t;
+
 /*Data block (found in the filesystem)*/
 typedef struct data_block {
       uint8_t data[4096];
 } data_block_t;
 
+/*Number of signals a process can receive (see signal.h)*/
+#define NUM_SIGNALS 5
+
+/*System-wide counters returned by the sysstat syscall*/
+typedef struct sysstat {
+      uint32_t jiffies;                   //timer ticks since boot
+      uint32_t tick_hz;                   //timer ticks per second
+      uint32_t idle_jiffies;              //ticks with nothing to run
+      uint32_t interrupts;                //hardware interrupts since boot
+      uint32_t switches;                  //context switches since boot
+} sysstat_t;
+
+/*Scheduling states of a process*/
+#define TASK_RUNNING 0        //can be picked by the scheduler
+#define TASK_WAITING 1        //blocked in execute until its child halts
+#define TASK_ZOMBIE  2        //halted, exit status not yet collected by wait
+#define TASK_FUTEX   3        //sleeping in futex until woken or signalled
+#define TASK_SLEEPING 4       //blocked in the kernel until wake_up(wait_chan)
+
+/*Length of the program name kept in the PCB, NUL included*/
+#define PROC_NAME_LEN 32
+
+/*Resources a process has used since it started, see acct.c*/
+typedef struct acct {
+      uint32_t utime;                     //ticks charged in user mode
+      uint32_t stime;                     //ticks charged in the kernel
+      uint32_t switches;                  //times the CPU switched to it
+      uint32_t syscalls;                  //system calls made
+      uint32_t bytes_read;                //returned by read, pread, readv
+      uint32_t bytes_written;             //accepted by write, pwrite, writev
+      uint32_t faults;                    //page faults, copy-on-write included
+} acct_t;
+
+/*MLFQ scheduler levels; nice ranges over them*/
+#define MLFQ_LEVELS  4
+#define NICE_MAX     (MLFQ_LEVELS - 1)
+
+/*Size of an FXSAVE image: x87, MMX and XMM registers, MXCSR*/
+#define FPU_STATE_SIZE  512
+
 /*Structure containing all PCB information*/
 typedef struct PCB {
       file_descriptor_t fd[8];
@@ -74,6 +145,41 @@ typedef struct PCB {
       uint32_t stack_pointer;
       uint32_t EBP;
       struct PCB * parent_pcb;
+      void * sig_handlers[NUM_SIGNALS];   //NULL means the default action
+      uint32_t sig_pending;               //bit n set: signal n is waiting
+      uint32_t sig_mask;                  //bit n set: signal n is blocked
+      uint8_t state;                      //TASK_RUNNING, _WAITING or _ZOMBIE
+      uint8_t background;                 //started by spawn, not execute
+      uint8_t exiting;                    //its program ended, see end_threads
+      int32_t terminal;                   //display the process reads and writes
+      int32_t exit_status;                //status passed to halt, for wait
+      int32_t mm_pid;                     //PID whose page directory this uses
+      uint32_t futex_addr;                //user address slept on in futex
+      int32_t cpu;                        //CPU whose run queue it is on
+      volatile uint8_t on_cpu;            //a CPU runs it or is still on its kernel stack
+      void * wait_chan;                   //what a TASK_SLEEPING process waits for
+      uint8_t prio;                       //MLFQ level, 0 runs first
+      uint8_t nice;                       //highest level it may be boosted to
+      uint8_t slice;                      //ticks left at its level
+      uint32_t wake_tsc;                  //TSC when woken for input, 0 once run
+      uint8_t name[PROC_NAME_LEN];        //program it runs
+      mutex_t * held_mutexes[MUTEX_HELD_MAX];//mutexes it holds, see mutex.c
+      uint8_t num_held_mutexes;
+      acct_t acct;                        //resource use, see acct.c
+      uint8_t fpu_used;                   //has FPU state, see fpu.c
+      uint8_t fpu_state[FPU_STATE_SIZE] __attribute__((aligned(16)));
 } PCB_t;
 
+/*One process as seen by the procstat syscall*/
+typedef struct procstat {
+      int32_t pid;
+      int32_t parent;                     //-1 for the base shells
+      uint8_t state;                      //TASK_RUNNING etc.
+      uint8_t terminal;
+      uint8_t prio;
+      uint8_t nice;
+      uint8_t name[PROC_NAME_LEN];
+      acct_t acct;
+} procstat_t;
+
 #endif
@@ -9,6 +9,15 @@
 #include "syscall.h"
 #include "video.h"
 #include "term_sched.h"
+#include "signal.h"
+#include "smp.h"
+#include "thread.h"
+#include "tick.h"
+#include "acct.h"
+#include "fpu.h"
+#include "procfs.h"
+#include "spinlock.h"
+#include "debug.h"
 
 
 #define CMD_MAX_LEN 32
@@ -22,6 +31,9 @@
 #define USER_STACK_BEGIN 0x8400000 - 4
 #define VID_MEM_PD 33 // (132 MB / 4MB)
 
+//where a forked child starts running (see int_setup.S)
+extern void fork_return();
+
 
 page_directory_t task_pd[MAX_CONCURRENT_TASKS] __attribute__((aligned (_4KB)));
 PCB_t * task_pcb[MAX_CONCURRENT_TASKS] = {(PCB_t *)(_8MB - 2 * _8KB),
@@ -31,7 +43,12 @@ PCB_t * task_pcb[MAX_CONCURRENT_TASKS] = {(PCB_t *)(_8MB - 2 * _8KB),
                                           (PCB_t *)(_8MB - 6 * _8KB),
                                           (PCB_t *)(_8MB - 7 * _8KB)};
 
-uint32_t vidmap_pt[1024] __attribute__((aligned (_4KB)));
+uint32_t vidmap_pt[MAX_CONCURRENT_TASKS][1024] __attribute__((aligned (_4KB)));
+
+mutex_t task_lock = MUTEX_INIT;
+
+//bytes of a program load_program copies in between chances to be preempted
+#define LOAD_CHUNK _4KB
 
 //general format for device-specific io:
 //open(const uint8_t * filename)
@@ -50,15 +67,42 @@ uint32_t vidmap_pt[1024] __attribute__((aligned (_4KB)));
 // 8. vidmap
 // 9. set_handler
 // 10. sigreturn
+// 11. fcntl
+// 12. lseek
+// 13. pread
+// 14. pwrite
+// 15. readv
+// 16. writev
+// 17. stat
+// 18. fstat
+// 19. dirstat
+// 20. getdents
+// 21. kill
+// 22. spawn
+// 23. wait
+// 24. waitpid
+// 25. fork
+// 26. thread_create
+// 27. futex
+// 28. sysstat
+// 29. nice
+// 30. procstat
+//
+//files named proc/... are generated by procfs.c from kernel state
 
 //file operations jump table
 op_jmp_table_t file_op_table = { &file_open, &file_read, &file_write, &file_close };
 //directory operations jump table
 op_jmp_table_t dir_op_table = { &dir_open, &dir_read, &dir_write, &dir_close };
 //rtc operations jump table
-op_jmp_table_t rtc_op_table = { &rtc_open, &rtc_read, &rtc_write, &rtc_close };
+op_jmp_table_t rtc_op_table = { &rtc_open, &rtc_read, &rtc_write, &rtc_close, &rtc_poll };
 //virtual console jump table
-op_jmp_table_t vc_op_table = { &vc_open, &vc_read, &vc_write, &vc_close};
+op_jmp_table_t vc_op_table = { &vc_open, &vc_read, &vc_write, &vc_close, &vc_poll };
+//kernel statistics (proc/...) jump table
+op_jmp_table_t procfs_op_table = { &procfs_open, &procfs_read, &procfs_write, &procfs_close };
+
+//how many times each syscall was made, see proc/syscalls
+uint32_t syscall_count[NUM_SYSCALLS + 1];
 
 PCB_t * get_pcb_ptr(){
       PCB_t * pcb;
@@ -75,8 +119,85 @@ PCB_t * get_pcb_ptr(){
 }
 
 int32_t halt_handler(uint8_t status){
+      return halt_process(status);
+}
+
+/*reparent_children
+ * Hands the children of a halting process to its parent, so background
+ * jobs it spawned can still be waited for. The parent may already be
+ * waiting, so it is woken to look at them.
+ */
+static void reparent_children(PCB_t * pcb){
+      int i;
+      for(i = 0; i < MAX_CONCURRENT_TASKS; i++){
+            if(i != pcb->PID && task_pcb[i]->is_active && task_pcb[i]->parent_pcb == pcb){
+                  task_pcb[i]->parent_pcb = pcb->parent_pcb;
+            }
+      }
+      wake_up(pcb->parent_pcb);
+      return;
+}
+
+/*end_threads
+ * Ends the other threads of a program whose first thread is halting, and
+ * returns once none of them can touch its pages again. A thread stopped in
+ * the kernel may hold a lock or be halfway through creating a process, so
+ * it isn't freed where it stands: it is marked exiting and woken, and halts
+ * on its next return to user mode (see do_signal). Threads that are
+ * zombies, or waiting in execute for a program of their own, have nothing
+ * left to do and are freed right away; the background children of those
+ * go to the first thread.
+ */
+static void end_threads(PCB_t * pcb){
+      PCB_t * thread;
+      unsigned long flags;
+      int live;
+      int i, j;
+
+      spin_lock_irqsave(&wait_lock, flags);
+      while(1){
+            live = 0;
+            for(i = 0; i < MAX_CONCURRENT_TASKS; i++){
+                  thread = task_pcb[i];
+                  if(i == pcb->PID || !thread->is_active || thread->mm_pid != pcb->PID){
+                        continue;
+                  }
+                  if(thread->state == TASK_ZOMBIE || thread->state == TASK_WAITING){
+                        for(j = 0; j < MAX_CONCURRENT_TASKS; j++){
+                              if(task_pcb[j]->is_active && task_pcb[j]->parent_pcb == thread &&
+                                 task_pcb[j]->background){
+                                    task_pcb[j]->parent_pcb = pcb;
+                              }
+                        }
+                        thread->is_active = 0;
+                        continue;
+                  }
+                  live = 1;
+                  if(!thread->exiting){
+                        thread->exiting = 1;
+                        if(thread->state == TASK_FUTEX || thread->state == TASK_SLEEPING){
+                              wake_task(thread);
+                        }
+                  }
+            }
+            if(!live){
+                  spin_unlock_irqrestore(&wait_lock, flags);
+                  return;
+            }
+            //a thread halting or starting a program wakes us to look again
+            sleep_on(pcb);
+      }
+}
+
+/*halt_process
+ * Ends the current program and returns status from its parent's execute.
+ * Unlike halt, status is not limited to a byte, so a program killed by a
+ * signal can report SIGNAL_KILL_STATUS (256). A program started by spawn
+ * becomes a zombie holding status until its parent waits for it.
+ * Returns 0 without doing anything for the base shells.
+ */
+int32_t halt_process(uint32_t status){
       PCB_t * current_pcb;
-      cli();
       current_pcb = get_pcb_ptr();
 
       //ensure we don't close the base shells
@@ -84,7 +205,7 @@ int32_t halt_handler(uint8_t status){
             return 0;
       }
 
-      current_pid[running_display] = current_pcb->parent_pcb->PID;
+      cli();
 
       //Set all the file descriptors to open
       task_pcb[current_pcb->PID]->fd[0].flags.in_use = 0;
@@ -96,28 +217,75 @@ int32_t halt_handler(uint8_t status){
       task_pcb[current_pcb->PID]->fd[6].flags.in_use = 0;
       task_pcb[current_pcb->PID]->fd[7].flags.in_use = 0;
 
+      //whatever it was doing under a lock stays half done, but the lock
+      //is free for the next process
+      if(mutex_release_all(current_pcb) != 0){
+            debugf("pid %d halted holding a mutex\n", current_pcb->PID);
+      }
+
+      //the program is over when its first thread halts: end the other
+      //threads and drop its pages; the kernel doesn't touch them again
+      if(current_pcb->mm_pid == current_pcb->PID){
+            end_threads(current_pcb);
+            user_space_free(current_pcb->PID);
+      }
+
+      //after end_threads, which can hand it more children
+      reparent_children(current_pcb);
+
+      //nobody is waiting in execute for a background job: keep the PCB
+      //around for wait and run something else. Zombies are never
+      //scheduled, so schedule doesn't return.
+      if(current_pcb->background){
+            current_pcb->exit_status = status;
+            current_pcb->state = TASK_ZOMBIE;
+            wake_up(current_pcb->parent_pcb);
+            if(current_pcb->exiting){
+                  wake_up(task_pcb[current_pcb->mm_pid]);
+            }
+            schedule();
+            return -1;
+      }
+
+      //a thread that was waiting in execute for us was ended by its
+      //program halting: there is nobody to return to
+      if(!current_pcb->parent_pcb->is_active){
+            current_pcb->is_active = 0;
+            schedule();
+            return -1;
+      }
+
+      //give the terminal back to the parent
+      if(current_pid[current_pcb->terminal] == current_pcb->PID){
+            current_pid[current_pcb->terminal] = current_pcb->parent_pcb->PID;
+      }
+      sched_hand_over(current_pcb->parent_pcb);
+
       //restore the TSS
-      tss.ss0 = current_pcb->parent_pcb->ss0;
-      tss.esp0 = current_pcb->parent_pcb->esp0;
+      this_cpu()->tss->ss0 = current_pcb->parent_pcb->ss0;
+      this_cpu()->tss->esp0 = current_pcb->parent_pcb->esp0;
 
-      //set the process as inactive
+      //set the process as inactive. Its PID stays taken until this CPU
+      //is off its stack (see sched_hand_over)
       current_pcb->is_active = 0;
 
       //Reset the paging to the parent's page
-      init_control_reg(&(task_pd[current_pcb->parent_pcb->PID].PDE[0]));
+      init_control_reg(&(task_pd[current_pcb->parent_pcb->mm_pid].PDE[0]));
 
-      sti();
+      irqoff_end();
 
       //jump to the end of the execute function and return our value
       asm volatile("                \n\
             MOVL %1, %%EBP          \n\
-            XORL %%EAX, %%EAX       \n\
-            MOVB %0, %%AL          \n\
+            MOVL %0, %%EAX          \n\
+            MOVL %%EBP, %%ESP       \n\
+            MOVB $0, (%2)           \n\
+            STI                     \n\
             JMP execute_return      \n\
             "
             :
-            :"r"(status), "g"(current_pcb->parent_pcb->EBP)
-            :"%eax"
+            :"r"(status), "r"(current_pcb->parent_pcb->EBP), "r"(&current_pcb->on_cpu)
+            :"%eax", "memory"
       );
 
       //we shouldn't get here because of the JMP instruction
@@ -125,17 +293,23 @@ int32_t halt_handler(uint8_t status){
 
 }
 
-int32_t execute_handler(const uint8_t * command){
-
-      cli();
+/*load_program
+ * Does everything execute and spawn have in common: parses the command,
+ * checks the executable, picks a free PID, sets up its paging, copies the
+ * program in and fills in its PCB. Called with interrupts on: the copy
+ * can be preempted between chunks. On success returns with interrupts off
+ * and CR3 pointing at the new process' page directory, so the caller can
+ * start it before the scheduler sees it.
+ * Returns the new PID, or -1 if the program can't be started.
+ */
+static int32_t load_program(const uint8_t * command, void ** entry_address){
 
-      //Seven Steps:
+      //Five Steps:
       // 1. Parse
       // 2. Executable check
       // 3. Paging
       // 4. User - level program loader
       // 5. Create PCB
-      // 6. Context Switch
 
       //Vars for Parsing
       uint8_t cmd_name[CMD_MAX_LEN];     //Name of the command
@@ -148,58 +322,40 @@ int32_t execute_handler(const uint8_t * command){
       uint8_t exe_dat[40];
       uint8_t arg_dat[128];
       uint8_t x_magic[4] = {X_MAGIC_1, X_MAGIC_2, X_MAGIC_3, X_MAGIC_4};
-      void * entry_address;
 
       //vars for paging setup
       int PID = -1;
-      int PDE_index;
-
-      //vars for context switch
-      void * user_sp;
+      PCB_t * parent_pcb = get_pcb_ptr();
+      uint32_t offset;
+      int32_t copied;
 
       //
       //Step One : Parse
       //
 
       //clear the cmd_len array
-      for(i = 0; i < CMD_MAX_LEN; i++){
-            cmd_name[i] = 0;
-      }
+      (void)memset(cmd_name, 0, CMD_MAX_LEN);
 
-      //grab the command
-      for(i = 0; (i < CMD_MAX_LEN) && (command[i] != ' ') && (command[i] != '\n'); i++){
-            cmd_name[i] = command[i];
-            cmd_len++;
-      }
+      //grab the command: up to a space, newline or the end, found a word
+      //at a time
+      cmd_len = strndelim((const int8_t *)command, CMD_MAX_LEN, ' ', '\n');
+      (void)memcpy(cmd_name, command, cmd_len);
 
       //clear the argument string
-      for(i = 0; i < 128; i++){
-            arg_dat[i] = 0;
-      }
+      (void)memset(arg_dat, 0, 128);
       //check if arguments are present
       //if arguments are present, grab them
       if(command[cmd_len] == ' '){
             //increment cmd_len so we don't grab the space
             cmd_len++;
             //grab the arguments
-            for(i = 0; command[i + cmd_len] != '\n' && command[i + cmd_len] != '\0'; i++){
-                  arg_dat[i] = command[i + cmd_len];
-            }
-      }
-
-      //check if the command was simply an enter press
-      if(cmd_name[0] == 0){
-            return 0;
-      }
-
-      //Check to see if we need to kill the terminal (quit command = kill term)
-      if(!stringcompare((uint8_t *)cmd_name, (uint8_t *)"quit", 4)){
-            (void)halt(0);
+            i = strndelim((const int8_t *)&command[cmd_len], 127, '\n', '\n');
+            (void)memcpy(arg_dat, &command[cmd_len], i);
       }
 
       //Begin searching for the file
       //First get the dentry
-      if(read_dentry_by_name(cmd_name, &cmd_dentry)){
+      if(cmd_name[0] == 0 || read_dentry_by_name(cmd_name, &cmd_dentry)){
             return -1;
       }
 
@@ -226,15 +382,17 @@ int32_t execute_handler(const uint8_t * command){
       }
 
       //grab the entry address of the program
-      entry_address = (void *)((exe_dat[27] << 24)|(exe_dat[26] << 16)|(exe_dat[25] << 8)|(exe_dat[24]));
+      *entry_address = (void *)((exe_dat[27] << 24)|(exe_dat[26] << 16)|(exe_dat[25] << 8)|(exe_dat[24]));
 
       //
       //Step Three : Paging
       //
 
-      //find the first available PCB
-      for(i = 0; i < MAX_CONCURRENT_TASKS+1; i++){
-            if(!task_pcb[i]->is_active){
+      //find the first available PCB. Nobody else can take it until it is
+      //marked active below
+      mutex_lock(&task_lock);
+      for(i = 0; i < MAX_CONCURRENT_TASKS; i++){
+            if(!task_pcb[i]->is_active && !task_pcb[i]->on_cpu){
                   PID = i;
                   break;
             }
@@ -242,59 +400,61 @@ int32_t execute_handler(const uint8_t * command){
 
       //Check that there was room for that program
       if(PID == -1){
+            mutex_unlock(&task_lock);
             return -1;
       }
 
-      //load that PID into the current_PID
-      current_pid[current_display] = PID;
-
       // Store arg_data into pcb argbuf variable
       strcpy((int8_t*)task_pcb[PID]->argbuf, (const int8_t*)arg_dat);
 
-      //set up the paging
-      //set up the vid mem
-      task_pd[PID].PDE[0] = directory_paging[0];
-      //set up the kernel mem
-      task_pd[PID].PDE[1] = directory_paging[1];
-      //set up the program's 4mb page
-      PDE_index = (int)(_128MB >> 22);
-      page_directory_entry_4mb_t temp_pde;
-      temp_pde.page_base_addr = (uint32_t)((_8MB + PID * _4MB) >> 22);
-      temp_pde.present = 1;
-      temp_pde.wr = 1;
-      temp_pde.us = 1;
-      temp_pde.write_through = 1;
-      temp_pde.cached = 1;
-      temp_pde.accessed = 0;
-      temp_pde.paddling = 0;
-      temp_pde.page_size = 1;
-      temp_pde.g = 0;
-      temp_pde.available = 0;
-      temp_pde.pat = 0;
-      temp_pde.reserved = 0;
-
-      task_pd[PID].PDE[PDE_index] = (uint32_t)temp_pde.val;
-      //set the CR3 register to match the new setup
-      init_control_reg(&(task_pd[PID].PDE[0]));
+      //set up the paging: kernel, video memory and the program's 4MB
+      //at 128MB, in 4kB pages
+      user_space_create(PID);
 
       //
       //Step Four : User level program loader
       //
 
-      read_data(cmd_inode, 0, (uint8_t *)(_128MB + PROG_OFFSET), MAX_FS);
+      //a chunk at a time with the new page directory loaded. Switching
+      //away would bring back the parent's, so preemption waits for the end
+      //of each chunk
+      for(offset = 0; offset < MAX_FS; offset += LOAD_CHUNK){
+            preempt_disable();
+            init_control_reg(&(task_pd[PID].PDE[0]));
+            copied = read_data(cmd_inode, offset, (uint8_t *)(_128MB + PROG_OFFSET + offset), LOAD_CHUNK);
+            init_control_reg(&(task_pd[parent_pcb->mm_pid].PDE[0]));
+            preempt_enable();
+            if(copied < LOAD_CHUNK){
+                  break;
+            }
+      }
 
       //
       //Step Five : Create PCB
       //
 
+      cli();
+
       task_pcb[PID]->PID = PID;
       task_pcb[PID]->is_active = 1;
-      task_pcb[PID]->parent_pcb = get_pcb_ptr();
+      task_pcb[PID]->parent_pcb = parent_pcb;
+      task_pcb[PID]->state = TASK_WAITING;
+      task_pcb[PID]->background = 0;
+      task_pcb[PID]->terminal = parent_pcb->terminal;
+      task_pcb[PID]->exit_status = 0;
+      task_pcb[PID]->mm_pid = PID;
+      sched_init_task(task_pcb[PID], parent_pcb);
+      acct_init(task_pcb[PID], cmd_name);
+      fpu_init_task(task_pcb[PID], NULL);
+      signal_init(task_pcb[PID]);
+      mutex_init_task(task_pcb[PID]);
 
       //set the fd's as empty
       task_pcb[PID]->fd[0].flags.in_use = 1;
+      task_pcb[PID]->fd[0].flags.status = 0;
       task_pcb[PID]->fd[0].actions = &vc_op_table;
       task_pcb[PID]->fd[1].flags.in_use = 1;
+      task_pcb[PID]->fd[1].flags.status = 0;
       task_pcb[PID]->fd[1].actions = &vc_op_table;
       task_pcb[PID]->fd[2].flags.in_use = 0;
       task_pcb[PID]->fd[3].flags.in_use = 0;
@@ -303,15 +463,63 @@ int32_t execute_handler(const uint8_t * command){
       task_pcb[PID]->fd[6].flags.in_use = 0;
       task_pcb[PID]->fd[7].flags.in_use = 0;
 
+      task_pcb[PID]->ss0 = KERNEL_DS;
+      task_pcb[PID]->esp0 = _8MB - ((PID+1) * _8KB) - 4;
+
+      mutex_unlock(&task_lock);
+
+      //set the CR3 register to match the new setup
+      init_control_reg(&(task_pd[PID].PDE[0]));
+
+      return PID;
+}
+
+int32_t execute_handler(const uint8_t * command){
+
+      //Load the program (see load_program), then switch to it
+
+      void * entry_address;
+      int PID;
+      PCB_t * parent_pcb = get_pcb_ptr();
+
+      //vars for context switch
+      void * user_sp;
+
+      //check if the command was simply an enter press
+      if(command[0] == ' ' || command[0] == '\n' || command[0] == '\0'){
+            return 0;
+      }
+
+      //Check to see if we need to kill the terminal (quit command = kill term)
+      if(!stringcompare((uint8_t *)command, (uint8_t *)"quit", 4)){
+            (void)halt(0);
+      }
+
+      PID = load_program(command, &entry_address);
+      if(PID == -1){
+            return -1;
+      }
+
+      //the child takes over the terminal until it halts
+      if(current_pid[parent_pcb->terminal] == parent_pcb->PID){
+            current_pid[parent_pcb->terminal] = PID;
+      }
+      parent_pcb->state = TASK_WAITING;
+
+      //a thread whose program is ending is done with it now
+      if(parent_pcb->exiting){
+            wake_up(task_pcb[parent_pcb->mm_pid]);
+      }
+
       //set the parent EBP
       asm volatile("                \n\
             MOVL %%EBP, %0          \n\
             "
-            : "=r"(task_pcb[PID]->parent_pcb->EBP)
+            : "=r"(parent_pcb->EBP)
       );
 
-      task_pcb[PID]->parent_pcb->ss0 = tss.ss0;
-      task_pcb[PID]->parent_pcb->esp0 = tss.esp0;
+      parent_pcb->ss0 = this_cpu()->tss->ss0;
+      parent_pcb->esp0 = this_cpu()->tss->esp0;
 
       //
       //Step Six : Context Switch
@@ -321,34 +529,243 @@ int32_t execute_handler(const uint8_t * command){
 
       //set up the TSS
 
-      tss.ss0 =  KERNEL_DS;
-      tss.esp0 = _8MB - ((PID+1) * _8KB) - 4;
+      this_cpu()->tss->ss0 = task_pcb[PID]->ss0;
+      this_cpu()->tss->esp0 = task_pcb[PID]->esp0;
 
-            sti();
+      //this CPU runs the child from here on
+      sched_hand_over(task_pcb[PID]);
 
-                  //lower the privilege level using IRET
-                  asm volatile("                \n\
-                        MOVW %2, %%AX           \n\
-                        MOVW %%AX, %%DS         \n\
-                        PUSHL %0                \n\
-                        PUSHL %1                \n\
-                        PUSHFL                  \n\
-                        PUSHL %2                \n\
-                        PUSHL %3                \n\
-                        IRET                    \n\
-                        execute_return:         \n\
-                        LEAVE                   \n\
-                        RET                     \n\
-                        "
-                        :
-                        :"g"(USER_DS), "g"(user_sp), "g"(USER_CS), "g"(entry_address)
-                        :"%eax"
-                  );
+      //lower the privilege level using IRET, from the child's kernel
+      //stack. Interrupts stay off until the IRET (the pushed EFLAGS has IF
+      //set): the parent is no longer runnable, so the PIT must not switch
+      //away from it here. Once off the parent's stack, it is no longer
+      //on_cpu.
+      asm volatile("                \n\
+            MOVL %4, %%ESP          \n\
+            MOVB $0, (%5)           \n\
+            MOVW %0, %%AX           \n\
+            MOVW %%AX, %%DS         \n\
+            PUSHL %0                \n\
+            PUSHL %1                \n\
+            PUSHFL                  \n\
+            ORL $0x200, (%%ESP)     \n\
+            PUSHL %2                \n\
+            PUSHL %3                \n\
+            IRET                    \n\
+            execute_return:         \n\
+            LEAVE                   \n\
+            RET                     \n\
+            "
+            :
+            :"i"(USER_DS), "r"(user_sp), "i"(USER_CS), "r"(entry_address),
+             "r"(task_pcb[PID]->esp0), "r"(&parent_pcb->on_cpu)
+            :"%eax", "memory"
+      );
 
       return -1;
 }
 
+/*spawn_handler
+ * Starts a program in the background: like execute, but returns the
+ * child's PID right away instead of waiting for it to halt. The child
+ * shares the caller's terminal and is started by the scheduler. Its exit
+ * status is collected with wait or waitpid.
+ * Returns the child's PID, or -1 if it can't be started.
+ */
+int32_t spawn_handler(const uint8_t * command){
+      void * entry_address;
+      int PID;
+      PCB_t * parent_pcb = get_pcb_ptr();
+
+      if(command == NULL){
+            return -1;
+      }
+
+      PID = load_program(command, &entry_address);
+      cli();
+      if(PID != -1){
+            task_pcb[PID]->background = 1;
+            init_task_stack(PID, entry_address, (void *)(_128MB + _4MB - 4));
+            sched_start_task(task_pcb[PID], -1);
+      }
+
+      //load_program switched to the child's page directory
+      init_control_reg(&(task_pd[parent_pcb->mm_pid].PDE[0]));
+
+      sti();
+
+      return PID;
+}
+
+/*fork_handler
+ * Creates a copy of the calling process: same open files, arguments,
+ * signal handlers and memory, with the memory shared copy-on-write (see
+ * user_space_fork) so nothing is copied until one of them writes. The
+ * child is a background job of the caller, started by the scheduler at
+ * the same point: it returns from fork with 0.
+ * Returns the child's PID in the parent, or -1 if no PID is free.
+ */
+int32_t fork_handler(){
+      PCB_t * parent_pcb = get_pcb_ptr();
+      PCB_t * child_pcb;
+      hw_context_t * parent_frame;
+      hw_context_t * child_frame;
+      uint32_t * child_stack;
+      int PID = -1;
+      int i;
+
+      mutex_lock(&task_lock);
+      cli();
 
+      //find the first available PCB
+      for(i = 0; i < MAX_CONCURRENT_TASKS; i++){
+            if(!task_pcb[i]->is_active && !task_pcb[i]->on_cpu){
+                  PID = i;
+                  break;
+            }
+      }
+      if(PID == -1){
+            mutex_unlock(&task_lock);
+            sti();
+            return -1;
+      }
+      child_pcb = task_pcb[PID];
+
+      //duplicate the PCB and fd table
+      for(i = 0; i < 8; i++){
+            child_pcb->fd[i] = parent_pcb->fd[i];
+      }
+      (void)memcpy(child_pcb->argbuf, parent_pcb->argbuf, sizeof(child_pcb->argbuf));
+      for(i = 0; i < NUM_SIGNALS; i++){
+            child_pcb->sig_handlers[i] = parent_pcb->sig_handlers[i];
+      }
+      child_pcb->sig_pending = 0;
+      child_pcb->sig_mask = parent_pcb->sig_mask;
+      child_pcb->exiting = 0;
+
+      child_pcb->PID = PID;
+      child_pcb->is_active = 1;
+      child_pcb->parent_pcb = parent_pcb;
+      child_pcb->state = TASK_WAITING;
+      child_pcb->background = 1;
+      child_pcb->terminal = parent_pcb->terminal;
+      child_pcb->exit_status = 0;
+      child_pcb->mm_pid = PID;
+      sched_init_task(child_pcb, parent_pcb);
+      acct_init(child_pcb, parent_pcb->name);
+      fpu_init_task(child_pcb, parent_pcb);
+      mutex_init_task(child_pcb);
+      child_pcb->ss0 = KERNEL_DS;
+      child_pcb->esp0 = _8MB - ((PID+1) * _8KB) - 4;
+
+      //only the calling thread is copied
+      user_space_fork(parent_pcb->mm_pid, PID);
+
+      //the child's kernel stack gets a copy of this syscall's frame with
+      //EAX = 0, below a frame task_switch's LEAVE/RET unwinds into the
+      //register restore and IRET of common_interrupt
+      parent_frame = (hw_context_t *)(this_cpu()->tss->esp0 - sizeof(hw_context_t));
+      child_frame = (hw_context_t *)(child_pcb->esp0 - sizeof(hw_context_t));
+      (void)memcpy(child_frame, parent_frame, sizeof(hw_context_t));
+      child_frame->EAX = 0;
+
+      child_stack = (uint32_t *)child_frame;
+      *(--child_stack) = (uint32_t)&fork_return;
+      *(--child_stack) = 0;
+      child_pcb->EBP = (uint32_t)child_stack;
+
+      mutex_unlock(&task_lock);
+      sched_start_task(child_pcb, -1);
+      sti();
+
+      return PID;
+}
+
+/*waitpid_handler
+ * Waits for a child to halt and frees its PCB. pid -1 means any child.
+ * With WNOHANG in options, returns 0 instead of waiting if no matching
+ * child has halted yet. The child's exit status is stored in *status
+ * unless status is NULL.
+ * Returns the child's PID, -ECHILD if there is no such child, or -EINTR if
+ * the caller is about to be killed. Waiting sleeps on the caller's PCB,
+ * which is what a halting child wakes.
+ */
+int32_t waitpid_handler(int32_t pid, int32_t * status, int32_t options){
+      PCB_t * pcb = get_pcb_ptr();
+      PCB_t * child;
+      unsigned long flags;
+      int found;
+      int i;
+
+      if(status != NULL && ((uint32_t)status < _128MB || (uint32_t)status > _132MB - sizeof(int32_t))){
+            return -1;
+      }
+
+      spin_lock_irqsave(&wait_lock, flags);
+      while(1){
+            found = 0;
+            for(i = 0; i < MAX_CONCURRENT_TASKS; i++){
+                  child = task_pcb[i];
+                  if(i == pcb->PID || !child->is_active || child->parent_pcb != pcb){
+                        continue;
+                  }
+                  if(pid != -1 && pid != i){
+                        continue;
+                  }
+                  found = 1;
+
+                  if(child->state == TASK_ZOMBIE){
+                        if(status != NULL){
+                              *status = child->exit_status;
+                        }
+                        child->is_active = 0;
+                        spin_unlock_irqrestore(&wait_lock, flags);
+                        return i;
+                  }
+            }
+
+            if(!found){
+                  spin_unlock_irqrestore(&wait_lock, flags);
+                  return -ECHILD;
+            }
+            if(options & WNOHANG){
+                  spin_unlock_irqrestore(&wait_lock, flags);
+                  return 0;
+            }
+            if(signal_fatal_pending()){
+                  spin_unlock_irqrestore(&wait_lock, flags);
+                  return -EINTR;
+            }
+            sleep_on(pcb);
+      }
+}
+
+/*wait_handler
+ * Waits for any child; the same as waitpid(-1, status, 0).
+ */
+int32_t wait_handler(int32_t * status){
+      return waitpid_handler(-1, status, 0);
+}
+
+
+
+/* fd_would_block
+ * DESCRIPTION:   Checks whether a read on a nonblocking file descriptor has
+ *                to be refused because the driver has no data ready. Drivers
+ *                without a poll function never block.
+ * INPUTS:        desc - the file descriptor about to be read
+ * OUTPUTS:       returns 1 if the read should fail with EAGAIN, 0 otherwise
+ * SIDE EFFECTS:  none
+ */
+int32_t fd_would_block(file_descriptor_t * desc){
+      if(!(desc->flags.status & O_NONBLOCK)){
+            return 0;
+      }
+      if(desc->actions->dev_poll == NULL){
+            return 0;
+      }
+      return !(desc->actions->dev_poll)(desc->inode);
+}
 
 /* read_handler
  * DESCRIPTION:   read takes a file descriptor as argument and reads a specific
@@ -371,11 +788,11 @@ int32_t read_handler(int32_t fd, void* buf, int32_t n_bytes){
        //check to ensure the current fd is in use
        PCB_t * curr_pcb = get_pcb_ptr();
 
-       if(curr_pcb->fd[fd].flags.in_use == 0){
+       if(fd < 0 || fd > 7){
              return -1;
        }
 
-       if(fd < 0 || fd > 7){
+       if(curr_pcb->fd[fd].flags.in_use == 0){
              return -1;
        }
 
@@ -383,10 +800,16 @@ int32_t read_handler(int32_t fd, void* buf, int32_t n_bytes){
              return -1;
        }
 
+       //nonblocking descriptors ask the driver whether a read would block
+       if(fd_would_block(&(curr_pcb->fd[fd]))){
+             return -EAGAIN;
+       }
+
        switch(fd){
              case 0:
                   //read from stdin
-                  return vc_read(curr_pcb->fd[fd].inode, curr_pcb->fd[fd].file_pos, (uint8_t *)buf, n_bytes);
+                  return acct_bytes(&(curr_pcb->acct.bytes_read),
+                                    vc_read(curr_pcb->fd[fd].inode, curr_pcb->fd[fd].file_pos, (uint8_t *)buf, n_bytes));
              case 1:
                   // "read" from standard out, ie, produce an error
                   return -1;
@@ -394,8 +817,10 @@ int32_t read_handler(int32_t fd, void* buf, int32_t n_bytes){
                    //otherwise use the associated file handler in the file descriptor.
                    int32_t retval;
                    retval = (curr_pcb->fd[fd].actions->dev_read)(curr_pcb->fd[fd].inode, curr_pcb->fd[fd].file_pos, (uint8_t *)buf, n_bytes);
-                   curr_pcb->fd[fd].file_pos += retval;
-                   return retval;
+                   if(retval > 0){
+                         curr_pcb->fd[fd].file_pos += retval;
+                   }
+                   return acct_bytes(&(curr_pcb->acct.bytes_read), retval);
              }
        }
 }
@@ -420,11 +845,11 @@ int32_t write_handler(int32_t fd, const void * buf, int32_t n_bytes){
        //check to ensure the current fd is in use
        PCB_t * curr_pcb = get_pcb_ptr();
 
-       if(curr_pcb->fd[fd].flags.in_use == 0){
+       if(fd < 0 || fd > 7){
              return -1;
        }
 
-       if(fd < 0 || fd > 7){
+       if(curr_pcb->fd[fd].flags.in_use == 0){
              return -1;
        }
 
@@ -438,11 +863,13 @@ int32_t write_handler(int32_t fd, const void * buf, int32_t n_bytes){
                   return -1;
              case 1:
                   //write to standard output, the console
-                  return vc_write(fd, (const void *)buf, n_bytes);
+                  return acct_bytes(&(curr_pcb->acct.bytes_written),
+                                    vc_write(fd, (const void *)buf, n_bytes));
              default:
                   //otherwise the associated file handler in the file descriptor
                   //(should return an error)
-                  return (curr_pcb->fd[fd].actions->dev_write)(fd, (const void *)buf, n_bytes);
+                  return acct_bytes(&(curr_pcb->acct.bytes_written),
+                                    (curr_pcb->fd[fd].actions->dev_write)(fd, (const void *)buf, n_bytes));
        }
 }
 
@@ -473,8 +900,9 @@ int32_t open_handler(const uint8_t * filename){
              return -1;
        }
 
+       //files in the boot block first, then the generated proc/ files
        dentry_t temp_dentry;
-       if(read_dentry_by_name(filename, &temp_dentry)){
+       if(read_dentry_by_name(filename, &temp_dentry) && procfs_lookup(filename, &temp_dentry)){
              return -1;
        }
 
@@ -494,6 +922,7 @@ int32_t open_handler(const uint8_t * filename){
        pcb->fd[fd_index].inode = temp_dentry.inode_num;
        pcb->fd[fd_index].file_pos = 0;
        pcb->fd[fd_index].flags.in_use = 1;
+       pcb->fd[fd_index].flags.status = 0;
 
        switch(temp_dentry.file_type){
              case 0:
@@ -508,6 +937,10 @@ int32_t open_handler(const uint8_t * filename){
                   //Regular File
                   (pcb->fd[fd_index].actions) = &file_op_table;
                   return fd_index;
+             case FILE_TYPE_PROC:
+                  //Kernel statistics
+                  (pcb->fd[fd_index].actions) = &procfs_op_table;
+                  return fd_index;
              default:
                   return -2;
        }
@@ -585,19 +1018,11 @@ int32_t vidmap_handler(uint8_t ** screen_start){
       // if(screen_start == NULL)
       //     return -1; moved NULL check to syscall_dispatcher - presumably fine to do (delete this after syserr check)
 
-      cli();
-
       uint32_t phys_mapping;
-
-      if(current_display == running_display){
-            phys_mapping = VIDMEM;
-      }
-      else{
-            phys_mapping = _3MB + running_display*_4KB;
-      }
+      unsigned long flags;
 
       PCB_t * curr_pcb = get_pcb_ptr();
-      uint32_t pid = curr_pcb->PID;
+      uint32_t pid = curr_pcb->mm_pid;    //threads share the mapping
 
       //Ensure the pointer is not NULL and is in bounds
       if(screen_start == NULL){
@@ -609,9 +1034,19 @@ int32_t vidmap_handler(uint8_t ** screen_start){
             return -1;
       }
 
+      //the terminal switch changes vidmap_pt too (see vidmap_remap)
+      spin_lock_irqsave(&video_lock, flags);
+
+      if(current_display == curr_pcb->terminal){
+            phys_mapping = VIDMEM;
+      }
+      else{
+            phys_mapping = _3MB + curr_pcb->terminal*_4KB;
+      }
+
       //set up the page table
       page_directory_entry_4kb_t temp;
-      temp.table_base_addr = ((uint32_t)vidmap_pt) >> 12;
+      temp.table_base_addr = ((uint32_t)vidmap_pt[pid]) >> 12;
       temp.available = 0;
       temp.g = 0;
       temp.page_size = 0;
@@ -636,30 +1071,403 @@ int32_t vidmap_handler(uint8_t ** screen_start){
       temp_pte.present = 1;
 
       //insert the entry into the page table
-      vidmap_pt[((_132MB >> 12) & 0x03FF)]  = temp_pte.val;
+      vidmap_pt[pid][((_132MB >> 12) & 0x03FF)]  = temp_pte.val;
 
       *screen_start = (uint8_t *)_132MB;
 
-      sti();
+      spin_unlock_irqrestore(&video_lock, flags);
 
       return 0;
 }
 
-/*set_handler
- * 0 on success, -1 if fails
+/* vidmap_remap
+ * description: points the vidmap page of every program on a terminal at
+ *              the screen if the terminal is on it, at its backing page
+ *              otherwise. Called by vidchange with video_lock held, after
+ *              current_display changed
+ * input: term - the terminal
+ * output: none
+ * side effects: changes vidmap_pt; the CPUs running those programs still
+ *               have to flush the old mapping (task_switch does)
+ * return: none
  */
-int32_t set_handler() {
-      return -1;
- }
+void vidmap_remap(int term){
+      page_table_entry_t temp_pte;
+      int pte_idx = (_132MB >> 12) & 0x03FF;
+      int pid;
+
+      for(pid = 0; pid < MAX_CONCURRENT_TASKS; pid++){
+            if(!task_pcb[pid]->is_active || task_pcb[pid]->mm_pid != pid ||
+               task_pcb[pid]->terminal != term || !(task_pd[pid].PDE[_132MB >> 22] & 0x1)){
+                  continue;
+            }
+            temp_pte.val = vidmap_pt[pid][pte_idx];
+            if(current_display == term){
+                  temp_pte.physical_page_addr = VIDMEM >> 12;
+            }
+            else{
+                  temp_pte.physical_page_addr = (_3MB + term*_4KB) >> 12;
+            }
+            vidmap_pt[pid][pte_idx] = temp_pte.val;
+      }
+      return;
+}
+
+/* fcntl_handler
+ * DESCRIPTION:   Reads or changes the status flags of an open file descriptor.
+ *                Only O_NONBLOCK can currently be set.
+ * INPUTS:        fd - index into the file descriptor array from the PCB
+ *                cmd - F_GETFL to read the flags, F_SETFL to replace them
+ *                arg - the new flags for F_SETFL, ignored otherwise
+ * OUTPUTS:       returns the flags for F_GETFL, 0 for F_SETFL, -1 on error
+ * SIDE EFFECTS:  changes how reads on fd behave when no data is ready
+ */
+int32_t fcntl_handler(int32_t fd, int32_t cmd, int32_t arg){
+      PCB_t * pcb;
+      pcb = get_pcb_ptr();
+
+      if(fd < 0 || fd > 7){
+            return -1;
+      }
+      if(pcb->fd[fd].flags.in_use == 0){
+            return -1;
+      }
+
+      switch(cmd){
+            case F_GETFL:
+                  return pcb->fd[fd].flags.status;
+            case F_SETFL:
+                  pcb->fd[fd].flags.status = (uint8_t)(arg & O_NONBLOCK);
+                  return 0;
+            default:
+                  return -1;
+      }
+}
 
- /*sigreturn_handler
-  * 0 on success, -1 if fails
-  */
-int32_t sigreturn_handler() {
+/* fd_length
+ * DESCRIPTION:   Finds the length in bytes of whatever a seekable file
+ *                descriptor points to. Regular files report their inode
+ *                length, directories the size of the stream of names that
+ *                dir_read produces.
+ * INPUTS:        desc - the file descriptor
+ * OUTPUTS:       returns the length, or -1 if the descriptor can't seek
+ * SIDE EFFECTS:  none
+ */
+int32_t fd_length(file_descriptor_t * desc){
+      if(desc->actions == &file_op_table){
+            return (int32_t)((inode_t *)(inodes_begin + desc->inode))->length;
+      }
+      if(desc->actions == &dir_op_table){
+            return (int32_t)(filesys_begin->num_dir_entries * FNAME_MAX_LEN);
+      }
       return -1;
 }
 
-int32_t syscall_dispatcher(uint32_t syscall_num, uint32_t arg1, uint32_t arg2, uint32_t arg3){
+/* lseek_handler
+ * DESCRIPTION:   Moves the position used by read on a file or directory,
+ *                so random access no longer needs close, open and a read
+ *                from the start.
+ * INPUTS:        fd - index into the file descriptor array from the PCB
+ *                offset - the new position, relative to whence
+ *                whence - SEEK_SET, SEEK_CUR or SEEK_END
+ * OUTPUTS:       returns the new position, -ESPIPE for devices, -1 on error
+ * SIDE EFFECTS:  changes fd's file_pos
+ */
+int32_t lseek_handler(int32_t fd, int32_t offset, int32_t whence){
+      PCB_t * pcb;
+      int32_t length;
+      int32_t new_pos;
+      pcb = get_pcb_ptr();
+
+      if(fd < 0 || fd > 7){
+            return -1;
+      }
+      if(pcb->fd[fd].flags.in_use == 0){
+            return -1;
+      }
+
+      length = fd_length(&(pcb->fd[fd]));
+      if(length < 0){
+            return -ESPIPE;
+      }
+
+      switch(whence){
+            case SEEK_SET:
+                  new_pos = offset;
+                  break;
+            case SEEK_CUR:
+                  new_pos = (int32_t)pcb->fd[fd].file_pos + offset;
+                  break;
+            case SEEK_END:
+                  new_pos = length + offset;
+                  break;
+            default:
+                  return -1;
+      }
+
+      if(new_pos < 0){
+            return -1;
+      }
+
+      pcb->fd[fd].file_pos = (uint32_t)new_pos;
+      return new_pos;
+}
+
+/* pread_handler
+ * DESCRIPTION:   Reads from an explicit offset of a file or directory without
+ *                using or moving the descriptor's position.
+ * INPUTS:        fd - index into the file descriptor array from the PCB
+ *                buf - the buffer to where the data is to be written
+ *                n_bytes - the number of bytes to read
+ *                offset - where in the file to start reading
+ * OUTPUTS:       returns the number of bytes read, -ESPIPE for devices,
+ *                -1 on error
+ * SIDE EFFECTS:  copies up to n_bytes bytes into buf
+ */
+int32_t pread_handler(int32_t fd, void * buf, int32_t n_bytes, uint32_t offset){
+      PCB_t * pcb;
+      pcb = get_pcb_ptr();
+
+      if(fd < 0 || fd > 7 || buf == NULL || n_bytes < 0){
+            return -1;
+      }
+      if(pcb->fd[fd].flags.in_use == 0){
+            return -1;
+      }
+      if(fd_length(&(pcb->fd[fd])) < 0){
+            return -ESPIPE;
+      }
+
+      return acct_bytes(&(pcb->acct.bytes_read),
+                        (pcb->fd[fd].actions->dev_read)(pcb->fd[fd].inode, offset, (uint8_t *)buf, n_bytes));
+}
+
+/* pwrite_handler
+ * DESCRIPTION:   Positional counterpart of write. The file system is
+ *                read-only, so this only checks the descriptor and lets the
+ *                driver's write report the error.
+ * INPUTS:        fd - index into the file descriptor array from the PCB
+ *                buf - the source of the data
+ *                n_bytes - the number of bytes to be written
+ *                offset - where in the file the data would go
+ * OUTPUTS:       the driver's write return value, -ESPIPE for devices
+ * SIDE EFFECTS:  none for the current drivers
+ */
+int32_t pwrite_handler(int32_t fd, const void * buf, int32_t n_bytes, uint32_t offset){
+      PCB_t * pcb;
+      pcb = get_pcb_ptr();
+
+      if(fd < 0 || fd > 7 || buf == NULL || n_bytes < 0){
+            return -1;
+      }
+      if(pcb->fd[fd].flags.in_use == 0){
+            return -1;
+      }
+      if(fd_length(&(pcb->fd[fd])) < 0){
+            return -ESPIPE;
+      }
+
+      return acct_bytes(&(pcb->acct.bytes_written),
+                        (pcb->fd[fd].actions->dev_write)(fd, buf, n_bytes));
+}
+
+/* readv_handler
+ * DESCRIPTION:   Scatters one read across several buffers. Each segment is
+ *                read in turn at the descriptor's position; a short read
+ *                ends the call early.
+ * INPUTS:        fd - index into the file descriptor array from the PCB
+ *                iov - array of buffers to fill
+ *                iovcnt - number of entries in iov, at most IOV_MAX
+ * OUTPUTS:       returns the total number of bytes read, or the error of the
+ *                first segment if nothing was read
+ * SIDE EFFECTS:  advances fd's file_pos like read
+ */
+int32_t readv_handler(int32_t fd, const iovec_t * iov, int32_t iovcnt){
+      int32_t total = 0;
+      int32_t retval;
+      int i;
+
+      if(iov == NULL || iovcnt <= 0 || iovcnt > IOV_MAX){
+            return -1;
+      }
+
+      for(i = 0; i < iovcnt; i++){
+            retval = read_handler(fd, iov[i].iov_base, iov[i].iov_len);
+            if(retval < 0){
+                  return (total > 0) ? total : retval;
+            }
+            total += retval;
+            if(retval < iov[i].iov_len){
+                  break;
+            }
+      }
+      return total;
+}
+
+/* writev_handler
+ * DESCRIPTION:   Gathers several buffers into one write, so a program can
+ *                send a header and a body without copying them together.
+ * INPUTS:        fd - index into the file descriptor array from the PCB
+ *                iov - array of buffers to write
+ *                iovcnt - number of entries in iov, at most IOV_MAX
+ * OUTPUTS:       returns the total number of bytes written, or the error of
+ *                the first segment if nothing was written
+ * SIDE EFFECTS:  writes each buffer to fd in order
+ */
+int32_t writev_handler(int32_t fd, const iovec_t * iov, int32_t iovcnt){
+      int32_t total = 0;
+      int32_t retval;
+      int i;
+
+      if(iov == NULL || iovcnt <= 0 || iovcnt > IOV_MAX){
+            return -1;
+      }
+
+      for(i = 0; i < iovcnt; i++){
+            retval = write_handler(fd, iov[i].iov_base, iov[i].iov_len);
+            if(retval < 0){
+                  return (total > 0) ? total : retval;
+            }
+            total += retval;
+      }
+      return total;
+}
+
+/* stat_handler
+ * DESCRIPTION:   Looks up a file by name and returns its type, inode,
+ *                length and block count without opening it.
+ * INPUTS:        filename - name of the file
+ *                st - where the metadata is to be written
+ * OUTPUTS:       returns 0 on success, -1 if the file doesn't exist
+ * SIDE EFFECTS:  fills st
+ */
+int32_t stat_handler(const uint8_t * filename, file_stat_t * st){
+      dentry_t temp_dentry;
+
+      if(filename == NULL || *filename == '\0' || st == NULL){
+            return -1;
+      }
+      if(read_dentry_by_name(filename, &temp_dentry) && procfs_lookup(filename, &temp_dentry)){
+            return -1;
+      }
+      return stat_dentry(&temp_dentry, st);
+}
+
+/* fstat_handler
+ * DESCRIPTION:   Returns the metadata of an open file descriptor. The type
+ *                comes from the descriptor's op table, so stdin and stdout
+ *                report FILE_TYPE_TERMINAL.
+ * INPUTS:        fd - index into the file descriptor array from the PCB
+ *                st - where the metadata is to be written
+ * OUTPUTS:       returns 0 on success, -1 on error
+ * SIDE EFFECTS:  fills st
+ */
+int32_t fstat_handler(int32_t fd, file_stat_t * st){
+      PCB_t * pcb;
+      dentry_t temp_dentry;
+      pcb = get_pcb_ptr();
+
+      if(fd < 0 || fd > 7 || st == NULL){
+            return -1;
+      }
+      if(pcb->fd[fd].flags.in_use == 0){
+            return -1;
+      }
+
+      if(pcb->fd[fd].actions == &file_op_table){
+            temp_dentry.file_type = FILE_TYPE_REGULAR;
+      }
+      else if(pcb->fd[fd].actions == &dir_op_table){
+            temp_dentry.file_type = FILE_TYPE_DIR;
+      }
+      else if(pcb->fd[fd].actions == &rtc_op_table){
+            temp_dentry.file_type = FILE_TYPE_RTC;
+      }
+      else if(pcb->fd[fd].actions == &procfs_op_table){
+            temp_dentry.file_type = FILE_TYPE_PROC;
+      }
+      else{
+            temp_dentry.file_type = FILE_TYPE_TERMINAL;
+      }
+      temp_dentry.inode_num = pcb->fd[fd].inode;
+
+      return stat_dentry(&temp_dentry, st);
+}
+
+/* dirstat_handler
+ * DESCRIPTION:   Batched directory read: fills buf with as many
+ *                name-plus-metadata records as fit, starting at the
+ *                directory descriptor's position. The position moves by one
+ *                name per record, so it stays in step with plain reads.
+ * INPUTS:        fd - a descriptor opened on "."
+ *                buf - array of dirent_stat_t records
+ *                n_bytes - size of buf in bytes
+ * OUTPUTS:       returns the number of bytes filled, 0 at the end of the
+ *                directory, -1 on error
+ * SIDE EFFECTS:  advances fd's file_pos
+ */
+int32_t dirstat_handler(int32_t fd, dirent_stat_t * buf, int32_t n_bytes){
+      PCB_t * pcb;
+      int32_t filled;
+      uint32_t index;
+      pcb = get_pcb_ptr();
+
+      if(fd < 0 || fd > 7 || buf == NULL || n_bytes < 0){
+            return -1;
+      }
+      if(pcb->fd[fd].flags.in_use == 0 || pcb->fd[fd].actions != &dir_op_table){
+            return -1;
+      }
+
+      index = pcb->fd[fd].file_pos / FNAME_MAX_LEN;
+      filled = dir_read_stat(index, buf, n_bytes / sizeof(dirent_stat_t));
+      if(filled < 0){
+            return -1;
+      }
+
+      pcb->fd[fd].file_pos = (index + filled) * FNAME_MAX_LEN;
+      return filled * sizeof(dirent_stat_t);
+}
+
+/* getdents_handler
+ * DESCRIPTION:   Fills buf with as many fixed-size directory records (name,
+ *                name length, type and inode) as fit, so a listing costs
+ *                one syscall per buffer instead of one per name. Plain reads
+ *                on the directory still return one name each.
+ * INPUTS:        fd - a descriptor opened on "."
+ *                buf - array of dirent_t records
+ *                n_bytes - size of buf in bytes
+ * OUTPUTS:       returns the number of bytes filled, 0 at the end of the
+ *                directory, -1 on error
+ * SIDE EFFECTS:  advances fd's file_pos one name per record
+ */
+int32_t getdents_handler(int32_t fd, dirent_t * buf, int32_t n_bytes){
+      PCB_t * pcb;
+      int32_t filled;
+      uint32_t index;
+      pcb = get_pcb_ptr();
+
+      if(fd < 0 || fd > 7 || buf == NULL || n_bytes < 0){
+            return -1;
+      }
+      if(pcb->fd[fd].flags.in_use == 0 || pcb->fd[fd].actions != &dir_op_table){
+            return -1;
+      }
+
+      index = pcb->fd[fd].file_pos / FNAME_MAX_LEN;
+      filled = dir_read_entries(index, buf, n_bytes / sizeof(dirent_t));
+      if(filled < 0){
+            return -1;
+      }
+
+      pcb->fd[fd].file_pos = (index + filled) * FNAME_MAX_LEN;
+      return filled * sizeof(dirent_t);
+}
+
+int32_t syscall_dispatcher(uint32_t syscall_num, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4){
+      get_pcb_ptr()->acct.syscalls++;
+      syscall_count[(syscall_num <= NUM_SYSCALLS) ? syscall_num : 0]++;
+
       switch(syscall_num){
             case 1:
                   //system halt
@@ -689,10 +1497,70 @@ int32_t syscall_dispatcher(uint32_t syscall_num, uint32_t arg1, uint32_t arg2, u
                   return vidmap_handler((uint8_t **) arg1);
             case 9:
                   // system set_handler
-                  return set_handler();
+                  return set_handler((int32_t)arg1, (void *)arg2);
             case 10:
                   //system sigreturn
                   return sigreturn_handler();
+            case 11:
+                  //system fcntl
+                  return fcntl_handler((int32_t)arg1, (int32_t)arg2, (int32_t)arg3);
+            case 12:
+                  //system lseek
+                  return lseek_handler((int32_t)arg1, (int32_t)arg2, (int32_t)arg3);
+            case 13:
+                  //system pread
+                  return pread_handler((int32_t)arg1, (void *)arg2, (int32_t)arg3, arg4);
+            case 14:
+                  //system pwrite
+                  return pwrite_handler((int32_t)arg1, (const void *)arg2, (int32_t)arg3, arg4);
+            case 15:
+                  //system readv
+                  return readv_handler((int32_t)arg1, (const iovec_t *)arg2, (int32_t)arg3);
+            case 16:
+                  //system writev
+                  return writev_handler((int32_t)arg1, (const iovec_t *)arg2, (int32_t)arg3);
+            case 17:
+                  //system stat
+                  return stat_handler((const uint8_t *)arg1, (file_stat_t *)arg2);
+            case 18:
+                  //system fstat
+                  return fstat_handler((int32_t)arg1, (file_stat_t *)arg2);
+            case 19:
+                  //system dirstat
+                  return dirstat_handler((int32_t)arg1, (dirent_stat_t *)arg2, (int32_t)arg3);
+            case 20:
+                  //system getdents
+                  return getdents_handler((int32_t)arg1, (dirent_t *)arg2, (int32_t)arg3);
+            case 21:
+                  //system kill
+                  return kill_handler((int32_t)arg1, (int32_t)arg2);
+            case 22:
+                  //system spawn
+                  return spawn_handler((const uint8_t *)arg1);
+            case 23:
+                  //system wait
+                  return wait_handler((int32_t *)arg1);
+            case 24:
+                  //system waitpid
+                  return waitpid_handler((int32_t)arg1, (int32_t *)arg2, (int32_t)arg3);
+            case 25:
+                  //system fork
+                  return fork_handler();
+            case 26:
+                  //system thread_create
+                  return thread_create_handler((void *)arg1, (void *)arg2);
+            case 27:
+                  //system futex
+                  return futex_handler((uint32_t *)arg1, (int32_t)arg2, arg3);
+            case 28:
+                  //system sysstat
+                  return sysstat_handler((sysstat_t *)arg1);
+            case 29:
+                  //system nice
+                  return nice_handler((int32_t)arg1);
+            case 30:
+                  //system procstat
+                  return procstat_handler((procstat_t *)arg1, (int32_t)arg2);
             default:
                   return -1;
       }
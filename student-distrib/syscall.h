@@ -5,6 +5,7 @@
 #include "filesys.h"
 #include "structures.h"
 #include "paging.h"
+#include "mutex.h"
 
 #define PAGE_SIZE 1024
 #define PAGING_SHIFT 12
@@ -19,13 +20,44 @@
 #define _8KB_MASK 0xFFFFE000
 #define MAX_FS 1023*4096
 
+//file descriptor status flags
+#define O_NONBLOCK 0x01
+//fcntl commands
+#define F_GETFL 3
+#define F_SETFL 4
+//returned by a nonblocking read when there is no data ready yet
+#define EAGAIN 11
+//returned when seeking (or positional I/O) is tried on a device
+#define ESPIPE 29
+//lseek whence values
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
+//most buffers a single readv/writev will accept
+#define IOV_MAX 16
+//waitpid option: return 0 instead of waiting for a child
+#define WNOHANG 0x01
+//returned by a blocking call given up because a signal will kill the caller
+#define EINTR 4
+//returned by wait/waitpid when there is no child to wait for
+#define ECHILD 10
+
+
+//highest syscall number
+#define NUM_SYSCALLS 30
+//syscall_count[n] is how many times syscall n was made, [0] counts bad numbers
+extern uint32_t syscall_count[NUM_SYSCALLS + 1];
 
 //dispatcher used for interrupt handling
-int32_t syscall_dispatcher(uint32_t syscall_num, uint32_t arg1, uint32_t arg2, uint32_t arg3);
+int32_t syscall_dispatcher(uint32_t syscall_num, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4);
 
 extern page_directory_t task_pd[MAX_CONCURRENT_TASKS];
 extern PCB_t * task_pcb[MAX_CONCURRENT_TASKS];
-extern uint32_t vidmap_pt[1024];
+//the vidmap page table of each program, by mm_pid
+extern uint32_t vidmap_pt[MAX_CONCURRENT_TASKS][1024];
+
+//held while picking a free PCB and until it is marked active
+extern mutex_t task_lock;
 
 extern op_jmp_table_t vc_op_table;
 
@@ -33,6 +65,12 @@ extern op_jmp_table_t vc_op_table;
 //returns the currently running process' PCB
 PCB_t * get_pcb_ptr();
 
+//ends the current program, returning status from its parent's execute
+int32_t halt_process(uint32_t status);
+
+//points the vidmap pages of a terminal's programs where its text is now
+void vidmap_remap(int term);
+
 static inline int32_t execute(const uint8_t * command){
       int32_t retval;
       asm volatile("          \n\
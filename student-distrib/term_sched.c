@@ -7,12 +7,54 @@
 #include "syscall.h"
 #include "filesys.h"
 #include "i8259.h"
+#include "signal.h"
+#include "smp.h"
+#include "spinlock.h"
+#include "tick.h"
+#include "pit.h"
+#include "term_sched.h"
+#include "acct.h"
+#include "fpu.h"
+#include "irqstat.h"
 
 volatile int current_display;
 volatile int current_pid[3];
-volatile int running_display;
 volatile int flag_for_term_change = -1;
 
+/*PIDs 0-2 are the base shells, one per terminal*/
+#define BASE_SHELLS           3
+
+/*Ticks a process runs at an MLFQ level before it is moved down: longer
+ *slices for the levels CPU-bound processes end up on*/
+#define MLFQ_QUANTUM(prio)    (1 << (prio))
+/*Ticks between resets of every process to the top of its range, so a
+ *process that turned interactive isn't stuck at the bottom*/
+#define MLFQ_BOOST_TICKS      TICK_HZ
+
+/*jiffies at the last priority reset*/
+static uint32_t last_boost = 0;
+
+/*Protects the run queues: the cpu and on_cpu fields of every PCB, and
+ *the picking of the next process. A process stays on the run queue of
+ *the CPU it was put on, unless another CPU with nothing to run steals it
+ *(see steal_task).*/
+static spinlock_t sched_lock = SPINLOCK_INIT;
+
+/*Protects sleeping and waking, see sleep_on*/
+spinlock_t wait_lock = SPINLOCK_INIT;
+
+/*where task_switch clears on_cpu when there is no old process to clear*/
+static volatile uint8_t no_old_process;
+
+static int runnable_on(int PID, cpu_t * cpu);
+static int can_run(int PID, cpu_t * cpu);
+static int count_runnable(cpu_t * cpu);
+static int nr_runnable(cpu_t * cpu);
+static cpu_t * least_loaded(void);
+static int can_steal(int PID, cpu_t * from);
+static int steal_task(cpu_t * cpu);
+static void idle_on_cpu_stack(cpu_t * cpu);
+
 void init_terms(){
       current_display = 0;
       running_display = -1;
@@ -28,85 +70,109 @@ void task_switch(int PID){
 
       //Task switching is comprised of the following steps:
       // 1. Save old process' EPB, ESP, and TSS
-      // 2. Switch the paging for the new process
-      // 3. Switch the video memory
+      // 2. Make the new process this CPU's current one
+      // 3. Switch the paging for the new process (unless it's a thread
+      //    of the same program)
       // 4. Load the new process' TSS, EBP, and ESP
-      // 5. Restore these variables
-      // 6. LEAVE and RET to start running the new process
+      // 5. LEAVE and RET to start running the new process
+
+      cpu_t * cpu = this_cpu();
+      tss_t * cpu_tss = cpu->tss;
+      int prev = cpu->current;
+      PCB_t * old_pcb;
+      PCB_t * new_pcb = task_pcb[PID];
+      volatile uint8_t * old_on_cpu = &no_old_process;
 
       //
       // 1. SAVE THE OLD PROCESS' EBP, ESP, AND TSS
       //
 
-      //get a pointer to the old PCB
-      PCB_t * old_pcb = get_pcb_ptr();
+      //a CPU that hasn't run a process yet is on its own stack: nothing
+      //to save, it never goes back there
+      if(prev != -1){
+            old_pcb = task_pcb[prev];
 
-      //save the old EBP, SS0, and ESP0
+            //save the old EBP, SS0, and ESP0
 
-      asm volatile("                \n\
-            MOVL %%EBP, %0          \n\
-            "
-            : "=r"(old_pcb->EBP)
-      );
-      old_pcb->ss0 = tss.ss0;
-      old_pcb->esp0 = tss.esp0;
+            asm volatile("                \n\
+                  MOVL %%EBP, %0          \n\
+                  "
+                  : "=r"(old_pcb->EBP)
+            );
+            old_pcb->ss0 = cpu_tss->ss0;
+            old_pcb->esp0 = cpu_tss->esp0;
+
+            if(prev != PID){
+                  old_on_cpu = &old_pcb->on_cpu;
+            }
+      }
 
       //
-      // 2. Switch paging for the new process
+      // 2. The new process is this CPU's now, and so is its terminal
       //
 
-      init_control_reg(&(task_pd[PID].PDE[0]));
+      new_pcb->on_cpu = 1;
+      cpu->current = PID;
+      cpu->display = new_pcb->terminal;
 
       //
-      // 3. Switch video memory
+      // 3. Switch paging for the new process
       //
 
-      page_table_entry_t temp_pte;
-      int pte_idx;
+      //threads of one program share a page directory: then only the vidmap
+      //page may have moved (see vidchange), and reloading CR3 would throw
+      //away the whole TLB
+      uint32_t * new_pd = &(task_pd[new_pcb->mm_pid].PDE[0]);
+      uint32_t cr3;
 
-      pte_idx = (VIDMEM >> 12) & 0x03FF;
-      temp_pte.val = paging_table[pte_idx];
+      asm volatile("                \n\
+            MOVL %%CR3, %0          \n\
+            "
+            : "=r"(cr3)
+      );
 
-      if(running_display == current_display){
-            temp_pte.physical_page_addr = VIDMEM >> 12;
+      if(cr3 != (uint32_t)new_pd){
+            init_control_reg(new_pd);
       }
       else{
-            temp_pte.physical_page_addr = (_3MB + _4KB*(running_display)) >> 12;
+            asm volatile("                \n\
+                  INVLPG (%0)             \n\
+                  "
+                  :
+                  : "r"(_132MB)
+                  : "memory"
+            );
       }
 
-      paging_table[pte_idx] = temp_pte.val;
-
-      flush_tlb();
-
       //
       // 4. Load the new process' TSS, EBP, and ESP
       //
 
-      //get a pointer to the new process' PCB
-      PCB_t * new_pcb = task_pcb[PID];
+      cpu_tss->ss0 = new_pcb->ss0;
+      cpu_tss->esp0 = new_pcb->esp0;
 
-      //
-      // 5. Store the new process' TSS, EBP, and ESP
-      //
-
-      tss.ss0 = new_pcb->ss0;
-      tss.esp0 = new_pcb->esp0;
-      asm volatile("          \n\
-            MOVL %0, %%EBP    \n\
-            "
-            :
-            : "g"(new_pcb->EBP)
-      );
+      //its first FPU instruction traps, unless its state is still loaded
+      fpu_switch(PID);
 
       //
-      // 7. LEAVE & RET
+      // 5. LEAVE & RET
       //
 
-      asm volatile("          \n\
-            STI               \n\
-            LEAVE             \n\
-            RET               \n\
+      //the old process stays on_cpu, so no other CPU runs it or reuses
+      //its PID, until LEAVE takes this CPU off its stack. STI holds
+      //interrupts off for one more instruction, so nothing is pushed
+      //onto the old stack in between.
+      irqoff_end();
+      asm volatile("                \n\
+            MOVL %0, %%EBP          \n\
+            MOVB $0, (%1)           \n\
+            STI                     \n\
+            LEAVE                   \n\
+            RET                     \n\
             "
+            :
+            : "r"(new_pcb->EBP), "r"(old_on_cpu)
+            : "memory"
       );
 
       //We should never get here because of LEAVE & RET, but we'll put a
@@ -128,19 +194,19 @@ void task_switch(int PID){
 // change the pt entry to the real one
 //update the cursor location
 
+/*vidchange
+ * Puts terminal to on the screen in place of from: the screen's text is
+ * saved to from's backing page and to's is copied in. Everything that
+ * writes a terminal's text takes video_lock and looks at current_display
+ * to find where it is (see video.c). Programs that vidmap'd either
+ * terminal get their page pointed at its new place, and the other CPUs
+ * are kicked so the ones running them drop the old mapping (task_switch
+ * flushes it); this CPU does on its way out of the interrupt.
+ */
 void vidchange(int from, int to){
-      cli();
-      page_table_entry_t temp_pte;
-      page_table_entry_t backup;
-      int pte_idx = (VIDMEM >> 12) & 0x03FF;
-      temp_pte.val = paging_table[pte_idx];
-      backup.val = paging_table[pte_idx];
-
-      //restore the paging structures to their original values
-      temp_pte.physical_page_addr = (VIDMEM >> 12);
-      paging_table[pte_idx] = temp_pte.val;
+      unsigned long flags;
 
-      flush_tlb();
+      spin_lock_irqsave(&video_lock, flags);
 
       // 1. Save the current video memory in the correct location
       (void)memcpy((void *)(_3MB + (from)*_4KB), (void *)VIDMEM, _4KB);
@@ -148,13 +214,357 @@ void vidchange(int from, int to){
       // 2. Load the new terminals saved video memory into the real video memory
       (void)memcpy((void *)VIDMEM, (void *)(_3MB + (to)*_4KB), _4KB);
 
+      current_display = to;
+      vidmap_remap(from);
+      vidmap_remap(to);
+
       // 3. Update the cursor position
       move_current_cursor();
 
-      flush_tlb();
-      sti();
+      spin_unlock_irqrestore(&video_lock, flags);
+
+      sched_kick_others();
+      return;
+}
+
+/*init_task_stack
+ * Builds the first frame of a process that has never run on its kernel
+ * stack: an IRET frame into user mode at entry_point, below a return address
+ * to that IRET. The EBP this leaves in the PCB is what task_switch's
+ * LEAVE/RET expects, so the scheduler can start the process like any other.
+ * The PCB's esp0 must already be set. user_sp is the initial user stack
+ * pointer: the top of the program's 4MB, or a thread's own stack.
+ */
+void init_task_stack(int PID, void * entry_point, void * user_sp){
+      asm volatile("                      \n\
+            MOVL %%ESP, %%EAX             \n\
+            MOVL %%EBP, %%EBX             \n\
+            MOVL %5, %%ESP                \n\
+            PUSHL %1                      \n\
+            PUSHL %2                      \n\
+            PUSHFL                        \n\
+            ORL $0x200, (%%ESP)           \n\
+            PUSHL %3                      \n\
+            PUSHL %4                      \n\
+            PUSHL $run_iret               \n\
+            PUSHL %4                      \n\
+            MOVL %%ESP, %0                \n\
+            MOVL %%EAX, %%ESP             \n\
+            MOVL %%EBX, %%EBP             \n\
+            JMP skip_iret                 \n\
+            run_iret:                     \n\
+            IRET                          \n\
+            skip_iret:                    \n\
+            "
+            : "=g"(task_pcb[PID]->EBP)
+            : "g"(USER_DS), "g"(user_sp), "g"(USER_CS), "g"(entry_point), "g"(task_pcb[PID]->esp0)
+            : "eax", "ebx"
+      );
+      return;
+}
+
+/*task_run_first
+ * Makes a process that has never run call fn in the kernel, on its own
+ * kernel stack and page directory, before it enters user mode: fn is
+ * slipped in as the return address task_switch's LEAVE/RET takes, with
+ * the IRET of init_task_stack as fn's own. Used by the benchmarks.
+ */
+void task_run_first(int PID, void (*fn)(void)){
+      uint32_t * frame = (uint32_t *)task_pcb[PID]->EBP;
+
+      //frame[0] is the EBP LEAVE pops, frame[1] returns to the IRET
+      frame[-1] = frame[0];
+      frame[0] = (uint32_t)fn;
+      task_pcb[PID]->EBP -= sizeof(uint32_t);
+      return;
+}
+
+/*runnable_on
+ * Whether a process is on a CPU's run queue and ready to run. The run queue
+ * of a CPU is every active process whose cpu field names it.
+ */
+static int runnable_on(int PID, cpu_t * cpu){
+      return task_pcb[PID]->is_active && task_pcb[PID]->state == TASK_RUNNING &&
+             task_pcb[PID]->cpu == cpu->id;
+}
+
+/*can_run
+ * Whether a CPU may pick a process from its run queue: not while the
+ * process is still on_cpu, unless it is the CPU's own current one.
+ */
+static int can_run(int PID, cpu_t * cpu){
+      return runnable_on(PID, cpu) && (!task_pcb[PID]->on_cpu || cpu->current == PID);
+}
+
+/*count_runnable
+ * Counts the runnable processes on a CPU's run queue, including the one it
+ * is running. Called with sched_lock held.
+ */
+static int count_runnable(cpu_t * cpu){
+      int count = 0;
+      int PID;
+
+      for(PID = 0; PID < MAX_CONCURRENT_TASKS; PID++){
+            if(runnable_on(PID, cpu)){
+                  count++;
+            }
+      }
+      return count;
+}
 
-     return;
+/*nr_runnable
+ * count_runnable, taking sched_lock.
+ */
+static int nr_runnable(cpu_t * cpu){
+      unsigned long flags;
+      int count;
+
+      spin_lock_irqsave(&sched_lock, flags);
+      count = count_runnable(cpu);
+      spin_unlock_irqrestore(&sched_lock, flags);
+      return count;
+}
+
+/*least_loaded
+ * The CPU with the fewest runnable processes among those that take
+ * processes, the lowest numbered on a tie. Called with sched_lock held.
+ */
+static cpu_t * least_loaded(void){
+      cpu_t * best = &cpus[0];
+      int best_load = count_runnable(best);
+      int load;
+      int i;
+
+      for(i = 1; i < num_cpus; i++){
+            if(cpus[i].sched && (load = count_runnable(&cpus[i])) < best_load){
+                  best = &cpus[i];
+                  best_load = load;
+            }
+      }
+      return best;
+}
+
+/*can_steal
+ * Whether another CPU may take a process off from's run queue: it must be
+ * runnable and not on_cpu anywhere. A program started by execute isn't
+ * taken: it halts straight back into its parent's execute, on the
+ * parent's CPU. Nor is one of several threads of a program, so a
+ * program's page table changes only ever need one CPU's TLB flushed; nor
+ * the process whose FPU state is in from's registers (see fpu.c).
+ * Called with sched_lock held.
+ */
+static int can_steal(int PID, cpu_t * from){
+      PCB_t * pcb = task_pcb[PID];
+      int i;
+
+      if(!runnable_on(PID, from) || pcb->on_cpu || from->fpu_owner == PID){
+            return 0;
+      }
+      if(PID >= BASE_SHELLS && !pcb->background){
+            return 0;
+      }
+      for(i = 0; i < MAX_CONCURRENT_TASKS; i++){
+            if(i != PID && task_pcb[i]->is_active && task_pcb[i]->mm_pid == pcb->mm_pid){
+                  return 0;
+            }
+      }
+      return 1;
+}
+
+/*steal_task
+ * Called with sched_lock held when a CPU has nothing to run. Moves one
+ * runnable process that is waiting, not running, from the CPU with the
+ * most of them onto this CPU's run queue. Returns its PID, or -1.
+ */
+static int steal_task(cpu_t * cpu){
+      int waiting[MAX_CPUS];
+      int victim;
+      int PID;
+      int i;
+
+      for(i = 0; i < num_cpus; i++){
+            waiting[i] = 0;
+      }
+      for(PID = 0; PID < MAX_CONCURRENT_TASKS; PID++){
+            i = task_pcb[PID]->cpu;
+            if(i != cpu->id && can_steal(PID, &cpus[i])){
+                  waiting[i]++;
+            }
+      }
+
+      victim = -1;
+      for(i = 0; i < num_cpus; i++){
+            if(waiting[i] > 0 && (victim == -1 || waiting[i] > waiting[victim])){
+                  victim = i;
+            }
+      }
+      if(victim == -1){
+            return -1;
+      }
+
+      for(PID = 0; PID < MAX_CONCURRENT_TASKS; PID++){
+            if(task_pcb[PID]->cpu == victim && can_steal(PID, &cpus[victim])){
+                  task_pcb[PID]->cpu = cpu->id;
+                  return PID;
+            }
+      }
+      return -1;
+}
+
+/*next_task
+ * Picks the process to run next on this CPU, multilevel feedback queue
+ * style: the runnable process on the lowest MLFQ level of its run queue,
+ * round-robin in PID order after the current process among those on the
+ * same level. The current process keeps the CPU until its slice runs out
+ * or a process on a lower level becomes runnable. A CPU whose run queue
+ * is empty steals a waiting process from the busiest other CPU. The
+ * process picked is marked on_cpu, so no other CPU picks it as well.
+ * Returns -1 if there is nothing to run at all.
+ */
+int next_task(){
+      cpu_t * cpu = this_cpu();
+      unsigned long flags;
+      int start;
+      int candidate;
+      int PID;
+      int i;
+
+      spin_lock_irqsave(&sched_lock, flags);
+
+      //nothing has run yet: start from PID 0
+      start = cpu->current;
+
+      PID = -1;
+      for(i = 1; i <= MAX_CONCURRENT_TASKS; i++){
+            candidate = (start + i) % MAX_CONCURRENT_TASKS;
+            if(can_run(candidate, cpu) &&
+               (PID == -1 || task_pcb[candidate]->prio < task_pcb[PID]->prio)){
+                  PID = candidate;
+            }
+      }
+      if(PID != -1 && start != -1 && runnable_on(start, cpu) &&
+         task_pcb[start]->slice > 0 && task_pcb[start]->prio <= task_pcb[PID]->prio){
+            PID = start;
+      }
+      if(PID == -1){
+            PID = steal_task(cpu);
+      }
+
+      if(PID != -1){
+            task_pcb[PID]->on_cpu = 1;
+            if(task_pcb[PID]->slice == 0){
+                  task_pcb[PID]->slice = MLFQ_QUANTUM(task_pcb[PID]->prio);
+            }
+      }
+      spin_unlock_irqrestore(&sched_lock, flags);
+      return PID;
+}
+
+/*schedule
+ * Switches to the next runnable process. Returns when the current process
+ * is picked again. With nothing to run, the CPU halts until an interrupt
+ * wakes something up, or another CPU kicks it (see smp_kick); interrupts
+ * taken meanwhile don't schedule themselves, the loop here does. The
+ * periodic tick only runs while there is a second process to preempt for.
+ */
+void schedule(){
+      cpu_t * cpu = this_cpu();
+      int prev;
+      int PID;
+      uint32_t idle_start;
+
+      cli();
+
+      if(cpu->idle){
+            return;
+      }
+      //preemption is off (a spinlock is held, or bottom halves are
+      //running on the current process's stack): switch once it is back on
+      if(cpu->preempt_count){
+            cpu->need_resched = 1;
+            return;
+      }
+      cpu->need_resched = 0;
+
+      prev = cpu->current;
+
+      //something made runnable without wake_task (a new process, a parent
+      //its child halted back to) needs the tick back. The ticks that
+      //passed while it was stopped were prev's, so they are charged
+      //before next_task changes cpu->current
+      if(nr_runnable(cpu) > 1){
+            tick_charge(tick_restart());
+      }
+
+      while((PID = next_task()) == -1){
+            //a process that is over doesn't keep its PID on_cpu while
+            //this CPU idles on its stack
+            if(prev != -1 && (!task_pcb[prev]->is_active || task_pcb[prev]->state == TASK_ZOMBIE)){
+                  idle_on_cpu_stack(cpu);
+            }
+            cpu->idle = 1;
+            idle_start = jiffies;
+            tick_stop(signal_alarm_next());
+            irqoff_end();
+            asm volatile("            \n\
+                  STI                 \n\
+                  HLT                 \n\
+                  CLI                 \n\
+                  "
+                  :
+                  :
+                  : "memory"
+            );
+            irqoff_begin();
+            //like jiffies, idle_jiffies is CPU 0's (see tick.c)
+            if(cpu->id == 0){
+                  idle_jiffies += jiffies - idle_start;
+            }
+            cpu->idle = 0;
+      }
+
+      //a wake while idle already restarted the tick
+      if(nr_runnable(cpu) <= 1){
+            tick_stop(signal_alarm_next());
+      }
+
+      if(PID != prev){
+            nr_switches++;
+            task_pcb[PID]->acct.switches++;
+      }
+
+      //how long input it was woken for waited on the CPU
+      if(task_pcb[PID]->wake_tsc != 0){
+            irqstat_record(IRQSTAT_WAKEUP, rdtsc_lo() - task_pcb[PID]->wake_tsc);
+            task_pcb[PID]->wake_tsc = 0;
+      }
+
+      task_switch(PID);
+
+      return;
+}
+
+/*idle_on_cpu_stack
+ * Moves this CPU off the current process's kernel stack onto its own (see
+ * smp.c), drops the process, and schedules from there: the next process
+ * is switched to like the first one, with no old process to save. Doesn't
+ * return. Called with interrupts off.
+ */
+static void idle_on_cpu_stack(cpu_t * cpu){
+      volatile uint8_t * on_cpu = &task_pcb[cpu->current]->on_cpu;
+
+      cpu->current = -1;
+      asm volatile("                \n\
+            MOVL %0, %%ESP          \n\
+            MOVB $0, (%1)           \n\
+            1:                      \n\
+            CALL schedule           \n\
+            JMP 1b                  \n\
+            "
+            :
+            : "r"(cpu->stack_top), "r"(on_cpu)
+            : "memory"
+      );
 }
 
 void setup_shells(){
@@ -169,29 +579,9 @@ void setup_shells(){
       init_terms();
 
       for(PID = 0; PID < 3; PID++){
-            //set up the paging
-            //set up the vid mem
-            task_pd[PID].PDE[0] = directory_paging[0];
-            //set up the kernel mem
-            task_pd[PID].PDE[1] = directory_paging[1];
-            //set up the program's 4mb page
-            int PDE_index = (int)(_128MB >> 22);
-            page_directory_entry_4mb_t temp_pde;
-            temp_pde.page_base_addr = (uint32_t)((_8MB + PID * _4MB) >> 22);
-            temp_pde.present = 1;
-            temp_pde.wr = 1;
-            temp_pde.us = 1;
-            temp_pde.write_through = 1;
-            temp_pde.cached = 1;
-            temp_pde.accessed = 0;
-            temp_pde.paddling = 0;
-            temp_pde.page_size = 1;
-            temp_pde.g = 0;
-            temp_pde.available = 0;
-            temp_pde.pat = 0;
-            temp_pde.reserved = 0;
-
-            task_pd[PID].PDE[PDE_index] = (uint32_t)temp_pde.val;
+            //set up the paging: kernel, video memory and the program's 4MB
+            //at 128MB, in 4kB pages
+            user_space_create(PID);
             //set the CR3 register to match the new setup
             init_control_reg(&(task_pd[PID].PDE[0]));
 
@@ -200,11 +590,24 @@ void setup_shells(){
             task_pcb[PID]->PID = PID;
             task_pcb[PID]->is_active = 1;
             task_pcb[PID]->parent_pcb = get_pcb_ptr();
+            task_pcb[PID]->state = TASK_WAITING;
+            task_pcb[PID]->on_cpu = 0;
+            task_pcb[PID]->background = 0;
+            task_pcb[PID]->terminal = PID;
+            task_pcb[PID]->mm_pid = PID;
+            sched_init_task(task_pcb[PID], NULL);
+            acct_init(task_pcb[PID], (uint8_t *)"shell");
+            fpu_init_task(task_pcb[PID], NULL);
+            task_pcb[PID]->exit_status = 0;
+            signal_init(task_pcb[PID]);
+            mutex_init_task(task_pcb[PID]);
 
             //set the fd's as empty
             task_pcb[PID]->fd[0].flags.in_use = 1;
+            task_pcb[PID]->fd[0].flags.status = 0;
             task_pcb[PID]->fd[0].actions = &vc_op_table;
             task_pcb[PID]->fd[1].flags.in_use = 1;
+            task_pcb[PID]->fd[1].flags.status = 0;
             task_pcb[PID]->fd[1].actions = &vc_op_table;
             task_pcb[PID]->fd[2].flags.in_use = 0;
             task_pcb[PID]->fd[3].flags.in_use = 0;
@@ -215,63 +618,267 @@ void setup_shells(){
 
             task_pcb[PID]->ss0 = KERNEL_DS;
             task_pcb[PID]->esp0 = _8MB - ((PID+1) * _8KB) - 4;
-            void * user_sp = (void *)(_128MB + _4MB - 4);
-
-            asm volatile("                      \n\
-                  MOVL %%ESP, %%EAX             \n\
-                  MOVL %%EBP, %%EBX             \n\
-                  MOVL %5, %%ESP                \n\
-                  PUSHL %1                      \n\
-                  PUSHL %2                      \n\
-                  PUSHFL                        \n\
-                  PUSHL %3                      \n\
-                  PUSHL %4                      \n\
-                  PUSHL $run_iret               \n\
-                  PUSHL %4                      \n\
-                  MOVL %%ESP, %0                \n\
-                  MOVL %%EAX, %%ESP             \n\
-                  MOVL %%EBX, %%EBP             \n\
-                  JMP skip_iret                 \n\
-                  run_iret:                     \n\
-                  IRET                          \n\
-                  skip_iret:                    \n\
-                  "
-                  : "=g"(task_pcb[PID]->EBP)
-                  : "g"(USER_DS), "g"(user_sp), "g"(USER_CS), "g"(entry_point), "g"(task_pcb[PID]->esp0)
-                  : "eax", "ebx"
-            );
 
+            init_task_stack(PID, entry_point, (void *)(_128MB + _4MB - 4));
+
+            //all on CPU 0 for now: the other CPUs steal the ones they
+            //can once they are let in (see sched_start)
+            sched_start_task(task_pcb[PID], -1);
       }
 
       return;
 }
 
-void asynchronous_task_switch(int new_display){
-      int old_display;
+/*sched_start
+ * Starts the first shell on CPU 0, after letting the other CPUs into the
+ * scheduler. It is claimed first, so none of them can steal it.
+ */
+void sched_start(void){
+      unsigned long flags;
 
-      page_table_entry_t temp_pte;
+      spin_lock_irqsave(&sched_lock, flags);
+      task_pcb[0]->on_cpu = 1;
+      spin_unlock_irqrestore(&sched_lock, flags);
 
-      running_display++;
-      if(running_display > 2){
-            running_display = 0;
-      }
+      smp_start();
+      task_switch(0);
+      return;
+}
+
+/*sched_start_task
+ * Puts a process that has never run on a run queue: cpu's, or if cpu is
+ * -1 the least loaded CPU's, which is kicked to look at it. It is created
+ * TASK_WAITING, so no CPU can pick it while it is still being set up.
+ */
+void sched_start_task(PCB_t * pcb, int32_t cpu){
+      unsigned long flags;
 
-      old_display = current_display;
-      current_display = new_display;
-      vidchange(old_display, current_display);
+      spin_lock_irqsave(&sched_lock, flags);
+      pcb->cpu = (cpu == -1) ? least_loaded()->id : cpu;
+      pcb->state = TASK_RUNNING;
+      spin_unlock_irqrestore(&sched_lock, flags);
 
-      temp_pte.val = vidmap_pt[(_132MB >> 12) & 0x03FF];
+      smp_kick(&cpus[pcb->cpu]);
+      return;
+}
+
+/*sched_hand_over
+ * Makes this CPU run pcb from here on without task_switch: execute jumps
+ * straight into its child, halt back into the parent. The process left
+ * behind stays on_cpu until the jump has taken this CPU off its stack;
+ * the caller clears it then.
+ */
+void sched_hand_over(PCB_t * pcb){
+      cpu_t * cpu = this_cpu();
+      unsigned long flags;
+
+      spin_lock_irqsave(&sched_lock, flags);
+      pcb->cpu = cpu->id;
+      pcb->on_cpu = 1;
+      pcb->state = TASK_RUNNING;
+      cpu->current = pcb->PID;
+      cpu->display = pcb->terminal;
+      spin_unlock_irqrestore(&sched_lock, flags);
+      return;
+}
+
+/*sched_kick_others
+ * Kicks every other CPU into its scheduler (see smp_kick).
+ */
+void sched_kick_others(void){
+      int i;
 
-      if(current_display == running_display){
-            temp_pte.physical_page_addr = (VIDMEM) >> 12;
+      for(i = 0; i < num_cpus; i++){
+            smp_kick(&cpus[i]);
+      }
+      return;
+}
+
+/*sleep_on
+ * Blocks the current process until wake_up(chan) or a signal wakes it.
+ * Call with wait_lock held (spin_lock_irqsave), taken before checking
+ * that what chan stands for hasn't happened yet: whoever makes it happen,
+ * on any CPU, looks for sleepers under wait_lock too, so it can't miss
+ * this one. Callers check again after waking. Returns with wait_lock held
+ * and interrupts off.
+ */
+void sleep_on(void * chan){
+      PCB_t * pcb = get_pcb_ptr();
+
+      pcb->wait_chan = chan;
+      pcb->state = TASK_SLEEPING;
+      while(pcb->state == TASK_SLEEPING){
+            spin_unlock(&wait_lock);
+            schedule();
+            cli();
+            spin_lock(&wait_lock);
+      }
+      pcb->wait_chan = NULL;
+      return;
+}
+
+/*wake_task
+ * Makes a process sleeping in sleep_on or futex runnable again; wait_lock
+ * is held. It may have to share its CPU now: this CPU gets its periodic
+ * tick back, another CPU is kicked to look at its run queue (and woken up
+ * if it is idle).
+ */
+void wake_task(PCB_t * pcb){
+      pcb->state = TASK_RUNNING;
+      if(pcb->cpu == this_cpu()->id){
+            tick_charge(tick_restart());
       }
       else{
-            temp_pte.physical_page_addr = (_3MB + running_display*_4KB) >> 12;
+            smp_kick(&cpus[pcb->cpu]);
+      }
+      return;
+}
+
+/*wake_up_locked
+ * Wakes every process sleeping on chan; wait_lock is held.
+ */
+void wake_up_locked(void * chan){
+      int PID;
+
+      for(PID = 0; PID < MAX_CONCURRENT_TASKS; PID++){
+            if(task_pcb[PID]->is_active && task_pcb[PID]->state == TASK_SLEEPING &&
+               task_pcb[PID]->wait_chan == chan){
+                  wake_task(task_pcb[PID]);
+            }
+      }
+      return;
+}
+
+/*wake_up
+ * Wakes every process sleeping on chan.
+ */
+void wake_up(void * chan){
+      unsigned long flags;
+
+      spin_lock_irqsave(&wait_lock, flags);
+      wake_up_locked(chan);
+      spin_unlock_irqrestore(&wait_lock, flags);
+      return;
+}
+
+/*wake_up_interactive
+ * Wakes every process sleeping on chan for input a user is waiting on
+ * (a keyboard line, an RTC tick). They go back to the top of their MLFQ
+ * range with a full slice, and preempt a CPU-bound process as soon as
+ * the interrupt returns instead of on its next tick (on another CPU, as
+ * soon as the kick from wake_task arrives). The time until schedule runs
+ * them goes into the wakeup histogram (proc/irqstat). Bottom halves call
+ * it with interrupts on, so they are turned off here.
+ */
+void wake_up_interactive(void * chan){
+      cpu_t * cpu = this_cpu();
+      PCB_t * pcb;
+      unsigned long flags;
+      int PID;
+
+      spin_lock_irqsave(&wait_lock, flags);
+      for(PID = 0; PID < MAX_CONCURRENT_TASKS; PID++){
+            pcb = task_pcb[PID];
+            if(pcb->is_active && pcb->state == TASK_SLEEPING && pcb->wait_chan == chan){
+                  pcb->prio = pcb->nice;
+                  pcb->slice = MLFQ_QUANTUM(pcb->prio);
+                  pcb->wake_tsc = rdtsc_lo() | 1;
+                  wake_task(pcb);
+                  if(pcb->cpu == cpu->id &&
+                     (cpu->current == -1 || pcb->prio < task_pcb[cpu->current]->prio)){
+                        cpu->need_resched = 1;
+                  }
+            }
+      }
+      spin_unlock_irqrestore(&wait_lock, flags);
+      return;
+}
+
+/*sched_init_task
+ * Starts a new process at the top MLFQ level its nice value allows. It
+ * inherits nice from the process that created it.
+ */
+void sched_init_task(PCB_t * pcb, PCB_t * parent){
+      pcb->nice = (parent == NULL) ? 0 : parent->nice;
+      pcb->prio = pcb->nice;
+      pcb->slice = MLFQ_QUANTUM(pcb->prio);
+      pcb->wake_tsc = 0;
+      return;
+}
+
+/*sched_tick
+ * Charges the ticks that passed to the running process. A process that
+ * uses up its slice is CPU-bound and moves down a level, behind the
+ * interactive ones. Every MLFQ_BOOST_TICKS everything moves back up.
+ */
+void sched_tick(uint32_t ticks){
+      cpu_t * cpu = this_cpu();
+      PCB_t * pcb;
+      int PID;
+
+      //jiffies only advances on CPU 0 (see tick.c)
+      if(cpu->id == 0 && jiffies - last_boost >= MLFQ_BOOST_TICKS){
+            last_boost = jiffies;
+            for(PID = 0; PID < MAX_CONCURRENT_TASKS; PID++){
+                  task_pcb[PID]->prio = task_pcb[PID]->nice;
+                  task_pcb[PID]->slice = MLFQ_QUANTUM(task_pcb[PID]->prio);
+            }
+      }
+
+      if(cpu->current == -1 || cpu->idle){
+            return;
+      }
+      pcb = task_pcb[cpu->current];
+      if(pcb->slice > ticks){
+            pcb->slice -= ticks;
+            return;
+      }
+      if(pcb->prio < MLFQ_LEVELS - 1){
+            pcb->prio++;
+      }
+      pcb->slice = 0;
+      return;
+}
+
+/*sched_preempt
+ * Called on the way out of a device interrupt: switches right away if the
+ * interrupt woke a process that should run before the current one.
+ */
+void sched_preempt(void){
+      if(this_cpu()->need_resched){
+            schedule();
       }
+      return;
+}
 
-      vidmap_pt[(_132MB >> 12) & 0x03FF] = temp_pte.val;
+/*nice_handler
+ * The nice syscall: adds inc to the caller's nice value, clamped to
+ * 0..NICE_MAX. A process never runs on a lower MLFQ level than its nice
+ * value, so raising it yields to everything else.
+ * Returns the new nice value.
+ */
+int32_t nice_handler(int32_t inc){
+      PCB_t * pcb = get_pcb_ptr();
+      int32_t nice = (int32_t)pcb->nice + inc;
+
+      if(nice < 0){
+            nice = 0;
+      }
+      if(nice > NICE_MAX){
+            nice = NICE_MAX;
+      }
+      pcb->nice = nice;
+      if(pcb->prio < nice){
+            pcb->prio = nice;
+            pcb->slice = 0;
+      }
+      return nice;
+}
+
+void asynchronous_task_switch(int new_display){
+      vidchange(current_display, new_display);
 
-      task_switch(current_pid[running_display]);
+      schedule();
 
       return;
 }
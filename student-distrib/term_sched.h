@@ -1,15 +1,43 @@
 #ifndef _TERM_SCHED_H
 #define _TERM_SCHED_H
 
+#include "structures.h"
+#include "spinlock.h"
+#include "smp.h"
+
 extern volatile int current_display;
-extern volatile int running_display;
 extern volatile int current_pid[3];
 extern volatile int flag_for_term_change;
 
+/* The terminal of the process this CPU runs: where its output goes. Each
+ * CPU runs its own process, so each has its own */
+#define running_display (this_cpu()->display)
+
+/* Held from checking whatever a process is about to sleep for until it is
+ * asleep, and by everything that wakes sleepers (see sleep_on) */
+extern spinlock_t wait_lock;
+
 void setup_shells();
 void task_switch(int PID);
 void vidchange(int from, int to);
 void init_terms();
+void init_task_stack(int PID, void * entry_point, void * user_sp);
+void task_run_first(int PID, void (*fn)(void));
+int next_task();
+void schedule();
+void sched_start(void);
+void sched_start_task(PCB_t * pcb, int32_t cpu);
+void sched_hand_over(PCB_t * pcb);
+void sched_kick_others(void);
+void sleep_on(void * chan);
+void wake_up(void * chan);
+void wake_up_locked(void * chan);
+void wake_task(PCB_t * pcb);
+void wake_up_interactive(void * chan);
+void sched_init_task(PCB_t * pcb, PCB_t * parent);
+void sched_tick(uint32_t ticks);
+void sched_preempt(void);
+int32_t nice_handler(int32_t inc);
 
 void asynchronous_task_switch(int new_display);
 
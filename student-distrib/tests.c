@@ -161,7 +161,7 @@ void list_files(){
 	int32_t fd;
 	uint8_t fname[32];
 	dentry_t file_dentry;
-	inode_t * file_inode;
+	file_stat_t file_info;
 	int file_count;
 	int i;
 
@@ -176,9 +176,8 @@ void list_files(){
 		//get the file name
 		temp = read(fd, fname, FNAME_MAX_LEN);
 		temp = write(1, fname, FNAME_MAX_LEN);
-		temp = read_dentry_by_name(fname, &file_dentry);
-
-		file_inode = (inode_t *)(filesys_begin->directory_entries[i].inode_num + inodes_begin);
+		temp = read_dentry_by_index(i, &file_dentry);
+		temp = stat_dentry(&file_dentry, &file_info);
 
 		//print the file type
 		set_term_x(40);
@@ -187,7 +186,7 @@ void list_files(){
 		//print the size
 		set_term_x(60);
 		print_term((uint8_t *)"size: ", 6);
-		print_num((int)file_inode->length);
+		print_num((int)file_info.length);
 		printchar_term('\n');
 	}
 
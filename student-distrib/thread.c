@@ -0,0 +1,195 @@
+/*thread.c
+ *User threads and futexes. A thread is a PCB of its own (own PID, kernel
+ *stack and user stack) whose mm_pid names the program whose page directory
+ *it runs on, so the threads of a program share all of its memory.
+ */
+
+#include "thread.h"
+#include "lib.h"
+#include "x86_desc.h"
+#include "syscall.h"
+#include "term_sched.h"
+#include "signal.h"
+#include "acct.h"
+#include "fpu.h"
+
+/*Bytes reserved on a thread's stack for the code it returns into*/
+#define TRAMPOLINE_LEN 12
+
+/*What a thread function returns into, copied below its stack:
+ *    MOVL %EAX, %EBX
+ *    MOVL $1, %EAX
+ *    INT $0x80
+ *i.e. halt with the function's return value, ending only that thread.
+ */
+static const uint8_t thread_exit_trampoline[TRAMPOLINE_LEN] = {
+      0x89, 0xC3,
+      0xB8, 0x01, 0x00, 0x00, 0x00,
+      0xCD, 0x80,
+      0x90, 0x90, 0x90
+};
+
+/* thread_create_handler
+ * DESCRIPTION:   Starts entry_point(arg) as a new thread of the calling
+ *                program. It gets its own PID, kernel stack and a
+ *                THREAD_STACK_SIZE user stack picked by its PID, copies of
+ *                the caller's files and signal handlers, and shares
+ *                everything else. It is a background child of the caller:
+ *                join it with waitpid. Returning from entry_point halts
+ *                the thread; the program ends when its first thread halts.
+ * INPUTS:        entry_point - user function to run
+ *                arg - passed to entry_point
+ * OUTPUTS:       the new thread's PID, or -1 on failure
+ * SIDE EFFECTS:  writes the new thread's initial user stack
+ */
+int32_t thread_create_handler(void * entry_point, void * arg){
+      PCB_t * pcb = get_pcb_ptr();
+      PCB_t * thread;
+      uint32_t user_sp;
+      uint32_t trampoline;
+      int PID = -1;
+      int i;
+
+      if((uint32_t)entry_point < _128MB || (uint32_t)entry_point >= _128MB + _4MB){
+            return -1;
+      }
+
+      mutex_lock(&task_lock);
+      cli();
+
+      //find the first available PCB
+      for(i = 0; i < MAX_CONCURRENT_TASKS; i++){
+            if(!task_pcb[i]->is_active && !task_pcb[i]->on_cpu){
+                  PID = i;
+                  break;
+            }
+      }
+      if(PID == -1){
+            mutex_unlock(&task_lock);
+            sti();
+            return -1;
+      }
+      thread = task_pcb[PID];
+
+      for(i = 0; i < 8; i++){
+            thread->fd[i] = pcb->fd[i];
+      }
+      (void)memcpy(thread->argbuf, pcb->argbuf, sizeof(thread->argbuf));
+      signal_init(thread);
+      for(i = 0; i < NUM_SIGNALS; i++){
+            thread->sig_handlers[i] = pcb->sig_handlers[i];
+      }
+
+      thread->PID = PID;
+      thread->is_active = 1;
+      thread->parent_pcb = pcb;
+      thread->state = TASK_WAITING;
+      thread->background = 1;
+      thread->terminal = pcb->terminal;
+      thread->exit_status = 0;
+      thread->mm_pid = pcb->mm_pid;
+      sched_init_task(thread, pcb);
+      acct_init(thread, pcb->name);
+      fpu_init_task(thread, NULL);
+      mutex_init_task(thread);
+      thread->futex_addr = 0;
+      thread->ss0 = KERNEL_DS;
+      thread->esp0 = _8MB - ((PID+1) * _8KB) - 4;
+
+      //user stack, from the top down: exit trampoline, arg, return address
+      user_sp = _128MB + _4MB - (PID + 1) * THREAD_STACK_SIZE;
+      user_sp -= TRAMPOLINE_LEN;
+      trampoline = user_sp;
+      (void)memcpy((void *)trampoline, thread_exit_trampoline, TRAMPOLINE_LEN);
+      user_sp -= sizeof(uint32_t);
+      *(uint32_t *)user_sp = (uint32_t)arg;
+      user_sp -= sizeof(uint32_t);
+      *(uint32_t *)user_sp = trampoline;
+
+      init_task_stack(PID, entry_point, (void *)user_sp);
+
+      //threads of a program stay on one CPU (see can_steal)
+      sched_start_task(thread, this_cpu()->id);
+
+      mutex_unlock(&task_lock);
+      sti();
+
+      return PID;
+}
+
+/* futex_handler
+ * DESCRIPTION:   Sleeps or wakes on a word of user memory, for user-level
+ *                locks and condition variables.
+ *                FUTEX_WAIT: if *addr still equals val, sleep until another
+ *                thread of the program calls FUTEX_WAKE on addr.
+ *                FUTEX_WAKE: wake up to val threads sleeping on addr.
+ *                Checking *addr and going to sleep happen under wait_lock,
+ *                like FUTEX_WAKE, so a wake between the two can't be
+ *                missed.
+ * INPUTS:        addr - 4-byte aligned word in the program's memory
+ *                op - FUTEX_WAIT or FUTEX_WAKE
+ *                val - expected value, or how many threads to wake
+ * OUTPUTS:       WAIT: 0 once woken, -EAGAIN if *addr != val, -EINTR if a
+ *                signal arrived. WAKE: how many threads were woken.
+ *                -1 for a bad address or op.
+ * SIDE EFFECTS:  may block the caller
+ */
+int32_t futex_handler(uint32_t * addr, int32_t op, uint32_t val){
+      PCB_t * pcb = get_pcb_ptr();
+      PCB_t * waiter;
+      unsigned long flags;
+      int32_t woken = 0;
+      int i;
+
+      if((uint32_t)addr < _128MB || (uint32_t)addr > _128MB + _4MB - sizeof(uint32_t) ||
+         ((uint32_t)addr & (sizeof(uint32_t) - 1))){
+            return -1;
+      }
+
+      switch(op){
+            case FUTEX_WAIT:
+                  spin_lock_irqsave(&wait_lock, flags);
+                  if(*addr != val){
+                        spin_unlock_irqrestore(&wait_lock, flags);
+                        return -EAGAIN;
+                  }
+                  if((pcb->sig_pending & ~pcb->sig_mask) || pcb->exiting){
+                        spin_unlock_irqrestore(&wait_lock, flags);
+                        return -EINTR;
+                  }
+
+                  pcb->futex_addr = (uint32_t)addr;
+                  pcb->state = TASK_FUTEX;
+                  while(pcb->state == TASK_FUTEX){
+                        spin_unlock(&wait_lock);
+                        schedule();
+                        cli();
+                        spin_lock(&wait_lock);
+                  }
+                  spin_unlock_irqrestore(&wait_lock, flags);
+
+                  //a wake clears futex_addr, a signal leaves it set
+                  if(pcb->futex_addr != 0){
+                        pcb->futex_addr = 0;
+                        return -EINTR;
+                  }
+                  return 0;
+
+            case FUTEX_WAKE:
+                  spin_lock_irqsave(&wait_lock, flags);
+                  for(i = 0; i < MAX_CONCURRENT_TASKS && woken < val; i++){
+                        waiter = task_pcb[i];
+                        if(waiter->is_active && waiter->state == TASK_FUTEX &&
+                           waiter->mm_pid == pcb->mm_pid && waiter->futex_addr == (uint32_t)addr){
+                              waiter->futex_addr = 0;
+                              wake_task(waiter);
+                              woken++;
+                        }
+                  }
+                  spin_unlock_irqrestore(&wait_lock, flags);
+                  return woken;
+
+            default:
+                  return -1;
+      }
+}
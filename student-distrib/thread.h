@@ -0,0 +1,19 @@
+/* thread.h: Header file for user threads and futexes */
+#ifndef _THREAD_H
+#define _THREAD_H
+
+#include "types.h"
+
+/* user stack of each thread, carved down from the top of the program's
+ * 4MB; the first thread keeps the topmost one */
+#define THREAD_STACK_SIZE 0x10000
+
+/* futex operations */
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+
+/* syscalls */
+int32_t thread_create_handler(void * entry_point, void * arg);
+int32_t futex_handler(uint32_t * addr, int32_t op, uint32_t val);
+
+#endif  /* _THREAD_H */
@@ -0,0 +1,193 @@
+/*tick.c
+ *Dynamic ticks. The scheduler tick only has work to do when there is more
+ *than one process to share a CPU, so when there is one or none, schedule
+ *stops the periodic tick and sets the timer for the next thing that has
+ *to happen on time instead (the next ALARM). Anything that makes a second
+ *process runnable restarts it. jiffies keeps counting the ticks that would
+ *have happened.
+ *Only CPU 0 keeps time: the other CPUs' local APIC timers tick
+ *periodically (see ap_main), and their ticks are only charged to the
+ *process they run.
+ */
+
+#include "tick.h"
+#include "lib.h"
+#include "irq.h"
+#include "lapic.h"
+#include "pit.h"
+#include "syscall.h"
+#include "acct.h"
+#include "term_sched.h"
+#include "smp.h"
+
+/*microseconds and milliseconds in one tick*/
+#define US_PER_TICK       (1000000 / TICK_HZ)
+#define MS_PER_TICK       (1000 / TICK_HZ)
+/*longest the tick stays stopped with the local APIC timer: its count
+ *would overflow not much later. The PIT counts 16 bits: 5 ticks at most*/
+#define LAPIC_MAX_STOP    (10 * TICK_HZ)
+#define PIT_MAX_STOP      (0xFFFF / PIT_TICK_COUNT)
+
+volatile uint32_t jiffies = 0;
+volatile uint32_t idle_jiffies = 0;
+volatile uint32_t nr_interrupts = 0;
+volatile uint32_t nr_switches = 0;
+volatile int32_t tick_stopped = 0;
+
+/*ticks until the one-shot deadline set by tick_stop*/
+static uint32_t stopped_for;
+
+static uint32_t stop_elapsed(void);
+static uint32_t tick_resume(uint32_t passed);
+
+/* tick_interrupt
+ * DESCRIPTION:   Counts a timer interrupt. A periodic one is one tick. A
+ *                one-shot one means the deadline set by tick_stop came:
+ *                all of stopped_for passed, and the periodic tick restarts
+ *                until schedule decides to stop it again.
+ * INPUTS:        none
+ * OUTPUTS:       the number of ticks added to jiffies
+ */
+uint32_t tick_interrupt(void){
+      if(this_cpu()->id != 0){
+            return 1;
+      }
+      if(tick_stopped){
+            return tick_resume(stopped_for);
+      }
+      jiffies++;
+      return 1;
+}
+
+/* tick_stop
+ * DESCRIPTION:   Replaces the periodic tick with a single interrupt ticks
+ *                from now, or sooner if the timer can't count that far.
+ *                Does nothing if the tick is already stopped: moving the
+ *                deadline out again would postpone it forever, since
+ *                jiffies doesn't advance while stopped.
+ * INPUTS:        ticks - the next deadline, in ticks from now
+ * OUTPUTS:       none
+ * SIDE EFFECTS:  reprograms the timer; call with interrupts off
+ */
+void tick_stop(uint32_t ticks){
+      if(this_cpu()->id != 0 || tick_stopped || ticks <= 1){
+            return;
+      }
+
+      if(irq_use_apic){
+            if(ticks > LAPIC_MAX_STOP){
+                  ticks = LAPIC_MAX_STOP;
+            }
+            lapic_timer_oneshot(TIMER_VECTOR, ticks * US_PER_TICK);
+      }
+      else{
+            if(ticks > PIT_MAX_STOP){
+                  ticks = PIT_MAX_STOP;
+            }
+            pit_oneshot(ticks * PIT_TICK_COUNT);
+      }
+
+      stopped_for = ticks;
+      tick_stopped = 1;
+      return;
+}
+
+/* tick_restart
+ * DESCRIPTION:   Goes back to the periodic tick before the deadline, e.g.
+ *                because a second process woke up and the running one may
+ *                have to be preempted.
+ * INPUTS:        none
+ * OUTPUTS:       the whole ticks that passed since tick_stop, 0 if the
+ *                tick wasn't stopped
+ * SIDE EFFECTS:  reprograms the timer; call with interrupts off
+ */
+uint32_t tick_restart(void){
+      if(this_cpu()->id != 0 || !tick_stopped){
+            return 0;
+      }
+      return tick_resume(stop_elapsed());
+}
+
+/* tick_charge
+ * DESCRIPTION:   Bills ticks to the process running on this CPU, for its
+ *                CPU time and its MLFQ slice. Every count of ticks that
+ *                passed goes through here, whether the timer interrupt
+ *                saw them or tick_restart found them on the way back.
+ * INPUTS:        ticks - from tick_interrupt or tick_restart
+ * OUTPUTS:       none
+ */
+void tick_charge(uint32_t ticks){
+      if(ticks == 0){
+            return;
+      }
+      acct_tick(ticks);
+      sched_tick(ticks);
+      return;
+}
+
+/* stop_elapsed
+ * DESCRIPTION:   Reads how far the one-shot timer got. Past the deadline
+ *                (the interrupt may still be pending) it is stopped_for.
+ * INPUTS:        none
+ * OUTPUTS:       whole ticks since tick_stop
+ */
+static uint32_t stop_elapsed(void){
+      uint32_t passed;
+      uint32_t count;
+
+      if(irq_use_apic){
+            passed = lapic_timer_elapsed() / (lapic_ticks_per_ms * MS_PER_TICK);
+      }
+      else{
+            //the PIT counter wraps past 0 and keeps counting down
+            count = pit_read_count();
+            if(count > stopped_for * PIT_TICK_COUNT){
+                  count = 0;
+            }
+            passed = (stopped_for * PIT_TICK_COUNT - count) / PIT_TICK_COUNT;
+      }
+
+      if(passed > stopped_for){
+            passed = stopped_for;
+      }
+      return passed;
+}
+
+/* tick_resume
+ * DESCRIPTION:   Restarts the periodic tick after a stop and accounts for
+ *                the ticks it skipped.
+ * INPUTS:        passed - ticks since tick_stop
+ * OUTPUTS:       passed
+ */
+static uint32_t tick_resume(uint32_t passed){
+      if(irq_use_apic){
+            lapic_timer_periodic(TIMER_VECTOR, TICK_HZ);
+      }
+      else{
+            pit_periodic();
+      }
+
+      tick_stopped = 0;
+      jiffies += passed;
+      return passed;
+}
+
+/* sysstat_handler
+ * DESCRIPTION:   Copies the system-wide counters to user space, so a
+ *                program can work out interrupts and context switches per
+ *                second from two samples.
+ * INPUTS:        buf - where to put them
+ * OUTPUTS:       0 on success, -1 if buf isn't in the program's memory
+ */
+int32_t sysstat_handler(sysstat_t * buf){
+      if((uint32_t)buf < _128MB || (uint32_t)buf > _132MB - sizeof(sysstat_t)){
+            return -1;
+      }
+
+      buf->jiffies = jiffies;
+      buf->tick_hz = TICK_HZ;
+      buf->idle_jiffies = idle_jiffies;
+      buf->interrupts = nr_interrupts;
+      buf->switches = nr_switches;
+      return 0;
+}
@@ -0,0 +1,35 @@
+/* tick.h: Header file for the scheduler tick and dynamic ticks */
+#ifndef _TICK_H
+#define _TICK_H
+
+#include "types.h"
+#include "structures.h"
+
+/* Timer ticks since boot, including the ones skipped while stopped */
+extern volatile uint32_t jiffies;
+
+/* Ticks with nothing to run, hardware interrupts, and switches from one
+ * process to another, since boot */
+extern volatile uint32_t idle_jiffies;
+extern volatile uint32_t nr_interrupts;
+extern volatile uint32_t nr_switches;
+
+/* 1 while the periodic tick is replaced by a one-shot deadline */
+extern volatile int32_t tick_stopped;
+
+/* Called by the timer interrupt: returns the ticks it stands for */
+uint32_t tick_interrupt(void);
+
+/* Stops the periodic tick until at most ticks from now */
+void tick_stop(uint32_t ticks);
+
+/* Restarts the periodic tick; returns the ticks that passed while stopped */
+uint32_t tick_restart(void);
+
+/* Charges ticks that passed to the process running on this CPU */
+void tick_charge(uint32_t ticks);
+
+/* syscall */
+int32_t sysstat_handler(sysstat_t * buf);
+
+#endif  /* _TICK_H */
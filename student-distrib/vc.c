@@ -3,6 +3,17 @@
 #include "keyboard.h"
 #include "video.h"
 #include "term_sched.h"
+#include "signal.h"
+#include "mutex.h"
+
+/* Bytes vc_write prints with interrupts off at a time: one line */
+#define VC_WRITE_CHUNK VGA_WIDTH
+
+spinlock_t vc_buffer_lock = SPINLOCK_INIT;
+
+/* One writer at a time per terminal, so lines from two processes sharing
+ * it don't interleave mid-write */
+static mutex_t vc_write_lock[3] = { MUTEX_INIT, MUTEX_INIT, MUTEX_INIT };
 
 /*
  * init_vc
@@ -59,18 +70,35 @@ int32_t vc_close(int32_t fd){
  * Input: Pointer to the buffer and number of bytes to be written.
  * Output: Written to virtual memory
  * Side effects: Changes the screen cursor position and video memory.
- * Return: -1 on failure, 0 on success
+ *               Interrupts are only off for a line at a time, so a long
+ *               write can be preempted between lines.
+ * Return: -1 on failure, number of bytes written on success
  */
 
 int32_t vc_write(int32_t fd, const void * buf, int32_t n_bytes){
+  int32_t done;
+  int32_t chunk;
+  int term;
+  unsigned long flags;
+
   if(buf == NULL)
       return -1;
-  cli();
 
-  print_term((uint8_t *)buf, n_bytes);
-
-  sti();
-  return 0;
+  /* running_display is switched back with us if we are preempted */
+  term = running_display;
+  mutex_lock(&vc_write_lock[term]);
+
+  for(done = 0; done < n_bytes; done += chunk){
+      chunk = n_bytes - done;
+      if(chunk > VC_WRITE_CHUNK)
+          chunk = VC_WRITE_CHUNK;
+      cli_and_save(flags);
+      print_term((uint8_t *)buf + done, chunk);
+      restore_flags(flags);
+  }
+
+  mutex_unlock(&vc_write_lock[term]);
+  return n_bytes;
 }
 
 /*
@@ -85,6 +113,7 @@ int32_t vc_write(int32_t fd, const void * buf, int32_t n_bytes){
 int32_t vc_read(uint32_t inode_index, uint32_t offset, uint8_t * buf, uint32_t bytes){
 
       int chars_written = 0;
+      unsigned long flags;
 
     if(buf == NULL)
         return -1;
@@ -93,7 +122,22 @@ int32_t vc_read(uint32_t inode_index, uint32_t offset, uint8_t * buf, uint32_t b
         bytes = BUFFER_SIZE; /* maximum number of bytes we can read */
     char* buffer =  (char *)buf;
 
-    while(vc_buffer[running_display][0] == '\0');
+    /* sleep until enter_pressed fills the buffer and wakes us. The lock
+     * is handed over to wait_lock to sleep, so the wake_up can't slip in
+     * between */
+    spin_lock_irqsave(&vc_buffer_lock, flags);
+    while(vc_buffer[running_display][0] == '\0'){
+        /* ctrl + c: stop waiting so the signal can be delivered */
+        if(signal_fatal_pending()){
+            spin_unlock_irqrestore(&vc_buffer_lock, flags);
+            return -1;
+        }
+        spin_lock(&wait_lock);
+        spin_unlock(&vc_buffer_lock);
+        sleep_on(vc_buffer[running_display]);
+        spin_unlock(&wait_lock);
+        spin_lock(&vc_buffer_lock);
+    }
 
     for(i = 0; i < bytes; i++){
         buffer[i] = vc_buffer[running_display][i];
@@ -101,22 +145,38 @@ int32_t vc_read(uint32_t inode_index, uint32_t offset, uint8_t * buf, uint32_t b
     }
 
     clr_buf();
+    spin_unlock_irqrestore(&vc_buffer_lock, flags);
     return chars_written;
 }
 
+/*
+ * vc_poll
+ * Description: Checks whether a line of keyboard input is waiting for the
+ *              running terminal, so nonblocking readers can avoid vc_read's sleep
+ * Input: inode_index - unused
+ * Output: none
+ * Side effects: none
+ * Return: 1 if vc_read would return immediately, 0 otherwise
+ */
+
+int32_t vc_poll(uint32_t inode_index){
+    return vc_buffer[running_display][0] != '\0';
+}
+
 /*
  * clr_buf
- * Description: Helper function to clear the vc_buffer[current_display]
+ * Description: Helper function to clear the vc_buffer[running_display], the
+ *              one vc_read just read. Call with vc_buffer_lock held
  * Input: none
  * Output: none
- * Side effects: vc_buffer[current_display] emptied
+ * Side effects: vc_buffer[running_display] emptied
  * Return: none
  */
 
 void clr_buf(){
     int i;
     for(i = 0; i < BUFFER_SIZE; i++){
-        vc_buffer[current_display][i] = '\0';
+        vc_buffer[running_display][i] = '\0';
     }
 }
 
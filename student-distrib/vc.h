@@ -1,6 +1,7 @@
 #ifndef _VC_H
 #define _VC_H
 #include "types.h"
+#include "spinlock.h"
 
 #define BUFFER_SIZE 128
 #define VGA_WIDTH 80
@@ -14,6 +15,7 @@ int32_t vc_open(const uint8_t * filename);
 int32_t vc_close(int32_t fd);
 int32_t vc_read(uint32_t inode_index, uint32_t offset, uint8_t * buf, uint32_t nbytes);
 int32_t vc_write(int32_t fd, const void * buf, int32_t n_bytes);
+int32_t vc_poll(uint32_t inode_index);
 
 char * get_buffer();
 
@@ -22,5 +24,8 @@ void update_cursor(int x, int y);
 
 char vc_buffer[3][BUFFER_SIZE];
 
+/* Protects vc_buffer: the keyboard bottom half fills it, vc_read empties it */
+extern spinlock_t vc_buffer_lock;
+
 
 #endif  /* _VC_H */
@@ -3,6 +3,7 @@
 #include "vc.h"
 #include "term_sched.h"
 #include "paging.h"
+#include "klog.h"
 
 #define GREEN 0xA
 #define CYAN 0xB
@@ -12,9 +13,31 @@
 vid_data_t * display;
 terminal_info_t tinfo[3];
 
+spinlock_t video_lock = SPINLOCK_INIT;
+
 void move_cursor();
 void move_current_cursor();
 void enable_cursor();
+static vid_data_t * term_text(int term);
+static void scroll_term(vid_data_t * text, int term);
+
+/* term_text
+ * Description : Finds a terminal's text: the screen if it is on it, its
+ *               backing page otherwise. Called with video_lock held, so
+ *               vidchange can't move it meanwhile. Nothing is remapped, so
+ *               processes on other CPUs can write their own terminals at
+ *               the same time.
+ * Input : term - the terminal
+ * Output : none
+ * Side effects: none
+ * Return : its 80x25 characters
+ */
+static vid_data_t * term_text(int term){
+      if(term == current_display){
+            return display;
+      }
+      return (vid_data_t *)(_3MB + term * 0x1000);
+}
 
 /* vid_init
  * Description : initialize the terminal display  -- red as default
@@ -75,19 +98,10 @@ void fill_color(int vid_page, uint8_t color){
  * Return :none
  */
 void clear_term(){
+      unsigned long flags;
       int i;
 
-      page_table_entry_t temp_pte;
-      page_table_entry_t backup;
-      int pte_idx = (VIDMEM >> 12) & 0x03FF;
-      temp_pte.val = paging_table[pte_idx];
-      backup.val = paging_table[pte_idx];
-
-      //restore the paging structures to their original values
-      temp_pte.physical_page_addr = (VIDMEM >> 12);
-      paging_table[pte_idx] = temp_pte.val;
-
-      flush_tlb();
+      spin_lock_irqsave(&video_lock, flags);
 
       //empty the character information in the video memory
       for(i = 0; i < MAXCHAR; i++){
@@ -95,51 +109,34 @@ void clear_term(){
       }
       //set the cursor back to 0.
       tinfo[current_display].offset = 0;
-      move_cursor(); // FIXME: Clear shouldn't remove 391OS> and move_cursor needs to be fixed as well as a result
+      move_current_cursor(); // FIXME: Clear shouldn't remove 391OS> and move_cursor needs to be fixed as well as a result
 
-      paging_table[pte_idx] = backup.val;
-      flush_tlb();
+      spin_unlock_irqrestore(&video_lock, flags);
 
       return;
 }
 
 /* scroll_term
  * Description : shifts characters on display when last line is reached
- * Input : none
+ * Input : text - the terminal's characters, from term_text
+ *         term - the terminal
  * Output : none
  * Side effects: shifts location of characters on display, clears last line
  * Return :none
  */
-void scroll_term(){
-      int i;
-      //shift all the vidmem left by 80
-      for(i = TERMWIDTH; i < MAXCHAR; i++){
-            display[i - TERMWIDTH].character = display[i].character;
-      }
-      //set the cursor to the bottom row
-      tinfo[running_display].offset = TERMWIDTH * (TERMHEIGHT - 1);
-
-      //clear the bottom row
-      for(i = TERMWIDTH * (TERMHEIGHT - 1); i < MAXCHAR; i++){
-            display[i].character = 0;
-      }
-      move_cursor();
-}
-
-void scroll_term_current_term(){
+static void scroll_term(vid_data_t * text, int term){
       int i;
       //shift all the vidmem left by 80
       for(i = TERMWIDTH; i < MAXCHAR; i++){
-            display[i - TERMWIDTH].character = display[i].character;
+            text[i - TERMWIDTH].character = text[i].character;
       }
       //set the cursor to the bottom row
-      tinfo[running_display].offset = TERMWIDTH * (TERMHEIGHT - 1);
+      tinfo[term].offset = TERMWIDTH * (TERMHEIGHT - 1);
 
       //clear the bottom row
       for(i = TERMWIDTH * (TERMHEIGHT - 1); i < MAXCHAR; i++){
-            display[i].character = 0;
+            text[i].character = 0;
       }
-      move_cursor();
 }
 
 
@@ -148,91 +145,108 @@ void scroll_term_current_term(){
  * Input : string - character string to be printed to screen
  *         length - the length of the string
  * Output : none
- * Side effects: edits display and calls scroll_term when bottom of terminal is reached
+ * Side effects: edits display and calls scroll_term when bottom of terminal is reached,
+ *               copies the string to the kernel log if it mirrors the console
  * RETURN : none
  */
 void print_term(uint8_t * string, int length){
+      vid_data_t * text;
+      unsigned long flags;
+      int term = running_display;
       int i;
+
+      klog_console_write((int8_t *)string, length);
+
+      spin_lock_irqsave(&video_lock, flags);
+      text = term_text(term);
       for(i = 0; i < length; i++){
             //check if we've reached the null-termination
             if(string[i] == 0){
                   continue;
             }
             //check if we need to scroll
-            if(tinfo[running_display].offset >= MAXCHAR){
-                  scroll_term();
+            if(tinfo[term].offset >= MAXCHAR){
+                  scroll_term(text, term);
             }
             //check if we have a new line
             if(string[i] == '\n'){
-                  tinfo[running_display].offset -= tinfo[running_display].offset % TERMWIDTH;
-                  tinfo[running_display].offset += TERMWIDTH;
+                  tinfo[term].offset -= tinfo[term].offset % TERMWIDTH;
+                  tinfo[term].offset += TERMWIDTH;
             }
             //otherwise simply print the character
             else{
-                  display[tinfo[running_display].offset].character = string[i];
-                  tinfo[running_display].offset++;
+                  text[tinfo[term].offset].character = string[i];
+                  tinfo[term].offset++;
             }
       }
       move_cursor();
+      spin_unlock_irqrestore(&video_lock, flags);
 }
 
 /* printchar_term
  * Description : behaves as putc function by printing character to terminal
  * Input : char a - the character to be printed to terminal
  * Output : none
- * Side effects: edits display and calls scroll_term when bottom of temrinal is reached
+ * Side effects: edits display and calls scroll_term when bottom of temrinal is reached,
+ *               copies the character to the kernel log if it mirrors the console
  * RETURN : none
  */
 void printchar_term(char a){
+      vid_data_t * text;
+      unsigned long flags;
+      int term = running_display;
+
+      klog_console_write(&a, 1);
       //check for null character
       if(a == '\0'){
             return;
       }
+
+      spin_lock_irqsave(&video_lock, flags);
+      text = term_text(term);
       //check if we need to scroll
-      if(tinfo[running_display].offset >= MAXCHAR){
-            scroll_term();
+      if(tinfo[term].offset >= MAXCHAR){
+            scroll_term(text, term);
       }
       //check for nl character
       if(a == '\n'){
-            tinfo[running_display].offset -= tinfo[running_display].offset % TERMWIDTH;
-            tinfo[running_display].offset += TERMWIDTH;
-            move_cursor();
+            tinfo[term].offset -= tinfo[term].offset % TERMWIDTH;
+            tinfo[term].offset += TERMWIDTH;
       }
       //otherwise print the character
       else{
-            display[tinfo[running_display].offset].character = a;
-            tinfo[running_display].offset++;
+            text[tinfo[term].offset].character = a;
+            tinfo[term].offset++;
       }
       move_cursor();
+      spin_unlock_irqrestore(&video_lock, flags);
 }
 
+/* echo_char_current_term
+ * Description : prints a character typed on the keyboard to the terminal
+ *               on screen, whichever process runs
+ * Input : char a - the character
+ * Output : none
+ * Side effects: edits display, scrolling it when the bottom is reached
+ * RETURN : none
+ */
 void echo_char_current_term(char a){
-
-      page_table_entry_t temp_pte;
-      page_table_entry_t backup;
-      int pte_idx = (VIDMEM >> 12) & 0x03FF;
-      temp_pte.val = paging_table[pte_idx];
-      backup.val = paging_table[pte_idx];
-
-      //restore the paging structures to their original values
-      temp_pte.physical_page_addr = (VIDMEM >> 12);
-      paging_table[pte_idx] = temp_pte.val;
-
-      flush_tlb();
+      unsigned long flags;
 
       //check for null character
       if(a == '\0'){
             return;
       }
+
+      spin_lock_irqsave(&video_lock, flags);
       //check if we need to scroll
       if(tinfo[current_display].offset >= MAXCHAR){
-            scroll_term_current_term();
+            scroll_term(display, current_display);
       }
       //check for nl character
       if(a == '\n'){
             tinfo[current_display].offset -= tinfo[current_display].offset % TERMWIDTH;
             tinfo[current_display].offset += TERMWIDTH;
-            move_cursor();
       }
       //otherwise print the character
       else{
@@ -240,9 +254,7 @@ void echo_char_current_term(char a){
             tinfo[current_display].offset++;
       }
       move_current_cursor();
-
-      paging_table[pte_idx] = backup.val;
-      flush_tlb();
+      spin_unlock_irqrestore(&video_lock, flags);
 }
 
 /* backspace
@@ -253,19 +265,9 @@ void echo_char_current_term(char a){
  * RETURN : none
  */
 void backspace(){
+      unsigned long flags;
 
-      page_table_entry_t temp_pte;
-      page_table_entry_t backup;
-      int pte_idx = (VIDMEM >> 12) & 0x03FF;
-      temp_pte.val = paging_table[pte_idx];
-      backup.val = paging_table[pte_idx];
-
-      //restore the paging structures to their original values
-      temp_pte.physical_page_addr = (VIDMEM >> 12);
-      paging_table[pte_idx] = temp_pte.val;
-
-      flush_tlb();
-
+      spin_lock_irqsave(&video_lock, flags);
 
       tinfo[current_display].offset--;
       if(tinfo[current_display].offset > MAXCHAR){
@@ -276,9 +278,7 @@ void backspace(){
 
       move_current_cursor();
 
-      paging_table[pte_idx] = backup.val;
-      flush_tlb();
-
+      spin_unlock_irqrestore(&video_lock, flags);
 
       return;
 }
@@ -291,16 +291,21 @@ void backspace(){
  * RETURN : none
  */
 void tab(){
-      if(tinfo[running_display].offset == MAXCHAR){
-            scroll_term();
+      unsigned long flags;
+      int term = running_display;
+
+      spin_lock_irqsave(&video_lock, flags);
+      if(tinfo[term].offset == MAXCHAR){
+            scroll_term(term_text(term), term);
       }
-      if((tinfo[running_display].offset % TERMWIDTH + 10) > TERMWIDTH){
-            tinfo[running_display].offset += (TERMWIDTH - tinfo[running_display].offset % TERMWIDTH);
+      if((tinfo[term].offset % TERMWIDTH + 10) > TERMWIDTH){
+            tinfo[term].offset += (TERMWIDTH - tinfo[term].offset % TERMWIDTH);
       }
       else{
-            tinfo[running_display].offset = tinfo[running_display].offset + 10;
+            tinfo[term].offset = tinfo[term].offset + 10;
       }
       move_cursor();
+      spin_unlock_irqrestore(&video_lock, flags);
       return;
 }
 
@@ -312,12 +317,17 @@ void tab(){
  * RETURN : none
  */
 void set_term_x(uint32_t x){
+      unsigned long flags;
+      int term = running_display;
+
       if(x > TERMWIDTH){
             return;
       }
-      tinfo[running_display].offset -= tinfo[running_display].offset % TERMWIDTH;
-      tinfo[running_display].offset += x;
+      spin_lock_irqsave(&video_lock, flags);
+      tinfo[term].offset -= tinfo[term].offset % TERMWIDTH;
+      tinfo[term].offset += x;
       move_cursor();
+      spin_unlock_irqrestore(&video_lock, flags);
       return;
 }
 
@@ -358,10 +368,12 @@ void print_num(int x){
  move_cursor
  This program was inspired by the resources available
  on the osdev.org wiki
+ The hardware cursor belongs to the terminal on screen: processes writing
+ the others leave it alone.
  */
  void move_cursor(){
 
-       if(running_display != running_display){
+       if(running_display != current_display){
              return;
        }
 
@@ -382,10 +394,10 @@ void print_num(int x){
 
  void enable_cursor(){
        outb(0x0A, 0x3D4);
-       outb((inb(0x3D5) & 0xC0) | tinfo[running_display].cursor_start, 0x3D5);
+       outb((inb(0x3D5) & 0xC0) | tinfo[current_display].cursor_start, 0x3D5);
 
       outb(0x3D4, 0x0B);
-      outb((inb(0x3D5) & 0xE0) | tinfo[running_display].cursor_end, 0x3D5);
+      outb((inb(0x3D5) & 0xE0) | tinfo[current_display].cursor_end, 0x3D5);
  }
 
 void flush_tlb(){
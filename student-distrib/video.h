@@ -1,4 +1,5 @@
 #include "types.h"
+#include "spinlock.h"
 
 #define VIDMEM  0x000B8000
 #define TERMHEIGHT 25
@@ -40,6 +41,12 @@ void fill_color(int vid_page, uint8_t color);  /* fills display with red
 
 void move_cursor();                             /* moves the cursor to the offset specified by tinfo*/
 
+void move_current_cursor();                     /* moves the cursor of the terminal on screen */
+
 void flush_tlb();                               /* Flushes the TLB */
 
 void echo_char_current_term(char a);            /* Write to the current display */
+
+/* Held while writing a terminal's text or moving it on or off the screen
+ * (vidchange), by any CPU */
+extern spinlock_t video_lock;
@@ -16,6 +16,11 @@
 #define KERNEL_TSS  0x0030
 #define KERNEL_LDT  0x0038
 
+/* Most processors the kernel brings up (see smp.c). CPU 0 uses KERNEL_TSS;
+ * every other CPU n has its own TSS at CPU_TSS(n). */
+#define MAX_CPUS    8
+#define CPU_TSS(n)  (KERNEL_LDT + 8 * (n))
+
 /* Size of the task state segment (TSS) */
 #define TSS_SIZE    104
 
@@ -123,6 +128,7 @@ extern uint32_t ldt;
 extern uint32_t tss_size;
 extern seg_desc_t tss_desc_ptr;
 extern tss_t tss;
+extern seg_desc_t cpu_tss_desc_ptr[MAX_CPUS - 1];
 
 /* Sets runtime-settable parameters in the GDT entry for the LDT */
 #define SET_LDT_PARAMS(str, addr, lim)                          \
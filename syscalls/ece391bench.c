@@ -0,0 +1,79 @@
+#include <stdint.h>
+
+#include "ece391bench.h"
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/* RTC rate and ticks bench_init measures the TSC over: 250ms */
+#define CAL_HZ    64
+#define CAL_TICKS 16
+#define US_PER_S  1000000
+#define NUMSIZE   16
+
+static uint32_t tsc_per_us;
+
+int32_t bench_init (void)
+{
+    int32_t rtc_fd, rate, garbage, i;
+    uint32_t start, cycles;
+
+    if (-1 == (rtc_fd = ece391_open ((uint8_t*)"rtc")))
+        return -1;
+    rate = CAL_HZ;
+    ece391_write (rtc_fd, &rate, 4);
+
+    /* start on a tick edge */
+    ece391_read (rtc_fd, &garbage, 4);
+    start = bench_cycles ();
+    for (i = 0; i < CAL_TICKS; i++)
+        ece391_read (rtc_fd, &garbage, 4);
+    cycles = bench_cycles () - start;
+    ece391_close (rtc_fd);
+
+    tsc_per_us = cycles / (CAL_TICKS * (US_PER_S / CAL_HZ));
+    if (0 == tsc_per_us)
+        return -1;
+    return 0;
+}
+
+uint32_t bench_cycles (void)
+{
+    uint32_t lo;
+
+    asm volatile ("rdtsc" : "=a" (lo) : : "edx");
+    return lo;
+}
+
+uint32_t bench_us (uint32_t cycles)
+{
+    return cycles / tsc_per_us;
+}
+
+uint32_t bench_ns (uint32_t cycles, uint32_t ops)
+{
+    /* keep cycles * 1000 within 32 bits */
+    if (cycles < 0xFFFFFFFF / 1000)
+        return cycles * 1000 / tsc_per_us / ops;
+    return cycles / tsc_per_us * 1000 / ops;
+}
+
+void bench_begin (const char* name)
+{
+    ece391_fdputs (1, (uint8_t*)"bench=");
+    ece391_fdputs (1, (uint8_t*)name);
+}
+
+void bench_kv (const char* key, uint32_t value)
+{
+    uint8_t buf[NUMSIZE];
+
+    ece391_fdputs (1, (uint8_t*)" ");
+    ece391_fdputs (1, (uint8_t*)key);
+    ece391_fdputs (1, (uint8_t*)"=");
+    ece391_fdputs (1, ece391_itoa (value, buf, 10));
+}
+
+void bench_end (void)
+{
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
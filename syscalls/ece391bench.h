@@ -0,0 +1,33 @@
+#if !defined(ECE391BENCH_H)
+#define ECE391BENCH_H
+
+#include <stdint.h>
+
+/*
+ * Shared by the *bench programs.  Times are taken with the TSC, which
+ * bench_init measures against the RTC.  Results go out one line each as
+ * space-separated key=value pairs, starting with bench=<name>, so runs
+ * on two kernel builds can be diffed or parsed:
+ *
+ *     bench=read size=4096 bytes=1048576 us=8123 KBps=129089
+ */
+
+/* How many times each measurement is repeated; the best run is kept */
+#define BENCH_RUNS 5
+
+/* Measures the TSC rate; returns 0, or -1 if the RTC can't be used */
+extern int32_t bench_init (void);
+
+/* Low 32 bits of the TSC: good for a little over a second */
+extern uint32_t bench_cycles (void);
+
+/* Cycles in microseconds, and per operation in nanoseconds */
+extern uint32_t bench_us (uint32_t cycles);
+extern uint32_t bench_ns (uint32_t cycles, uint32_t ops);
+
+/* Writing a result line: bench_begin, bench_kv for each value, bench_end */
+extern void bench_begin (const char* name);
+extern void bench_kv (const char* key, uint32_t value);
+extern void bench_end (void);
+
+#endif /* ECE391BENCH_H */
@@ -0,0 +1,48 @@
+#include <stdint.h>
+
+#include "ece391bench.h"
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define CHILD_ARG "child"
+#define CHILD_CMD "execbench child"
+#define EXECS 20
+
+/*
+ * execute+halt latency: runs itself with the argument "child", which
+ * halts straight away, so each round trip is the parse, the load of this
+ * program, its paging, the switch to user mode and back, and the halt.
+ */
+int main ()
+{
+    uint8_t arg[8];
+    uint32_t start, cycles, best, i, r;
+
+    if (0 == ece391_getargs (arg, 8) && 0 == ece391_strcmp (arg, (uint8_t*)CHILD_ARG))
+        return 0;
+
+    if (0 != bench_init ()) {
+        ece391_fdputs (1, (uint8_t*)"rtc unavailable\n");
+        return 2;
+    }
+
+    best = 0xFFFFFFFF;
+    for (r = 0; r < BENCH_RUNS; r++) {
+        start = bench_cycles ();
+        for (i = 0; i < EXECS; i++) {
+            if (0 != ece391_execute ((uint8_t*)CHILD_CMD)) {
+                ece391_fdputs (1, (uint8_t*)"execute failed\n");
+                return 3;
+            }
+        }
+        cycles = bench_cycles () - start;
+        if (cycles < best)
+            best = cycles;
+    }
+
+    bench_begin ("execute");
+    bench_kv ("execs", EXECS);
+    bench_kv ("us_per_exec", bench_us (best) / EXECS);
+    bench_end ();
+    return 0;
+}
@@ -5,6 +5,18 @@
 
 #define BUFSIZE 1024
 #define SBUFSIZE 33
+#define NUM_DIRENTS 16
+
+/* copy a directory record's name into a NUL-terminated buffer */
+static void
+copy_name (uint8_t* dst, const uint8_t* src, uint32_t len)
+{
+    uint32_t i;
+
+    for (i = 0; i < len; i++)
+        dst[i] = src[i];
+    dst[len] = '\0';
+}
 
 int32_t
 do_one_file (const char* s, const char* fname) 
@@ -67,9 +79,10 @@ do_one_file (const char* s, const char* fname)
 
 int main ()
 {
-    int32_t fd, cnt;
+    int32_t fd, cnt, i;
     uint8_t buf[SBUFSIZE];
     uint8_t search[BUFSIZE];
+    struct ece391_dirent ents[NUM_DIRENTS];
 
     if (0 != ece391_getargs (search, BUFSIZE)) {
         ece391_fdputs (1, (uint8_t*)"could not read argument\n");
@@ -81,16 +94,18 @@ int main ()
 	return 2;
     }
 
-    while (0 != (cnt = ece391_read (fd, buf, SBUFSIZE-1))) {
-        if (-1 == cnt) {
+    while (0 != (cnt = ece391_getdents (fd, ents, sizeof (ents)))) {
+        if (0 > cnt) {
 	    ece391_fdputs (1, (uint8_t*)"directory entry read failed\n");
 	    return 3;
 	}
-	if ('.' == buf[0]) /* a directory... */
-	    continue;
-	buf[cnt] = '\0';
-	if (0 != do_one_file ((char*)search, (char*)buf))
-	    return 3;
+	for (i = 0; i < cnt / (int32_t)sizeof (ents[0]); i++) {
+	    if (FILE_TYPE_REGULAR != ents[i].file_type) /* directory or rtc */
+	        continue;
+	    copy_name (buf, ents[i].file_name, ents[i].name_len);
+	    if (0 != do_one_file ((char*)search, (char*)buf))
+	        return 3;
+	}
     }
 
     return 0;
@@ -0,0 +1,61 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define RTC_HZ 2
+#define SECONDS 5
+#define BUFSIZE 16
+
+/* print label, then value followed by unit */
+static void
+print_stat (const char* label, uint32_t value, const char* unit)
+{
+    uint8_t buf[BUFSIZE];
+
+    ece391_fdputs (1, (uint8_t*)label);
+    ece391_fdputs (1, ece391_itoa (value, buf, 10));
+    ece391_fdputs (1, (uint8_t*)unit);
+}
+
+/*
+ * Samples the kernel's counters, sleeps on the RTC for a few seconds and
+ * reports interrupts and context switches per second, and how much of the
+ * time the CPU was halted.  Run it on an otherwise idle system to see
+ * what the kernel costs when nothing is happening.
+ */
+int main ()
+{
+    struct ece391_sysstat before, after;
+    int32_t rtc_fd, rate, garbage, i;
+    uint32_t ticks, secs;
+
+    if (-1 == (rtc_fd = ece391_open ((uint8_t*)"rtc"))) {
+        ece391_fdputs (1, (uint8_t*)"rtc open failed\n");
+        return 2;
+    }
+    rate = RTC_HZ;
+    ece391_write (rtc_fd, &rate, 4);
+
+    if (0 != ece391_sysstat (&before)) {
+        ece391_fdputs (1, (uint8_t*)"sysstat failed\n");
+        return 3;
+    }
+    for (i = 0; i < RTC_HZ * SECONDS; i++)
+        ece391_read (rtc_fd, &garbage, 4);
+    ece391_sysstat (&after);
+    ece391_close (rtc_fd);
+
+    ticks = after.jiffies - before.jiffies;
+    secs = ticks / after.tick_hz;
+    if (0 == secs) {
+        ece391_fdputs (1, (uint8_t*)"no time passed\n");
+        return 3;
+    }
+
+    print_stat ("interval: ", ticks, " ticks\n");
+    print_stat ("interrupts/s: ", (after.interrupts - before.interrupts) / secs, "\n");
+    print_stat ("switches/s: ", (after.switches - before.switches) / secs, "\n");
+    print_stat ("idle: ", (after.idle_jiffies - before.idle_jiffies) * 100 / ticks, "%\n");
+    return 0;
+}
@@ -4,26 +4,53 @@
 #include "ece391syscall.h"
 
 #define SBUFSIZE 33
+#define NUM_RECORDS 16
+#define NAME_COLUMN 34
+
+static void print_entry (const struct ece391_dirent_stat* ent);
 
 int main ()
 {
-    int32_t fd, cnt;
-    uint8_t buf[SBUFSIZE];
+    int32_t fd, cnt, i;
+    struct ece391_dirent_stat ents[NUM_RECORDS];
 
     if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
         ece391_fdputs (1, (uint8_t*)"directory open failed\n");
         return 2;
     }
 
-    while (0 != (cnt = ece391_read (fd, buf, SBUFSIZE-1))) {
-        if (-1 == cnt) {
+    /* one system call per batch of entries rather than one per name */
+    while (0 != (cnt = ece391_dirstat (fd, ents, sizeof (ents)))) {
+        if (0 > cnt) {
 	        ece391_fdputs (1, (uint8_t*)"directory entry read failed\n");
 	        return 3;
 	    }
-	    buf[cnt] = '\n';
-	    if (-1 == ece391_write (1, buf, cnt + 1))
-	        return 3;
+	    for (i = 0; i < cnt / (int32_t)sizeof (ents[0]); i++)
+	        print_entry (&ents[i]);
     }
 
     return 0;
 }
+
+static void
+print_entry (const struct ece391_dirent_stat* ent)
+{
+    uint8_t buf[SBUFSIZE];
+    uint8_t num[SBUFSIZE];
+    int32_t len;
+
+    /* names that use all 32 bytes are not NUL-terminated */
+    for (len = 0; len < SBUFSIZE - 1 && '\0' != ent->file_name[len]; len++)
+        buf[len] = ent->file_name[len];
+    buf[len] = '\0';
+
+    ece391_fdputs (1, buf);
+    for (; len < NAME_COLUMN; len++)
+        ece391_fdputs (1, (uint8_t*)" ");
+
+    ece391_fdputs (1, (uint8_t*)"type: ");
+    ece391_fdputs (1, ece391_itoa (ent->stat.file_type, num, 10));
+    ece391_fdputs (1, (uint8_t*)"  size: ");
+    ece391_fdputs (1, ece391_itoa (ent->stat.length, num, 10));
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
@@ -0,0 +1,64 @@
+#include <stdint.h>
+
+#include "ece391bench.h"
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define DEFAULT_FILE "frame0.txt"
+#define MISSING_FILE "no_such_file"
+#define PAIRS 1000
+
+/* best time for PAIRS opens and closes of name; opens that fail are
+ * still counted, to time looking up a missing file */
+static uint32_t
+time_open_close (const uint8_t* name)
+{
+    uint32_t start, cycles, best, i, r;
+    int32_t fd;
+
+    best = 0xFFFFFFFF;
+    for (r = 0; r < BENCH_RUNS; r++) {
+        start = bench_cycles ();
+        for (i = 0; i < PAIRS; i++) {
+            if (-1 != (fd = ece391_open (name)))
+                ece391_close (fd);
+        }
+        cycles = bench_cycles () - start;
+        if (cycles < best)
+            best = cycles;
+    }
+    return best;
+}
+
+/*
+ * Open/close rate: opens and closes a file (the argument, or frame0.txt)
+ * over and over, then does the same with a name that isn't there, which
+ * makes the kernel look through the whole directory.
+ */
+int main ()
+{
+    uint8_t name[33];
+    uint32_t best, ns;
+
+    if (0 != bench_init ()) {
+        ece391_fdputs (1, (uint8_t*)"rtc unavailable\n");
+        return 2;
+    }
+    if (0 != ece391_getargs (name, 33))
+        ece391_strcpy (name, (uint8_t*)DEFAULT_FILE);
+
+    best = time_open_close (name);
+    ns = bench_ns (best, PAIRS);
+    bench_begin ("open_close");
+    bench_kv ("pairs", PAIRS);
+    bench_kv ("ns_per_pair", ns);
+    bench_kv ("pairs_per_s", ns ? 1000000000 / ns : 0);
+    bench_end ();
+
+    best = time_open_close ((uint8_t*)MISSING_FILE);
+    bench_begin ("open_missing");
+    bench_kv ("opens", PAIRS);
+    bench_kv ("ns_per_open", bench_ns (best, PAIRS));
+    bench_end ();
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <stdint.h>
+
+#include "ece391bench.h"
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define DEFAULT_FILE "fish"
+#define MAX_BUF 16384
+/* read at least this much per run, going over the file as often as needed */
+#define TARGET_BYTES (256 * 1024)
+#define NUM_SIZES 6
+
+static const uint32_t sizes[NUM_SIZES] = { 16, 64, 256, 1024, 4096, MAX_BUF };
+static uint8_t buf[MAX_BUF];
+
+/*
+ * Read throughput by buffer size: reads a file (the argument, or fish)
+ * from start to end with read buffers from 16B to 16kB, to show what each
+ * system call costs against the bytes it copies.
+ */
+int main ()
+{
+    uint8_t name[33];
+    struct ece391_stat st;
+    uint32_t passes, bytes, start, cycles, best, us, s, p, r;
+    int32_t fd, got;
+
+    if (0 != bench_init ()) {
+        ece391_fdputs (1, (uint8_t*)"rtc unavailable\n");
+        return 2;
+    }
+    if (0 != ece391_getargs (name, 33))
+        ece391_strcpy (name, (uint8_t*)DEFAULT_FILE);
+    if (-1 == (fd = ece391_open (name)) || 0 != ece391_fstat (fd, &st) ||
+        0 == st.length) {
+        ece391_fdputs (1, (uint8_t*)"can't read file\n");
+        return 3;
+    }
+    passes = (TARGET_BYTES + st.length - 1) / st.length;
+
+    for (s = 0; s < NUM_SIZES; s++) {
+        best = 0xFFFFFFFF;
+        bytes = 0;
+        for (r = 0; r < BENCH_RUNS; r++) {
+            bytes = 0;
+            start = bench_cycles ();
+            for (p = 0; p < passes; p++) {
+                ece391_lseek (fd, 0, SEEK_SET);
+                while (0 < (got = ece391_read (fd, buf, sizes[s])))
+                    bytes += got;
+            }
+            cycles = bench_cycles () - start;
+            if (cycles < best)
+                best = cycles;
+        }
+
+        us = bench_us (best);
+        bench_begin ("read");
+        bench_kv ("size", sizes[s]);
+        bench_kv ("bytes", bytes);
+        bench_kv ("us", us);
+        /* bytes per millisecond is kB/s */
+        bench_kv ("KBps", us >= 1000 ? bytes / (us / 1000) : 0);
+        bench_end ();
+    }
+
+    ece391_close (fd);
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include <stdint.h>
+
+#include "ece391bench.h"
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/* the fastest rate the RTC driver allows, for two seconds */
+#define RTC_HZ 128
+#define SAMPLES 256
+#define US_PER_S 1000000
+
+/*
+ * RTC tick jitter: how far apart the reads of the RTC at 128Hz really
+ * return, against the nominal 7812us.  Reports the shortest, longest and
+ * average interval, their spread, and the mean distance from nominal.
+ */
+int main ()
+{
+    uint32_t period, last, now, us, min, max, sum, dev, i;
+    int32_t rtc_fd, rate, garbage;
+
+    if (0 != bench_init ()) {
+        ece391_fdputs (1, (uint8_t*)"rtc unavailable\n");
+        return 2;
+    }
+    if (-1 == (rtc_fd = ece391_open ((uint8_t*)"rtc")))
+        return 2;
+    rate = RTC_HZ;
+    ece391_write (rtc_fd, &rate, 4);
+
+    period = US_PER_S / RTC_HZ;
+    min = 0xFFFFFFFF;
+    max = sum = dev = 0;
+    ece391_read (rtc_fd, &garbage, 4);
+    last = bench_cycles ();
+    for (i = 0; i < SAMPLES; i++) {
+        ece391_read (rtc_fd, &garbage, 4);
+        now = bench_cycles ();
+        us = bench_us (now - last);
+        last = now;
+        if (us < min)
+            min = us;
+        if (us > max)
+            max = us;
+        sum += us;
+        dev += us > period ? us - period : period - us;
+    }
+    ece391_close (rtc_fd);
+
+    bench_begin ("rtc_jitter");
+    bench_kv ("hz", RTC_HZ);
+    bench_kv ("samples", SAMPLES);
+    bench_kv ("period_us", period);
+    bench_kv ("avg_us", sum / SAMPLES);
+    bench_kv ("min_us", min);
+    bench_kv ("max_us", max);
+    bench_kv ("spread_us", max - min);
+    bench_kv ("mean_dev_us", dev / SAMPLES);
+    bench_end ();
+    return 0;
+}
@@ -4,14 +4,19 @@
 #include "ece391syscall.h"
 
 #define BUFSIZE 1024
+#define NUMBUFSIZE 12
+
+static void report_jobs ();
 
 int main ()
 {
-    int32_t cnt, rval;
+    int32_t cnt, rval, background;
     uint8_t buf[BUFSIZE];
+    uint8_t num[NUMBUFSIZE];
     ece391_fdputs (1, (uint8_t*)"Starting 391 Shell\n");
 
     while (1) {
+        report_jobs ();
         ece391_fdputs (1, (uint8_t*)"391OS> ");
 	if (-1 == (cnt = ece391_read (0, buf, BUFSIZE-1))) {
 	    ece391_fdputs (1, (uint8_t*)"read from keyboard failed\n");
@@ -22,8 +27,27 @@ int main ()
 	buf[cnt] = '\0';
 	if (0 == ece391_strcmp (buf, (uint8_t*)"exit"))
 	    return 0;
+	/* a trailing '&' runs the command in the background */
+	while (cnt > 0 && ' ' == buf[cnt - 1])
+	    buf[--cnt] = '\0';
+	background = (cnt > 0 && '&' == buf[cnt - 1]);
+	if (background) {
+	    buf[--cnt] = '\0';
+	    while (cnt > 0 && ' ' == buf[cnt - 1])
+		buf[--cnt] = '\0';
+	}
 	if ('\0' == buf[0])
 	    continue;
+	if (background) {
+	    if (-1 == (rval = ece391_spawn (buf))) {
+		ece391_fdputs (1, (uint8_t*)"no such command\n");
+	    } else {
+		ece391_fdputs (1, (uint8_t*)"[");
+		ece391_fdputs (1, ece391_itoa (rval, num, 10));
+		ece391_fdputs (1, (uint8_t*)"]\n");
+	    }
+	    continue;
+	}
 	rval = ece391_execute (buf);
 	if (-1 == rval)
 	    ece391_fdputs (1, (uint8_t*)"no such command\n");
@@ -34,3 +58,19 @@ int main ()
     }
 }
 
+/* collect background jobs that have finished since the last prompt */
+static void
+report_jobs ()
+{
+    int32_t pid, status;
+    uint8_t num[NUMBUFSIZE];
+
+    while (0 < (pid = ece391_waitpid (-1, &status, WNOHANG))) {
+	ece391_fdputs (1, (uint8_t*)"[");
+	ece391_fdputs (1, ece391_itoa (pid, num, 10));
+	if (256 == status)
+	    ece391_fdputs (1, (uint8_t*)"] terminated by exception\n");
+	else
+	    ece391_fdputs (1, (uint8_t*)"] done\n");
+    }
+}
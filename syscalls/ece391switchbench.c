@@ -0,0 +1,113 @@
+#include <stdint.h>
+
+#include "ece391bench.h"
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define SPIN_ARG "spin"
+#define SPIN_CMD "switchbench spin"
+/* busy processes to compete with, like programs on the other terminals */
+#define MAX_LOAD 2
+#define ROUND_TRIPS 1000
+
+/* whose turn it is: 0 for main's thread, 1 for pong's */
+static volatile uint32_t turn;
+static volatile uint32_t stop;
+
+/* the other half of the ping-pong: waits for its turn and hands it back */
+static int32_t
+pong (void* arg)
+{
+    for (;;) {
+        while (1 != turn)
+            ece391_futex (&turn, FUTEX_WAIT, 0);
+        if (stop)
+            return 0;
+        turn = 0;
+        ece391_futex (&turn, FUTEX_WAKE, 1);
+    }
+}
+
+/* times ROUND_TRIPS hand-offs to pong and back, best of BENCH_RUNS, and
+ * prints the time per switch */
+static int32_t
+ping_pong (uint32_t load)
+{
+    uint32_t start, cycles, best, i, r;
+    int32_t tid, status;
+
+    turn = 0;
+    stop = 0;
+    if (-1 == (tid = ece391_thread_create (pong, 0)))
+        return -1;
+
+    best = 0xFFFFFFFF;
+    for (r = 0; r < BENCH_RUNS; r++) {
+        start = bench_cycles ();
+        for (i = 0; i < ROUND_TRIPS; i++) {
+            turn = 1;
+            ece391_futex (&turn, FUTEX_WAKE, 1);
+            while (0 != turn)
+                ece391_futex (&turn, FUTEX_WAIT, 1);
+        }
+        cycles = bench_cycles () - start;
+        if (cycles < best)
+            best = cycles;
+    }
+
+    stop = 1;
+    turn = 1;
+    ece391_futex (&turn, FUTEX_WAKE, 1);
+    ece391_waitpid (tid, &status, 0);
+
+    /* two switches per round trip */
+    bench_begin ("switch");
+    bench_kv ("load", load);
+    bench_kv ("round_trips", ROUND_TRIPS);
+    bench_kv ("ns_per_switch", bench_ns (best, 2 * ROUND_TRIPS));
+    bench_end ();
+    return 0;
+}
+
+/*
+ * Context-switch latency: two threads hand a futex back and forth, each
+ * hand-off waking the other.  Measured alone, then with up to two busy
+ * processes (copies of this program started with "spin") competing for
+ * the CPU; load says how many the process limit allowed.  Run it while
+ * the other terminals are busy too for the worst case.
+ */
+int main ()
+{
+    uint8_t arg[8];
+    int32_t spinners[MAX_LOAD];
+    int32_t load, status, i;
+
+    if (0 == ece391_getargs (arg, 8) && 0 == ece391_strcmp (arg, (uint8_t*)SPIN_ARG))
+        for (;;);
+
+    if (0 != bench_init ()) {
+        ece391_fdputs (1, (uint8_t*)"rtc unavailable\n");
+        return 2;
+    }
+
+    if (0 != ping_pong (0)) {
+        ece391_fdputs (1, (uint8_t*)"thread_create failed\n");
+        return 3;
+    }
+
+    /* one more busy process each time, while there is room for pong */
+    for (load = 0; load < MAX_LOAD; load++) {
+        if (-1 == (spinners[load] = ece391_spawn ((uint8_t*)SPIN_CMD)))
+            break;
+        if (0 != ping_pong (load + 1)) {
+            ece391_kill (spinners[load], INTERRUPT);
+            ece391_waitpid (spinners[load], &status, 0);
+            break;
+        }
+    }
+    for (i = 0; i < load; i++) {
+        ece391_kill (spinners[i], INTERRUPT);
+        ece391_waitpid (spinners[i], &status, 0);
+    }
+    return 0;
+}
@@ -22,6 +22,85 @@ extern int32_t ece391_vidmap (uint8_t** screen_start);
 extern int32_t ece391_set_handler (int32_t signum, void* handler);
 extern int32_t ece391_sigreturn (void);
 
+/*
+ * fcntl reads (F_GETFL) or replaces (F_SETFL) the status flags of an open
+ * descriptor.  A read on an O_NONBLOCK descriptor that has no data ready
+ * returns -EAGAIN instead of waiting.
+ */
+extern int32_t ece391_fcntl (int32_t fd, int32_t cmd, int32_t arg);
+
+#define O_NONBLOCK 0x01
+#define F_GETFL 3
+#define F_SETFL 4
+#define EAGAIN 11
+
+/*
+ * lseek moves the read position of a file or directory; pread and pwrite
+ * use an explicit offset and leave the position alone.  readv and writev
+ * move up to IOV_MAX buffers in one call.  Devices cannot seek and return
+ * -ESPIPE.
+ */
+struct ece391_iovec {
+	void* iov_base;
+	int32_t iov_len;
+};
+
+extern int32_t ece391_lseek (int32_t fd, int32_t offset, int32_t whence);
+extern int32_t ece391_pread (int32_t fd, void* buf, int32_t nbytes, uint32_t offset);
+extern int32_t ece391_pwrite (int32_t fd, const void* buf, int32_t nbytes, uint32_t offset);
+extern int32_t ece391_readv (int32_t fd, const struct ece391_iovec* iov, int32_t iovcnt);
+extern int32_t ece391_writev (int32_t fd, const struct ece391_iovec* iov, int32_t iovcnt);
+
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
+#define ESPIPE 29
+#define IOV_MAX 16
+
+/*
+ * stat and fstat report a file's type, inode, length and data block count.
+ * dirstat fills a buffer with as many name-plus-metadata records as fit,
+ * starting at the position of a descriptor opened on "."; it returns the
+ * number of bytes filled and 0 at the end of the directory.
+ */
+struct ece391_stat {
+	uint32_t file_type;
+	uint32_t inode_num;
+	uint32_t length;
+	uint32_t num_blocks;
+};
+
+struct ece391_dirent_stat {
+	uint8_t file_name[32];
+	struct ece391_stat stat;
+};
+
+extern int32_t ece391_stat (const uint8_t* filename, struct ece391_stat* st);
+extern int32_t ece391_fstat (int32_t fd, struct ece391_stat* st);
+extern int32_t ece391_dirstat (int32_t fd, struct ece391_dirent_stat* buf, int32_t nbytes);
+
+/*
+ * getdents fills a buffer with as many fixed-size directory records as fit
+ * (name, type, inode and name length); names of exactly 32 characters are
+ * not NUL-terminated.  Returns bytes filled, 0 at the end of the directory.
+ */
+struct ece391_dirent {
+	uint8_t file_name[32];
+	uint32_t file_type;
+	uint32_t inode_num;
+	uint32_t name_len;
+};
+
+extern int32_t ece391_getdents (int32_t fd, struct ece391_dirent* buf, int32_t nbytes);
+
+enum file_types {
+	FILE_TYPE_RTC = 0,
+	FILE_TYPE_DIR,
+	FILE_TYPE_REGULAR,
+	FILE_TYPE_TERMINAL,
+	FILE_TYPE_PROC          /* generated kernel statistics, proc/... */
+};
+
 enum signums {
 	DIV_ZERO = 0,
 	SEGFAULT,
@@ -31,5 +110,122 @@ enum signums {
 	NUM_SIGNALS
 };
 
+/*
+ * A handler installed with set_handler is called as handler (signum) with
+ * all signals blocked; returning from it calls sigreturn and resumes the
+ * interrupted code.  A NULL handler restores the default action: DIV_ZERO,
+ * SEGFAULT and INTERRUPT (ctrl-c) kill the program, so execute returns
+ * 256 in the parent; ALARM (every 10 seconds) and USER1 are ignored.
+ * kill sends signum to the process with the given pid.
+ */
+extern int32_t ece391_kill (int32_t pid, int32_t signum);
+
+/*
+ * spawn starts a program like execute but returns its pid immediately; it
+ * runs alongside the caller on the same terminal.  wait and waitpid
+ * collect the status a spawned child passed to halt (256 if a signal
+ * killed it) and return its pid.  waitpid takes a pid or -1 for any
+ * child; with WNOHANG it returns 0 instead of blocking.  Both return
+ * -ECHILD if there is no child to wait for.
+ */
+#define WNOHANG 0x01
+#define ECHILD  10
+
+extern int32_t ece391_spawn (const uint8_t* command);
+extern int32_t ece391_wait (int32_t* status);
+extern int32_t ece391_waitpid (int32_t pid, int32_t* status, int32_t options);
+
+/*
+ * fork creates a copy of the caller that continues from the same point:
+ * it returns the child's pid in the parent and 0 in the child.  Memory is
+ * shared copy-on-write, so a page is only copied when one of them writes
+ * it.  The child is reaped with wait or waitpid like a spawned one.
+ */
+extern int32_t ece391_fork (void);
+
+/*
+ * thread_create runs entry (arg) as a new thread sharing the caller's
+ * memory, on its own 64kB stack.  Returning a status from entry (or halt)
+ * ends only that thread; join it with waitpid on the returned id.  The
+ * whole program ends when main's thread halts.
+ *
+ * futex (addr, FUTEX_WAIT, val) sleeps while *addr == val until another
+ * thread calls futex (addr, FUTEX_WAKE, n), which wakes up to n sleepers
+ * and returns how many it woke.  WAIT returns -EAGAIN right away if *addr
+ * no longer holds val, and -EINTR if a signal arrives.
+ */
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+#define EINTR      4
+
+extern int32_t ece391_thread_create (int32_t (*entry)(void*), void* arg);
+extern int32_t ece391_futex (volatile uint32_t* addr, int32_t op, uint32_t val);
+
+/*
+ * sysstat fills in counters kept since boot: timer ticks (jiffies, tick_hz
+ * per second, counted even while the timer is stopped), the ticks spent
+ * halted with nothing to run, device interrupts taken, and context
+ * switches.  Sample it twice to get rates.
+ */
+struct ece391_sysstat {
+	uint32_t jiffies;
+	uint32_t tick_hz;
+	uint32_t idle_jiffies;
+	uint32_t interrupts;
+	uint32_t switches;
+};
+
+extern int32_t ece391_sysstat (struct ece391_sysstat* st);
+
+/*
+ * The scheduler runs processes from NICE_LEVELS priority levels, highest
+ * first.  Using up a time slice moves a process down a level; waking up
+ * for keyboard or RTC input moves it back to the top, and so does a
+ * reset once a second.  nice adds inc to the caller's nice value (0 to
+ * NICE_LEVELS - 1), the highest level it may run at, and returns the new
+ * value.  A CPU-bound program can call nice (NICE_LEVELS) to stay out of
+ * the way of everything else.
+ */
+#define NICE_LEVELS 4
+
+extern int32_t ece391_nice (int32_t inc);
+
+/*
+ * procstat fills buf with up to count entries, one per live process in
+ * pid order, and returns how many it filled.  Times are in ticks of
+ * sysstat's tick_hz; user and kernel time are sampled on the timer
+ * interrupt.  state is one of TASK_* below; parent is -1 for the shell
+ * started on each terminal at boot.
+ */
+#define PROC_NAME_LEN 32
+#define MAX_PROCS     6
+
+enum task_states {
+	TASK_RUNNING = 0,
+	TASK_WAITING,
+	TASK_ZOMBIE,
+	TASK_FUTEX,
+	TASK_SLEEPING
+};
+
+struct ece391_procstat {
+	int32_t pid;
+	int32_t parent;
+	uint8_t state;
+	uint8_t terminal;
+	uint8_t prio;
+	uint8_t nice;
+	uint8_t name[PROC_NAME_LEN];
+	uint32_t utime;
+	uint32_t stime;
+	uint32_t switches;
+	uint32_t syscalls;
+	uint32_t bytes_read;
+	uint32_t bytes_written;
+	uint32_t faults;
+};
+
+extern int32_t ece391_procstat (struct ece391_procstat* buf, int32_t count);
+
 #endif /* ECE391SYSCALL_H */
 
@@ -0,0 +1,39 @@
+#include <stdint.h>
+
+#include "ece391bench.h"
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define CALLS 10000
+
+/*
+ * Null system call latency: fcntl (F_GETFL) on stdout, which does no
+ * more than look up the descriptor, so what is measured is the trap into
+ * the kernel, the dispatch and the return.
+ */
+int main ()
+{
+    uint32_t start, cycles, best, i, r;
+
+    if (0 != bench_init ()) {
+        ece391_fdputs (1, (uint8_t*)"rtc unavailable\n");
+        return 2;
+    }
+
+    best = 0xFFFFFFFF;
+    for (r = 0; r < BENCH_RUNS; r++) {
+        start = bench_cycles ();
+        for (i = 0; i < CALLS; i++)
+            ece391_fcntl (1, F_GETFL, 0);
+        cycles = bench_cycles () - start;
+        if (cycles < best)
+            best = cycles;
+    }
+
+    bench_begin ("syscall");
+    bench_kv ("calls", CALLS);
+    bench_kv ("cycles_per_call", best / CALLS);
+    bench_kv ("ns_per_call", bench_ns (best, CALLS));
+    bench_end ();
+    return 0;
+}
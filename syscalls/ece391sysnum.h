@@ -11,5 +11,25 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_FCNTL   11
+#define SYS_LSEEK   12
+#define SYS_PREAD   13
+#define SYS_PWRITE  14
+#define SYS_READV   15
+#define SYS_WRITEV  16
+#define SYS_STAT    17
+#define SYS_FSTAT   18
+#define SYS_DIRSTAT 19
+#define SYS_GETDENTS 20
+#define SYS_KILL    21
+#define SYS_SPAWN   22
+#define SYS_WAIT    23
+#define SYS_WAITPID 24
+#define SYS_FORK    25
+#define SYS_THREAD_CREATE 26
+#define SYS_FUTEX   27
+#define SYS_SYSSTAT 28
+#define SYS_NICE    29
+#define SYS_PROCSTAT 30
 
 #endif /* ECE391SYSNUM_H */
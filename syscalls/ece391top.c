@@ -0,0 +1,114 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define RTC_HZ 2
+#define NUMSIZE 16
+#define NAME_WIDTH 8
+
+static const char* state_names[] = { "run", "wait", "zomb", "futx", "slp" };
+
+/* print s left-aligned in a column of width characters */
+static void
+put_col (const uint8_t* s, uint32_t width)
+{
+    uint32_t len = ece391_strlen (s);
+
+    ece391_fdputs (1, s);
+    while (len++ < width)
+        ece391_fdputs (1, (uint8_t*)" ");
+}
+
+/* print value in decimal in a column of width characters */
+static void
+put_num (uint32_t value, uint32_t width)
+{
+    uint8_t buf[NUMSIZE];
+
+    put_col (ece391_itoa (value, buf, 10), width);
+}
+
+/* print a name, cut to fit its column */
+static void
+put_name (const uint8_t* name)
+{
+    uint8_t buf[NAME_WIDTH];
+    uint32_t i;
+
+    for (i = 0; i < NAME_WIDTH - 1 && '\0' != name[i]; i++)
+        buf[i] = name[i];
+    buf[i] = '\0';
+    put_col (buf, NAME_WIDTH);
+}
+
+/*
+ * Every second, lists the running processes with the share of the CPU
+ * each used since the last refresh, and what they have used since they
+ * started.  Ctrl-C quits.
+ */
+int main ()
+{
+    struct ece391_procstat procs[MAX_PROCS];
+    uint32_t last_ticks[MAX_PROCS];
+    struct ece391_sysstat now, last;
+    int32_t rtc_fd, rate, garbage, cnt, i;
+    uint32_t ticks, elapsed, used;
+
+    if (-1 == (rtc_fd = ece391_open ((uint8_t*)"rtc"))) {
+        ece391_fdputs (1, (uint8_t*)"rtc open failed\n");
+        return 2;
+    }
+    rate = RTC_HZ;
+    ece391_write (rtc_fd, &rate, 4);
+
+    for (i = 0; i < MAX_PROCS; i++)
+        last_ticks[i] = 0;
+    if (0 != ece391_sysstat (&last)) {
+        ece391_fdputs (1, (uint8_t*)"sysstat failed\n");
+        return 3;
+    }
+
+    while (1) {
+        for (i = 0; i < RTC_HZ; i++)
+            ece391_read (rtc_fd, &garbage, 4);
+
+        ece391_sysstat (&now);
+        if (0 > (cnt = ece391_procstat (procs, MAX_PROCS))) {
+            ece391_fdputs (1, (uint8_t*)"procstat failed\n");
+            return 3;
+        }
+        elapsed = now.jiffies - last.jiffies;
+        if (0 == elapsed)
+            elapsed = 1;
+
+        ece391_fdputs (1, (uint8_t*)"\nPID NAME    TT ST   PR NI %CPU USER  SYS   SW    SYSC   READ   WRITE  FLT\n");
+        for (i = 0; i < cnt; i++) {
+            ticks = procs[i].utime + procs[i].stime;
+            used = ticks - last_ticks[procs[i].pid];
+            if (used > elapsed)     /* the pid was reused */
+                used = ticks;
+            last_ticks[procs[i].pid] = ticks;
+
+            put_num (procs[i].pid, 4);
+            put_name (procs[i].name);
+            put_num (procs[i].terminal + 1, 3);
+            put_col ((uint8_t*)(procs[i].state <= TASK_SLEEPING ?
+                                state_names[procs[i].state] : "?"), 5);
+            put_num (procs[i].prio, 3);
+            put_num (procs[i].nice, 3);
+            put_num (used * 100 / elapsed, 5);
+            put_num (procs[i].utime, 6);
+            put_num (procs[i].stime, 6);
+            put_num (procs[i].switches, 6);
+            put_num (procs[i].syscalls, 7);
+            put_num (procs[i].bytes_read, 7);
+            put_num (procs[i].bytes_written, 7);
+            put_num (procs[i].faults, 0);
+            ece391_fdputs (1, (uint8_t*)"\n");
+        }
+        last = now;
+    }
+
+    return 0;
+}
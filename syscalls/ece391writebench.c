@@ -0,0 +1,57 @@
+#include <stdint.h>
+
+#include "ece391bench.h"
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define LINE 80
+#define MAX_WRITE 1024
+/* bytes written per run: 100 full lines */
+#define RUN_BYTES (100 * LINE)
+#define NUM_SIZES 4
+
+static const uint32_t sizes[NUM_SIZES] = { 1, 16, LINE, MAX_WRITE };
+static uint8_t text[RUN_BYTES];
+
+/*
+ * Console write throughput: writes lines of text to the terminal with
+ * writes of 1, 16, 80 and 1024 bytes, so the screen scrolls all the
+ * while.  The results come at the end, once the scrolling has stopped.
+ */
+int main ()
+{
+    uint32_t best[NUM_SIZES];
+    uint32_t start, cycles, off, n, us, s, r, i;
+
+    if (0 != bench_init ()) {
+        ece391_fdputs (1, (uint8_t*)"rtc unavailable\n");
+        return 2;
+    }
+    for (i = 0; i < RUN_BYTES; i++)
+        text[i] = (LINE - 1 == i % LINE) ? '\n' : 'a' + i % 26;
+
+    for (s = 0; s < NUM_SIZES; s++) {
+        best[s] = 0xFFFFFFFF;
+        for (r = 0; r < BENCH_RUNS; r++) {
+            start = bench_cycles ();
+            for (off = 0; off < RUN_BYTES; off += n) {
+                n = RUN_BYTES - off < sizes[s] ? RUN_BYTES - off : sizes[s];
+                ece391_write (1, text + off, n);
+            }
+            cycles = bench_cycles () - start;
+            if (cycles < best[s])
+                best[s] = cycles;
+        }
+    }
+
+    for (s = 0; s < NUM_SIZES; s++) {
+        us = bench_us (best[s]);
+        bench_begin ("console_write");
+        bench_kv ("size", sizes[s]);
+        bench_kv ("bytes", RUN_BYTES);
+        bench_kv ("us", us);
+        bench_kv ("KBps", us >= 1000 ? RUN_BYTES / (us / 1000) : 0);
+        bench_end ();
+    }
+    return 0;
+}